@@ -0,0 +1,458 @@
+/* gui_batch.c
+ *
+ * Batch verification for the GUI (see gui_batch.h).
+ *
+ * Listing happens on the coordinator thread alone, so the row array
+ * and path arena can grow with realloc; they are handed to the frame
+ * loop and the pool only through the phase store that ends listing.
+ * After that nothing is reallocated: the rows are split over the
+ * work-stealing pool of sha256_sched.c and each worker writes only
+ * the rows of the ranges it runs, hashing them with its own context.
+ *
+ * Every file is mapped once and fed to all three engines chunk by
+ * chunk, so each chunk is still in cache for the second and third
+ * pass, and a stop request is seen between chunks even in huge files.
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef HAVE_OPENSSL
+#include <openssl/evp.h>
+#endif
+
+#include "gui_batch.h"
+#include "sha256_file.h"
+#include "sha256_rust.h"
+#include "sha256_sched.h"
+
+#define GUI_BATCH_CHUNK (16u << 20)   // bytes per engine pass
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int stopped(struct gui_batch *b) {
+    return __atomic_load_n(&b->stop, __ATOMIC_RELAXED);
+}
+
+/*
+ * Listing (coordinator only)
+ */
+
+static int add_row(struct gui_batch *b, const char *path, const u8 *listed) {
+    struct gui_batch_row *row;
+    struct stat st;
+    u64 n = strlen(path) + 1;
+
+    if (b->nrows == b->cap_rows) {
+        u32 cap = b->cap_rows ? b->cap_rows * 2 : 1024;
+        struct gui_batch_row *grown = realloc(b->rows, (size_t)cap * sizeof(*grown));
+        if (!grown) return -1;
+        b->rows = grown;
+        b->cap_rows = cap;
+    }
+    if (b->paths_len + n > b->paths_cap) {
+        u64 cap = b->paths_cap ? b->paths_cap * 2 : 65536;
+        char *grown;
+        while (cap < b->paths_len + n) cap *= 2;
+        grown = realloc(b->paths, (size_t)cap);
+        if (!grown) return -1;
+        b->paths = grown;
+        b->paths_cap = cap;
+    }
+
+    row = &b->rows[b->nrows++];
+    memset(row, 0, sizeof(*row));
+    row->path = b->paths_len;
+    memcpy(b->paths + b->paths_len, path, (size_t)n);
+    b->paths_len += n;
+    if (listed) {
+        memcpy(row->listed, listed, 32);
+        row->flags = GUI_ROW_LISTED;
+    }
+    // A missing file still gets a row; it fails when it is hashed
+    if (stat(path, &st) == 0 && S_ISREG(st.st_mode))
+        row->bytes = (u64)st.st_size;
+    b->bytes_total += row->bytes;
+    __atomic_store_n(&b->listed, b->nrows, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static int cmp_names(const void *x, const void *y) {
+    return strcmp(*(char *const *)x, *(char *const *)y);
+}
+
+/* Every regular file under dir, in name order. Symlinks to files are
+ * followed, symlinks to directories are not (no loops). */
+static int list_dir(struct gui_batch *b, const char *dir) {
+    DIR *d = opendir(dir);
+    struct dirent *de;
+    char **names = NULL;
+    size_t n = 0, cap = 0, i;
+    int rc = 0;
+
+    if (!d)
+        return add_row(b, dir, NULL);   // shows up as an unreadable row
+
+    while ((de = readdir(d)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        if (n == cap) {
+            char **grown = realloc(names, (cap = cap ? cap * 2 : 64) * sizeof(*names));
+            if (!grown) { rc = -1; break; }
+            names = grown;
+        }
+        // The d_type byte rides after the name, so it sorts with it
+        if ((names[n] = malloc(strlen(de->d_name) + 2)) == NULL) { rc = -1; break; }
+        strcpy(names[n], de->d_name);
+        names[n][strlen(de->d_name) + 1] = (char)de->d_type;
+        n++;
+    }
+    closedir(d);
+    qsort(names, n, sizeof(*names), cmp_names);
+
+    for (i = 0; i < n; ++i) {
+        unsigned char type = (unsigned char)names[i][strlen(names[i]) + 1];
+        char *path;
+        struct stat st;
+
+        if (rc == 0 && !stopped(b) && asprintf(&path, "%s/%s", dir, names[i]) >= 0) {
+            // d_type saves a stat per file where the filesystem fills it in
+            if (type == DT_UNKNOWN)
+                type = lstat(path, &st) != 0 ? DT_UNKNOWN : S_ISDIR(st.st_mode) ? DT_DIR :
+                       S_ISLNK(st.st_mode) ? DT_LNK : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            if (type == DT_LNK)
+                type = stat(path, &st) == 0 && S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+
+            if (type == DT_DIR)
+                rc = list_dir(b, path);
+            else if (type == DT_REG)
+                rc = add_row(b, path, NULL);
+            free(path);
+        }
+        free(names[i]);
+    }
+    free(names);
+    return rc;
+}
+
+/* Split a "<hex>  <name>" or "<hex> *<name>" line (newline already
+ * stripped). Returns the name, or NULL if the line is not one. */
+static const char *parse_line(const char *line, size_t n, u8 digest[32]) {
+    if (n < 67 || line[64] != ' ' || (line[65] != ' ' && line[65] != '*'))
+        return NULL;
+    if (sha256_from_hex(line, digest) != 0)
+        return NULL;
+    return line + 66;
+}
+
+// Read the next line without its line ending; -1 at end of file
+static ssize_t next_line(FILE *in, char **line, size_t *cap) {
+    ssize_t n = getline(line, cap, in);
+    while (n > 0 && ((*line)[n - 1] == '\n' || (*line)[n - 1] == '\r'))
+        (*line)[--n] = '\0';
+    return n;
+}
+
+/* Rows for every well-formed manifest line. Relative names are taken
+ * relative to the manifest's own directory, since a dropped manifest
+ * has no meaningful working directory. */
+static int list_manifest(struct gui_batch *b, const char *manifest) {
+    FILE *in = fopen(manifest, "r");
+    const char *slash = strrchr(manifest, '/');
+    int dirlen = slash ? (int)(slash - manifest) : 0;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    int rc = 0;
+
+    if (!in)
+        return add_row(b, manifest, NULL);
+
+    while (rc == 0 && !stopped(b) && (n = next_line(in, &line, &cap)) != -1) {
+        u8 digest[32];
+        const char *name = parse_line(line, (size_t)n, digest);
+        char *path;
+
+        if (!name)
+            continue;
+        if (name[0] == '/' || !slash) {
+            rc = add_row(b, name, digest);
+        } else if (asprintf(&path, "%.*s/%s", dirlen, manifest, name) >= 0) {
+            rc = add_row(b, path, digest);
+            free(path);
+        } else {
+            rc = -1;
+        }
+    }
+    free(line);
+    fclose(in);
+    return rc;
+}
+
+int gui_batch_is_manifest(const char *path) {
+    FILE *in;
+    struct stat st;
+    char line[4096 + 70];   // hex, two separators, a PATH_MAX name
+    u8 digest[32];
+    int yes = 0;
+
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) || (in = fopen(path, "r")) == NULL)
+        return 0;
+    // First line that is not blank or a comment decides. fgets() keeps
+    // a dropped multi-GB image from being read whole as one "line".
+    while (fgets(line, sizeof(line), in)) {
+        size_t n = strlen(line);
+        if (n == sizeof(line) - 1 && line[n - 1] != '\n')
+            break;   // no line break where a manifest would have one
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r'))
+            line[--n] = '\0';
+        if (n == 0 || line[0] == '#')
+            continue;
+        yes = parse_line(line, n, digest) != NULL;
+        break;
+    }
+    fclose(in);
+    return yes;
+}
+
+static int list_input(struct gui_batch *b, const char *path) {
+    struct stat st;
+
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+        return list_dir(b, path);
+    if (gui_batch_is_manifest(path))
+        return list_manifest(b, path);
+    return add_row(b, path, NULL);
+}
+
+/*
+ * Hashing (every pool thread)
+ */
+
+/* Hash data with all three engines and fill in the verdict. Returns
+ * -1 if the batch was stopped part way. */
+static int verify(struct gui_batch *b, struct sha256_sched_worker *w, struct gui_batch_row *row,
+                  const u8 *data, u64 len) {
+    struct sha256_ctx *c_ctx = &w->ctx;
+    RustSha256Ctx rust_ctx;
+    u8 rust[32];
+    const u8 *ref = row->digest;
+    u64 off = 0;
+    u8 flags = row->flags;
+#ifdef HAVE_OPENSSL
+    EVP_MD_CTX *md = EVP_MD_CTX_new();
+    u8 ossl[32];
+    unsigned int mdlen = 0;
+    int have_ref = md && EVP_DigestInit_ex(md, EVP_sha256(), NULL);
+#endif
+
+    sha256_init(c_ctx);
+    rust_sha256_init(&rust_ctx);
+    do {
+        u64 n = len - off;
+        if (n > GUI_BATCH_CHUNK) n = GUI_BATCH_CHUNK;
+
+        sha256_update64(c_ctx, data + off, n);
+        rust_sha256_update64(&rust_ctx, data + off, n);
+#ifdef HAVE_OPENSSL
+        if (have_ref)
+            EVP_DigestUpdate(md, data + off, (size_t)n);
+#endif
+        off += n;
+        __atomic_add_fetch(&b->bytes_done, n, __ATOMIC_RELAXED);
+        if (stopped(b)) {
+#ifdef HAVE_OPENSSL
+            EVP_MD_CTX_free(md);
+#endif
+            return -1;
+        }
+    } while (off < len);
+
+    sha256_final(c_ctx, row->digest);
+    rust_sha256_final(&rust_ctx, rust);
+#ifdef HAVE_OPENSSL
+    if (have_ref && EVP_DigestFinal_ex(md, ossl, &mdlen) && mdlen == 32) {
+        ref = ossl;
+        flags |= GUI_ROW_HAS_REF;
+    }
+    EVP_MD_CTX_free(md);
+#endif
+
+    if (memcmp(row->digest, ref, 32) == 0) flags |= GUI_ROW_C_OK;
+    if (memcmp(rust, ref, 32) == 0)        flags |= GUI_ROW_RUST_OK;
+    if ((flags & GUI_ROW_LISTED) && memcmp(row->listed, ref, 32) == 0)
+        flags |= GUI_ROW_LISTED_OK;
+    row->flags = flags;
+    return 0;
+}
+
+// Hash one row of a range this worker runs, and publish it
+static void hash_row(struct gui_batch *b, struct sha256_sched_worker *w, struct gui_batch_row *row) {
+    const char *path = b->paths + row->path;
+    struct sha256_file_data file = { (const u8 *)"", 0, NULL, NULL };
+    int fd = open(path, O_RDONLY), state, ok;
+
+    if (fd < 0 || sha256_file_load(fd, 0, &file) != 0)
+        row->error = errno;
+    if (fd >= 0)
+        close(fd);
+
+    if (row->error) {
+        state = GUI_ROW_ERROR;
+    } else if (verify(b, w, row, file.data, file.len) != 0) {
+        state = GUI_ROW_PENDING;   // stopped: never published
+    } else {
+        ok = (row->flags & GUI_ROW_C_OK) && (row->flags & GUI_ROW_RUST_OK) &&
+             (!(row->flags & GUI_ROW_LISTED) || (row->flags & GUI_ROW_LISTED_OK));
+        state = ok ? GUI_ROW_PASS : GUI_ROW_FAIL;
+    }
+
+    sha256_file_release(&file);
+
+    if (state == GUI_ROW_PENDING)
+        return;
+    if (state != GUI_ROW_PASS)
+        __atomic_add_fetch(&b->failed, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&row->state, (u8)state, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&b->done, 1, __ATOMIC_RELAXED);
+}
+
+static void hash_rows(struct sha256_sched_worker *w, u64 begin, u64 end, void *arg) {
+    struct gui_batch *b = arg;
+    u64 i;
+
+    for (i = begin; i < end && !stopped(b); ++i)
+        hash_row(b, w, &b->rows[i]);
+}
+
+static void *coordinator_main(void *arg) {
+    struct gui_batch *b = arg;
+    struct sha256_sched_opts sched = { 0 };
+    u32 i;
+
+    for (i = 0; i < b->ninputs && !stopped(b); ++i)
+        if (list_input(b, b->inputs[i]) != 0)
+            break;   // out of memory: verify what was listed
+    if (stopped(b))
+        return NULL;
+
+    // Hand the finished rows over; nothing is reallocated after this
+    b->t_start = now_seconds();
+    __atomic_store_n(&b->phase, GUI_BATCH_HASHING, __ATOMIC_RELEASE);
+
+    sched.threads = b->threads;
+    sched.grain = 1;   // one row per range: file sizes vary too much to batch
+    sched.stop = &b->stop;
+    sha256_sched_run(b->nrows, hash_rows, b, &sched);   // rows stay pending if it fails
+
+    b->t_end = now_seconds();
+    __atomic_store_n(&b->phase, GUI_BATCH_DONE, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+int gui_batch_start(struct gui_batch *b, const char *const *paths, u32 npaths, u32 threads) {
+    u32 i;
+
+    memset(b, 0, sizeof(*b));
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (u32)cpus : 1;
+    }
+    b->threads = threads > GUI_BATCH_MAX_THREADS ? GUI_BATCH_MAX_THREADS : threads;
+
+    b->inputs = calloc(npaths ? npaths : 1, sizeof(*b->inputs));
+    if (!b->inputs)
+        return -1;
+    for (i = 0; i < npaths; ++i) {
+        if ((b->inputs[i] = strdup(paths[i])) == NULL) {
+            gui_batch_stop(b);
+            return -1;
+        }
+        b->ninputs++;
+    }
+
+    b->phase = GUI_BATCH_LISTING;
+    if (pthread_create(&b->coordinator, NULL, coordinator_main, b) != 0) {
+        gui_batch_stop(b);
+        return -1;
+    }
+    b->running = 1;
+    return 0;
+}
+
+void gui_batch_stop(struct gui_batch *b) {
+    u32 i;
+
+    __atomic_store_n(&b->stop, 1, __ATOMIC_RELAXED);
+    if (b->running)
+        pthread_join(b->coordinator, NULL);
+
+    for (i = 0; i < b->ninputs; ++i)
+        free(b->inputs[i]);
+    free(b->inputs);
+    free(b->rows);
+    free(b->paths);
+    memset(b, 0, sizeof(*b));
+}
+
+void gui_batch_status(struct gui_batch *b, struct gui_batch_status *out) {
+    memset(out, 0, sizeof(*out));
+    out->phase = (enum gui_batch_phase)__atomic_load_n(&b->phase, __ATOMIC_ACQUIRE);
+    out->threads = b->threads;
+#ifdef HAVE_OPENSSL
+    strcpy(out->reference, "OpenSSL");
+#else
+    strcpy(out->reference, "C vs Rust");
+#endif
+
+    if (out->phase == GUI_BATCH_LISTING) {
+        out->rows = __atomic_load_n(&b->listed, __ATOMIC_RELAXED);
+        return;
+    }
+    if (out->phase == GUI_BATCH_IDLE)
+        return;
+
+    out->rows = b->nrows;
+    out->done = __atomic_load_n(&b->done, __ATOMIC_RELAXED);
+    out->failed = __atomic_load_n(&b->failed, __ATOMIC_RELAXED);
+    out->bytes_total = b->bytes_total;
+    out->bytes_done = __atomic_load_n(&b->bytes_done, __ATOMIC_RELAXED);
+    out->seconds = (out->phase == GUI_BATCH_DONE ? b->t_end : now_seconds()) - b->t_start;
+}
+
+int gui_batch_row(struct gui_batch *b, u32 i, struct gui_batch_row *out) {
+    const struct gui_batch_row *row;
+
+    if (__atomic_load_n(&b->phase, __ATOMIC_ACQUIRE) < GUI_BATCH_HASHING || i >= b->nrows)
+        return 0;
+    row = &b->rows[i];
+
+    // The fixed part is always safe to read; the result only once published
+    memset(out, 0, sizeof(*out));
+    out->path = row->path;
+    out->bytes = row->bytes;
+    memcpy(out->listed, row->listed, 32);
+    out->state = __atomic_load_n(&row->state, __ATOMIC_ACQUIRE);
+    if (out->state != GUI_ROW_PENDING) {
+        out->flags = row->flags;
+        out->error = row->error;
+        memcpy(out->digest, row->digest, 32);
+    }
+    return 1;
+}
+
+const char *gui_batch_path(const struct gui_batch *b, const struct gui_batch_row *row) {
+    return b->paths + row->path;
+}
@@ -0,0 +1,145 @@
+/* gui_batch.h
+ *
+ * Batch verification for the GUI: hash every file of a dropped
+ * directory, file list or sha256sum manifest with the C core, the
+ * Rust core and the OpenSSL reference, on a pool of threads.
+ *
+ * gui_batch_start() returns at once. A coordinator thread first
+ * expands the inputs into one row per file (directories recursively,
+ * manifests line by line), then it hashes them on the work-stealing
+ * pool of sha256_sched.h, with threads workers. Each row's result is published with an
+ * atomic state store once its verdict is known, so the frame loop can
+ * read any row at any time without locking; it only copies out the
+ * rows it draws, which keeps a frame cheap at 100k rows.
+ *
+ * A row passes when the C and Rust digests both equal the reference
+ * and, for manifest rows, the listed digest. The reference is OpenSSL
+ * when built with HAVE_OPENSSL; otherwise the OpenSSL command line is
+ * too slow to spawn per file, so the C core is compared with the Rust
+ * core (and the manifest) only.
+ *
+ * Typical usage (once per frame):
+ *   gui_batch_status(&b, &s);                  // header, progress bar
+ *   for (i = first; i < first + visible && i < s.rows; ++i)
+ *       if (gui_batch_row(&b, i, &row)) ...    // draw one row
+ *
+ * Needs a hosted POSIX system (threads, mmap, dirent).
+ */
+
+#ifndef GUI_BATCH_H
+#define GUI_BATCH_H
+
+#include <pthread.h>
+
+#include "sha256.h"
+
+#define GUI_BATCH_MAX_THREADS 64
+
+enum gui_batch_phase {
+    GUI_BATCH_IDLE = 0,           // never started, or stopped
+    GUI_BATCH_LISTING,            // expanding directories and manifests
+    GUI_BATCH_HASHING,
+    GUI_BATCH_DONE
+};
+
+enum gui_row_state {
+    GUI_ROW_PENDING = 0,
+    GUI_ROW_PASS,
+    GUI_ROW_FAIL,                 // some engine disagrees
+    GUI_ROW_ERROR                 // could not be read
+};
+
+// Flags in gui_batch_row.flags
+#define GUI_ROW_C_OK       0x01   // C digest equals the reference
+#define GUI_ROW_RUST_OK    0x02   // Rust digest equals the reference
+#define GUI_ROW_HAS_REF    0x04   // OpenSSL digest is the reference
+#define GUI_ROW_LISTED     0x08   // row came from a manifest
+#define GUI_ROW_LISTED_OK  0x10   // ... and its digest matched
+
+// One file. path, bytes and listed are fixed once listing is over;
+// the rest is written by a worker before it stores state.
+struct gui_batch_row {
+    u64 path;                     // offset of the path, see gui_batch_path()
+    u64 bytes;                    // size when listed
+    u8 listed[32];                // digest from the manifest, if any
+    u8 state;                     // enum gui_row_state
+    u8 flags;                     // GUI_ROW_* flags
+    int error;                    // errno for GUI_ROW_ERROR
+    u8 digest[32];                // C digest
+};
+
+// Snapshot of the whole batch, see gui_batch_status()
+struct gui_batch_status {
+    enum gui_batch_phase phase;
+    u32 rows;                     // rows so far (final once hashing starts)
+    u32 done;                     // rows with a verdict
+    u32 failed;                   // rows in GUI_ROW_FAIL or GUI_ROW_ERROR
+    u32 threads;
+    u64 bytes_total;
+    u64 bytes_done;
+    double seconds;               // since hashing started (frozen when done)
+    char reference[16];           // "OpenSSL" or "C vs Rust"
+};
+
+struct gui_batch {
+    pthread_t coordinator;
+    u32 threads;
+    int running;                  // coordinator was started and not yet joined
+
+    // Inputs, consumed by the coordinator
+    char **inputs;
+    u32 ninputs;
+
+    // Rows and paths; only appended to while listing
+    struct gui_batch_row *rows;
+    u32 nrows, cap_rows;
+    char *paths;
+    u64 paths_len, paths_cap;
+
+    // Shared with the frame loop (atomics)
+    int phase;
+    u32 listed;                   // rows found while listing
+    u32 done, failed;
+    u64 bytes_total, bytes_done;
+    double t_start, t_end;
+    int stop;
+};
+
+/* gui_batch_start()
+ * Start verifying paths (files, directories or manifests) on threads
+ * threads (0 = one per CPU). The paths are copied. The batch must be
+ * idle (zeroed or stopped). Returns 0, or -1 if out of memory or the
+ * coordinator could not be started.
+ */
+int gui_batch_start(struct gui_batch *b, const char *const *paths, u32 npaths, u32 threads);
+
+/* gui_batch_stop()
+ * Abandon the batch, join every thread and free the rows.
+ * Harmless on an idle batch.
+ */
+void gui_batch_stop(struct gui_batch *b);
+
+/* gui_batch_status()
+ * Read the batch counters without blocking the workers.
+ */
+void gui_batch_status(struct gui_batch *b, struct gui_batch_status *out);
+
+/* gui_batch_row()
+ * Copy row i into *out. Returns 1, or 0 if the row does not exist yet
+ * (still listing, or i >= rows).
+ */
+int gui_batch_row(struct gui_batch *b, u32 i, struct gui_batch_row *out);
+
+/* gui_batch_path()
+ * Path of a row copied out by gui_batch_row(); valid until
+ * gui_batch_stop().
+ */
+const char *gui_batch_path(const struct gui_batch *b, const struct gui_batch_row *row);
+
+/* gui_batch_is_manifest()
+ * 1 if path is a regular file whose first line is a sha256sum line.
+ * The GUI uses it to tell a dropped manifest from a file to hash.
+ */
+int gui_batch_is_manifest(const char *path);
+
+#endif
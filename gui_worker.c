@@ -0,0 +1,377 @@
+/* gui_worker.c
+ *
+ * Background hashing thread for the GUI (see gui_worker.h).
+ *
+ * Jobs and results are singly linked FIFO lists under one mutex; the
+ * frame loop only ever holds it for a pointer swap. Progress lives
+ * outside the lock in plain fields written with __atomic stores, so
+ * drawing a progress bar never waits for the worker.
+ *
+ * Each engine hashes the input in GUI_WORKER_CHUNK pieces and bumps
+ * its counter after every piece; the same counters let a cancelled
+ * job bail out between pieces.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef HAVE_OPENSSL
+#include <openssl/evp.h>
+#endif
+
+#include "gui_worker.h"
+#include "sha256_file.h"
+#include "sha256_rust.h"
+
+struct gui_job {
+    struct gui_job *next;
+    u32 id;
+    int is_file;
+    u64 len;                          // text length (text jobs)
+    char *data;                       // text bytes, or NUL-terminated path
+};
+
+struct gui_result_node {
+    struct gui_result_node *next;
+    struct gui_result r;
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int cancelled(struct gui_worker *w, u32 id) {
+    return id <= __atomic_load_n(&w->cancel_upto, __ATOMIC_RELAXED) ||
+           __atomic_load_n(&w->stop, __ATOMIC_RELAXED);
+}
+
+#ifndef NO_OPENSSL_CLI
+/* Append s to the shell command in single quotes, with every ' written
+ * as '\'' so no character can end the string early */
+static void shell_quote(char *cmd, size_t cap, const char *s, u64 len) {
+    size_t n = strlen(cmd);
+    u64 i;
+
+    if (n + 1 < cap) cmd[n++] = '\'';
+    for (i = 0; i < len && n + 5 < cap; ++i) {
+        if (s[i] == '\'') {
+            memcpy(cmd + n, "'\\''", 4);
+            n += 4;
+        } else {
+            cmd[n++] = s[i];
+        }
+    }
+    if (n + 1 < cap) cmd[n++] = '\'';
+    cmd[n] = '\0';
+}
+
+/* Fallback reference: the openssl command-line tool, fed the text
+ * through printf or the file on standard input */
+static void openssl_cli(const struct gui_job *job, char hex[65]) {
+    char cmd[4096];
+    FILE *fp;
+
+    if (job->is_file) {
+        strcpy(cmd, "openssl dgst -sha256 -r < ");
+        shell_quote(cmd, sizeof(cmd), job->data, strlen(job->data));
+    } else {
+        strcpy(cmd, "printf '%s' ");
+        shell_quote(cmd, sizeof(cmd), job->data, job->len);
+        strncat(cmd, " | openssl dgst -sha256 -r", sizeof(cmd) - strlen(cmd) - 1);
+    }
+
+    strcpy(hex, "ERROR");
+    fp = popen(cmd, "r");
+    if (fp == NULL)
+        return;
+    if (fgets(hex, 65, fp) == NULL || strlen(hex) != 64)
+        strcpy(hex, "ERROR");
+    pclose(fp);
+}
+#endif
+
+/* Hash data with one engine, publishing progress after every chunk.
+ * Returns -1 if the job was cancelled part way. */
+static int hash_engine(struct gui_worker *w, const struct gui_job *job, enum gui_engine e,
+                       const u8 *data, u64 len, char hex[65]) {
+    struct sha256_ctx c_ctx;
+    RustSha256Ctx rust_ctx;
+    u8 digest[32];
+    u64 off = 0;
+#ifdef HAVE_OPENSSL
+    EVP_MD_CTX *md = NULL;
+    unsigned int mdlen = 0;
+#endif
+
+    switch (e) {
+    case GUI_ENGINE_C:    sha256_init(&c_ctx); break;
+    case GUI_ENGINE_RUST: rust_sha256_init(&rust_ctx); break;
+    default:
+#ifdef HAVE_OPENSSL
+        md = EVP_MD_CTX_new();
+        if (md && EVP_DigestInit_ex(md, EVP_sha256(), NULL))
+            break;
+        EVP_MD_CTX_free(md);
+#endif
+#ifndef NO_OPENSSL_CLI
+        openssl_cli(job, hex);
+#else
+        strcpy(hex, "ERROR");
+#endif
+        __atomic_store_n(&w->cur_done[e], len, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    do {
+        u64 n = len - off;
+        if (n > GUI_WORKER_CHUNK) n = GUI_WORKER_CHUNK;
+
+        switch (e) {
+        case GUI_ENGINE_C:    sha256_update64(&c_ctx, data + off, n); break;
+        case GUI_ENGINE_RUST: rust_sha256_update64(&rust_ctx, data + off, n); break;
+        default:
+#ifdef HAVE_OPENSSL
+            EVP_DigestUpdate(md, data + off, (size_t)n);
+#endif
+            break;
+        }
+        off += n;
+        __atomic_store_n(&w->cur_done[e], off, __ATOMIC_RELAXED);
+
+        if (cancelled(w, job->id)) {
+#ifdef HAVE_OPENSSL
+            EVP_MD_CTX_free(md);
+#endif
+            return -1;
+        }
+    } while (off < len);
+
+    switch (e) {
+    case GUI_ENGINE_C:
+        sha256_final(&c_ctx, digest);
+        sha256_to_hex(digest, hex);
+        break;
+    case GUI_ENGINE_RUST:
+        rust_sha256_final(&rust_ctx, digest);
+        rust_sha256_to_hex(digest, hex);
+        break;
+    default:
+#ifdef HAVE_OPENSSL
+        if (EVP_DigestFinal_ex(md, digest, &mdlen) && mdlen == 32)
+            sha256_to_hex(digest, hex);
+        else
+            strcpy(hex, "ERROR");
+        EVP_MD_CTX_free(md);
+#endif
+        break;
+    }
+    return 0;
+}
+
+/* Hash one job with every engine. Returns 0 with *res filled in, or
+ * -1 if the job was cancelled. */
+static int run_job(struct gui_worker *w, const struct gui_job *job, struct gui_result *res) {
+    struct sha256_file_data file = { (const u8 *)job->data, job->len, NULL, NULL };
+    int e, rc = 0;
+
+    memset(res, 0, sizeof(*res));
+    res->id = job->id;
+    if (job->is_file)
+        snprintf(res->name, sizeof(res->name), "%s", job->data);
+    for (e = 0; e < GUI_ENGINES; ++e)
+        strcpy(res->hex[e], "ERROR");
+
+    if (job->is_file) {
+        int fd = open(job->data, O_RDONLY);
+
+        if (fd < 0 || sha256_file_load(fd, 0, &file) != 0) {
+            res->error = errno;
+            if (fd >= 0) close(fd);
+            return 0;
+        }
+        close(fd);
+    }
+
+    res->bytes = file.len;
+    __atomic_store_n(&w->cur_total, file.len, __ATOMIC_RELAXED);
+
+    for (e = 0; e < GUI_ENGINES && rc == 0; ++e) {
+        double t0 = now_seconds();
+        rc = hash_engine(w, job, (enum gui_engine)e, file.data, file.len, res->hex[e]);
+        res->seconds[e] = now_seconds() - t0;
+    }
+
+    sha256_file_release(&file);
+    return rc;
+}
+
+static void *worker_main(void *arg) {
+    struct gui_worker *w = arg;
+
+    for (;;) {
+        struct gui_job *job;
+        struct gui_result_node *node;
+        int e;
+
+        pthread_mutex_lock(&w->lock);
+        while (!w->stop && !w->jobs)
+            pthread_cond_wait(&w->wake, &w->lock);
+        if (w->stop) {
+            pthread_mutex_unlock(&w->lock);
+            break;
+        }
+        job = w->jobs;
+        w->jobs = job->next;
+        if (!w->jobs) w->jobs_tail = NULL;
+        __atomic_store_n(&w->pending, w->pending - 1, __ATOMIC_RELAXED);
+
+        // Reset the counters before announcing the new job
+        __atomic_store_n(&w->cur_total, 0, __ATOMIC_RELAXED);
+        for (e = 0; e < GUI_ENGINES; ++e)
+            __atomic_store_n(&w->cur_done[e], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&w->cur_id, job->id, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&w->lock);
+
+        node = malloc(sizeof(*node));
+        if (node && run_job(w, job, &node->r) == 0 && !cancelled(w, job->id)) {
+            node->next = NULL;
+            pthread_mutex_lock(&w->lock);
+            if (w->results_tail) w->results_tail->next = node;
+            else                 __atomic_store_n(&w->results, node, __ATOMIC_RELEASE);
+            w->results_tail = node;
+            pthread_mutex_unlock(&w->lock);
+        } else {
+            free(node);
+        }
+
+        __atomic_store_n(&w->cur_id, 0, __ATOMIC_RELAXED);
+        free(job->data);
+        free(job);
+    }
+    return NULL;
+}
+
+int gui_worker_start(struct gui_worker *w) {
+    memset(w, 0, sizeof(*w));
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->wake, NULL);
+    if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+        pthread_cond_destroy(&w->wake);
+        pthread_mutex_destroy(&w->lock);
+        return -1;
+    }
+    return 0;
+}
+
+// Free queued jobs and undelivered results; caller holds the lock
+static void drop_queued(struct gui_worker *w) {
+    while (w->jobs) {
+        struct gui_job *next = w->jobs->next;
+        free(w->jobs->data);
+        free(w->jobs);
+        w->jobs = next;
+    }
+    w->jobs_tail = NULL;
+    __atomic_store_n(&w->pending, 0, __ATOMIC_RELAXED);
+
+    while (w->results) {
+        struct gui_result_node *next = w->results->next;
+        free(w->results);
+        __atomic_store_n(&w->results, next, __ATOMIC_RELAXED);
+    }
+    w->results_tail = NULL;
+}
+
+void gui_worker_stop(struct gui_worker *w) {
+    pthread_mutex_lock(&w->lock);
+    __atomic_store_n(&w->stop, 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    drop_queued(w);
+    pthread_cond_destroy(&w->wake);
+    pthread_mutex_destroy(&w->lock);
+}
+
+static u32 post(struct gui_worker *w, int is_file, const char *src, u64 len) {
+    struct gui_job *job = malloc(sizeof(*job));
+    u32 id;
+
+    if (!job)
+        return 0;
+    job->data = malloc(len + 1);
+    if (!job->data) {
+        free(job);
+        return 0;
+    }
+    memcpy(job->data, src, len);
+    job->data[len] = '\0';
+    job->is_file = is_file;
+    job->len = len;
+    job->next = NULL;
+
+    pthread_mutex_lock(&w->lock);
+    id = job->id = ++w->next_id;
+    if (w->jobs_tail) w->jobs_tail->next = job;
+    else              w->jobs = job;
+    w->jobs_tail = job;
+    __atomic_store_n(&w->pending, w->pending + 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+    return id;
+}
+
+u32 gui_worker_post_text(struct gui_worker *w, const char *text, u64 len) {
+    return post(w, 0, text, len);
+}
+
+u32 gui_worker_post_file(struct gui_worker *w, const char *path) {
+    return post(w, 1, path, strlen(path));
+}
+
+void gui_worker_cancel(struct gui_worker *w) {
+    pthread_mutex_lock(&w->lock);
+    __atomic_store_n(&w->cancel_upto, w->next_id, __ATOMIC_RELAXED);
+    drop_queued(w);
+    pthread_mutex_unlock(&w->lock);
+}
+
+int gui_worker_poll(struct gui_worker *w, struct gui_result *out) {
+    struct gui_result_node *node;
+
+    if (!__atomic_load_n(&w->results, __ATOMIC_ACQUIRE))
+        return 0;   // common case: nothing finished, no lock taken
+
+    pthread_mutex_lock(&w->lock);
+    node = w->results;
+    if (node) {
+        __atomic_store_n(&w->results, node->next, __ATOMIC_RELAXED);
+        if (!node->next) w->results_tail = NULL;
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    if (!node)
+        return 0;
+    *out = node->r;
+    free(node);
+    return 1;
+}
+
+void gui_worker_progress(struct gui_worker *w, struct gui_progress *out) {
+    int e;
+
+    out->id = __atomic_load_n(&w->cur_id, __ATOMIC_ACQUIRE);
+    out->total = __atomic_load_n(&w->cur_total, __ATOMIC_RELAXED);
+    for (e = 0; e < GUI_ENGINES; ++e)
+        out->done[e] = __atomic_load_n(&w->cur_done[e], __ATOMIC_RELAXED);
+    out->pending = __atomic_load_n(&w->pending, __ATOMIC_RELAXED);
+}
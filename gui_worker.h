@@ -0,0 +1,110 @@
+/* gui_worker.h
+ *
+ * Background hashing for the GUI, so the Raylib frame loop never
+ * waits for a hash.
+ *
+ * The frame loop posts jobs (a piece of text or a file path); one
+ * worker thread hashes each job with the C core, the Rust core and
+ * the OpenSSL reference in turn, and queues a result per job. While a
+ * job runs, the worker publishes how many bytes each engine has done
+ * through atomically updated counters, which the frame loop reads to
+ * draw progress bars. Nothing here touches Raylib.
+ *
+ * Typical usage (once per frame):
+ *   gui_worker_progress(&w, &p);          // draw bars
+ *   while (gui_worker_poll(&w, &r))       // show finished results
+ *       ...
+ *
+ * Needs a hosted POSIX system (threads, mmap).
+ */
+
+#ifndef GUI_WORKER_H
+#define GUI_WORKER_H
+
+#include <pthread.h>
+
+#include "sha256.h"
+
+#define GUI_WORKER_CHUNK (1u << 20)   // progress granularity in bytes
+
+// The three implementations every job is hashed with
+enum gui_engine {
+    GUI_ENGINE_C = 0,
+    GUI_ENGINE_RUST,
+    GUI_ENGINE_OPENSSL,
+    GUI_ENGINES
+};
+
+// A finished job
+struct gui_result {
+    u32 id;                           // from gui_worker_post_*()
+    int error;                        // errno if the input could not be read, else 0
+    u64 bytes;                        // input length
+    char hex[GUI_ENGINES][65];        // digest per engine ("ERROR" if unavailable)
+    double seconds[GUI_ENGINES];      // time spent per engine
+    char name[256];                   // file path, or "" for text
+};
+
+// Snapshot of the running job, see gui_worker_progress()
+struct gui_progress {
+    u32 id;                           // running job, 0 when idle
+    u64 total;                        // bytes to hash per engine
+    u64 done[GUI_ENGINES];            // bytes hashed so far per engine
+    u32 pending;                      // jobs waiting behind it
+};
+
+struct gui_job;
+struct gui_result_node;
+
+struct gui_worker {
+    pthread_t thread;
+    pthread_mutex_t lock;             // guards the two queues and next_id
+    pthread_cond_t wake;              // signalled when a job is posted or on stop
+    struct gui_job *jobs, *jobs_tail;
+    struct gui_result_node *results, *results_tail;
+    u32 next_id;
+    u32 pending;
+    int stop;
+
+    // Written by the worker, read by the frame loop (atomics)
+    u32 cur_id;
+    u64 cur_total;
+    u64 cur_done[GUI_ENGINES];
+    u32 cancel_upto;                  // jobs with id <= this are abandoned
+};
+
+/* gui_worker_start()
+ * Start the worker thread. Returns 0, or -1 if it could not be created.
+ */
+int gui_worker_start(struct gui_worker *w);
+
+/* gui_worker_stop()
+ * Abandon all jobs, join the thread and free everything still queued.
+ */
+void gui_worker_stop(struct gui_worker *w);
+
+/* gui_worker_post_text() / gui_worker_post_file()
+ * Queue a job; the text or path is copied. Returns the job id (never
+ * 0), or 0 if memory ran out.
+ */
+u32 gui_worker_post_text(struct gui_worker *w, const char *text, u64 len);
+u32 gui_worker_post_file(struct gui_worker *w, const char *path);
+
+/* gui_worker_cancel()
+ * Abandon the running job and every queued one. Their results are
+ * never delivered.
+ */
+void gui_worker_cancel(struct gui_worker *w);
+
+/* gui_worker_poll()
+ * Take the oldest finished result without blocking. Returns 1 if
+ * *out was filled, 0 if nothing is ready.
+ */
+int gui_worker_poll(struct gui_worker *w, struct gui_result *out);
+
+/* gui_worker_progress()
+ * Read the running job's counters without blocking the worker.
+ */
+void gui_worker_progress(struct gui_worker *w, struct gui_progress *out);
+
+#endif
@@ -2,41 +2,151 @@
 #include <string.h>
 #include <stdlib.h>
 #include "sha256.h"       // Must come before raylib to define types
+#include "gui_worker.h"   // Background C / Rust / OpenSSL hashing
+#include "gui_batch.h"    // Directory / manifest verification on a thread pool
+#include "sha256_stats.h" // Core counters in STATS=1 builds
 #include "raylib.h"
 
-// External Rust functions
-typedef struct {
-    unsigned int h[8];
-    unsigned char buffer[64];
-    unsigned int buflen;
-    unsigned long long bitlen;
-} RustSha256Ctx;
-
-extern void rust_sha256_init(RustSha256Ctx *ctx);
-extern void rust_sha256_update(RustSha256Ctx *ctx, const unsigned char *data, unsigned int len);
-extern void rust_sha256_final(RustSha256Ctx *ctx, unsigned char out_hash32[32]);
-extern void rust_sha256_to_hex(const unsigned char hash32[32], char hex_out[65]);
-
-// Use system OpenSSL CLI to compute SHA-256
-void run_openssl_sha256(const char *input, char *openssl_output) {
-    char command[2048];
-    snprintf(command, sizeof(command), "echo -n '%s' | openssl dgst -sha256 | awk '{print $2}'", input);
-
-    FILE *fp = popen(command, "r");
-    if (fp == NULL) {
-        strcpy(openssl_output, "ERROR");
+#define MAX_INPUT_LEN 256
+
+// STATS=1 builds keep two lines at the bottom for the core counters
+#ifdef SHA256_STATS
+#define STATS_TOP   (700 - 44)
+#else
+#define STATS_TOP   700
+#endif
+
+// Batch results list: rows between LIST_TOP and the counters / bottom
+#define LIST_TOP    235
+#define ROW_HEIGHT  20
+#define LIST_ROWS   ((STATS_TOP - LIST_TOP - 10) / ROW_HEIGHT)
+
+// One bar per engine: label, fraction done, bytes done of total
+static void draw_progress(const char *label, int y, u64 done, u64 total, Color color) {
+    float frac = total ? (float)done / (float)total : 0.0f;
+    if (frac > 1.0f) frac = 1.0f;
+
+    DrawText(label, 50, y, 20, DARKGRAY);
+    DrawRectangleLines(180, y - 2, 600, 24, GRAY);
+    DrawRectangle(182, y, (int)(596 * frac), 20, color);
+    DrawText(TextFormat("%3d%%  %.1f / %.1f MB", (int)(frac * 100.0f),
+                        (double)done / 1e6, (double)total / 1e6), 800, y, 18, DARKGRAY);
+}
+
+// Throughput line under each digest, e.g. "1.234 s, 812.5 MB/s"
+static const char *speed_text(u64 bytes, double secs) {
+    if (secs <= 0 || bytes < (1u << 20))
+        return "";
+    return TextFormat("%.3f s, %.1f MB/s", secs, (double)bytes / secs / 1e6);
+}
+
+// "12.3 MB" style size for a results row
+static const char *size_text(u64 bytes) {
+    if (bytes >= 1000000000ull) return TextFormat("%.1f GB", (double)bytes / 1e9);
+    if (bytes >= 1000000ull)    return TextFormat("%.1f MB", (double)bytes / 1e6);
+    if (bytes >= 1000ull)       return TextFormat("%.1f kB", (double)bytes / 1e3);
+    return TextFormat("%llu B", (unsigned long long)bytes);
+}
+
+// One engine column of a results row
+static void draw_mark(int x, int y, int known, int ok) {
+    if (!known)
+        DrawText("-", x, y, 16, GRAY);
+    else
+        DrawText(ok ? "ok" : "BAD", x, y, 16, ok ? DARKGREEN : RED);
+}
+
+/* Batch view: status line, progress bar and the rows from first on.
+ * Only the LIST_ROWS visible rows are copied out and drawn, so a frame
+ * costs the same at 100 rows or 100k. */
+static void draw_batch(struct gui_batch *batch, u32 first) {
+    struct gui_batch_status s;
+    struct gui_batch_row row;
+    u32 i;
+
+    gui_batch_status(batch, &s);
+
+    if (s.phase == GUI_BATCH_LISTING) {
+        DrawText(TextFormat("Scanning... %u files", s.rows), 50, 130, 22, DARKBLUE);
         return;
     }
-    if (fgets(openssl_output, 65, fp) == NULL) {
-        strcpy(openssl_output, "ERROR");
+
+    double secs = s.seconds > 0 ? s.seconds : 1e-9;
+    DrawText(TextFormat("%s %u / %u files, %u failed", s.phase == GUI_BATCH_DONE ? "Verified" : "Verifying",
+                        s.done, s.rows, s.failed),
+             50, 130, 22, s.failed ? RED : (s.phase == GUI_BATCH_DONE ? DARKGREEN : DARKBLUE));
+    DrawText(TextFormat("%.1f MB/s, %.0f files/s, %u threads, reference: %s",
+                        (double)s.bytes_done / secs / 1e6, (double)s.done / secs, s.threads, s.reference),
+             50, 158, 18, GRAY);
+    draw_progress("Progress:", 185, s.bytes_done, s.bytes_total, DARKBLUE);
+
+    DrawText("#", 50, LIST_TOP - 20, 16, DARKGRAY);
+    DrawText("Result", 115, LIST_TOP - 20, 16, DARKGRAY);
+    DrawText("C", 185, LIST_TOP - 20, 16, DARKGRAY);
+    DrawText("Rust", 225, LIST_TOP - 20, 16, DARKGRAY);
+    DrawText("Ref", 275, LIST_TOP - 20, 16, DARKGRAY);
+    DrawText("List", 320, LIST_TOP - 20, 16, DARKGRAY);
+    DrawText("Size", 370, LIST_TOP - 20, 16, DARKGRAY);
+    DrawText("File", 460, LIST_TOP - 20, 16, DARKGRAY);
+
+    for (i = 0; i < LIST_ROWS && first + i < s.rows; ++i) {
+        int y = LIST_TOP + (int)i * ROW_HEIGHT;
+        const char *path;
+        size_t len;
+
+        if (!gui_batch_row(batch, first + i, &row))
+            break;
+        path = gui_batch_path(batch, &row);
+        len = strlen(path);
+
+        if (i % 2)
+            DrawRectangle(45, y - 2, 910, ROW_HEIGHT, (Color){ 240, 240, 240, 255 });
+        DrawText(TextFormat("%u", first + i + 1), 50, y, 16, GRAY);
+
+        switch (row.state) {
+        case GUI_ROW_PASS:  DrawText("PASS", 115, y, 16, DARKGREEN); break;
+        case GUI_ROW_FAIL:  DrawText("FAIL", 115, y, 16, RED); break;
+        case GUI_ROW_ERROR: DrawText("ERROR", 115, y, 16, RED); break;
+        default:            DrawText("...", 115, y, 16, GRAY); break;
+        }
+
+        if (row.state == GUI_ROW_ERROR) {
+            DrawText(strerror(row.error), 185, y, 16, RED);
+        } else if (row.state != GUI_ROW_PENDING) {
+            int has_ref = (row.flags & GUI_ROW_HAS_REF) != 0;
+            draw_mark(185, y, has_ref, row.flags & GUI_ROW_C_OK);
+            draw_mark(225, y, 1, row.flags & GUI_ROW_RUST_OK);
+            draw_mark(275, y, has_ref, 1);
+            draw_mark(320, y, row.flags & GUI_ROW_LISTED, row.flags & GUI_ROW_LISTED_OK);
+        }
+        DrawText(size_text(row.bytes), 370, y, 16, DARKGRAY);
+
+        // Keep the end of long paths, which is the part that differs
+        DrawText(len > 54 ? TextFormat("...%s", path + len - 51) : path, 460, y, 16, BLACK);
     }
-    pclose(fp);
 
-    // Trim newline if present
-    openssl_output[strcspn(openssl_output, "\n")] = '\0';
+    if (s.rows > LIST_ROWS)
+        DrawText(TextFormat("rows %u-%u of %u (wheel, PgUp/PgDn, Home/End)", first + 1,
+                            first + i, s.rows), 600, 134, 16, GRAY);
 }
 
-#define MAX_INPUT 256
+// One line per core: hot-path counters summed over every thread
+static void draw_core_stats(void) {
+    static const char *const name[SHA256_STATS_ENGINES] = { "C", "Rust" };
+    u32 e;
+
+    for (e = 0; e < SHA256_STATS_ENGINES; ++e) {
+        struct sha256_stats s;
+
+        sha256_stats_get((enum sha256_stats_engine)e, &s);
+        DrawText(TextFormat("%-4s update %llu calls, %s, %llu buffered | %llu blocks, %.0f cycles/block | final %llu",
+                            name[e], (unsigned long long)s.update_calls, size_text(s.update_bytes),
+                            (unsigned long long)s.buffer_fills, (unsigned long long)s.blocks,
+                            s.blocks ? (double)s.compress_cycles / (double)s.blocks : 0.0,
+                            (unsigned long long)s.final_calls),
+                 50, STATS_TOP + 2 + 20 * (int)e, 16, GRAY);
+    }
+}
 
 int main(void) {
     const int screenWidth = 1000;
@@ -44,7 +154,7 @@ int main(void) {
 
     InitWindow(screenWidth, screenHeight, "SHA-256 Checker: C vs Rust vs OpenSSL");
 
-    char inputText[MAX_INPUT] = {0};
+    char inputText[MAX_INPUT_LEN] = {0};
     int letterCount = 0;
 
     bool checkPressed = false;
@@ -54,10 +164,24 @@ int main(void) {
     char cVsOpensslMsg[128] = {0};
     char rustVsOpensslMsg[128] = {0};
 
-    struct sha256_ctx c_ctx;
-    RustSha256Ctx rust_ctx;
-    unsigned char c_digest[32];
-    unsigned char rust_digest[32];
+    // Hashing runs on a worker thread; the loop below only posts jobs
+    // and picks up results, so it never misses a frame
+    struct gui_worker worker;
+    struct gui_result result = { 0 };
+    struct gui_progress progress;
+    u32 currentJob = 0;     // job whose result we are waiting for
+
+    // Dropping a directory, a manifest or several files verifies them
+    // all in the background instead; the list view replaces the digests
+    struct gui_batch batch = { 0 };
+    bool batchMode = false;
+    int batchFirst = 0;     // first visible row
+
+    if (gui_worker_start(&worker) != 0) {
+        fprintf(stderr, "sha256_checker: cannot start hashing thread\n");
+        CloseWindow();
+        return 1;
+    }
 
     SetTargetFPS(60);
 
@@ -65,7 +189,7 @@ int main(void) {
         // Handle text input
         int key = GetCharPressed();
         while (key > 0) {
-            if ((key >= 32) && (key <= 125) && (letterCount < MAX_INPUT - 1)) {
+            if ((key >= 32) && (key <= 125) && (letterCount < MAX_INPUT_LEN - 1)) {
                 inputText[letterCount] = (char)key;
                 inputText[letterCount + 1] = '\0';
                 letterCount++;
@@ -83,21 +207,62 @@ int main(void) {
         // Check button or Enter key
         if (IsKeyPressed(KEY_ENTER) || (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) &&
             CheckCollisionPointRec(GetMousePosition(), (Rectangle){ 800, 50, 150, 40 }))) {
-            
-            // Compute using C SHA-256
-            sha256_init(&c_ctx);
-            sha256_update(&c_ctx, (const u8 *)inputText, strlen(inputText));
-            sha256_final(&c_ctx, c_digest);
-            sha256_to_hex(c_digest, cHash);
 
-            // Compute using Rust SHA-256
-            rust_sha256_init(&rust_ctx);
-            rust_sha256_update(&rust_ctx, (const unsigned char *)inputText, strlen(inputText));
-            rust_sha256_final(&rust_ctx, rust_digest);
-            rust_sha256_to_hex(rust_digest, rustHash);
+            // A new check replaces whatever is still running
+            gui_worker_cancel(&worker);
+            gui_batch_stop(&batch);
+            batchMode = false;
+            currentJob = gui_worker_post_text(&worker, inputText, strlen(inputText));
+            checkPressed = false;
+        }
+
+        // Dropping a file onto the window hashes the file instead
+        if (IsFileDropped()) {
+            FilePathList dropped = LoadDroppedFiles();
+            if (dropped.count > 0) {
+                gui_worker_cancel(&worker);
+                gui_batch_stop(&batch);
+                checkPressed = false;
+                batchMode = dropped.count > 1 || DirectoryExists(dropped.paths[0]) ||
+                            gui_batch_is_manifest(dropped.paths[0]);
+                if (batchMode) {
+                    batchFirst = 0;
+                    if (gui_batch_start(&batch, (const char *const *)dropped.paths, dropped.count, 0) != 0)
+                        batchMode = false;
+                } else {
+                    currentJob = gui_worker_post_file(&worker, dropped.paths[0]);
+                }
+            }
+            UnloadDroppedFiles(dropped);
+        }
+
+        // Scrolling the batch list
+        if (batchMode) {
+            struct gui_batch_status bs;
+            int last;
 
-            // Compute using system OpenSSL
-            run_openssl_sha256(inputText, opensslHash);
+            gui_batch_status(&batch, &bs);
+            last = bs.rows > LIST_ROWS ? (int)(bs.rows - LIST_ROWS) : 0;
+            batchFirst -= (int)(GetMouseWheelMove() * 3.0f);
+            if (IsKeyPressed(KEY_PAGE_DOWN)) batchFirst += LIST_ROWS;
+            if (IsKeyPressed(KEY_PAGE_UP))   batchFirst -= LIST_ROWS;
+            if (IsKeyPressed(KEY_HOME))      batchFirst = 0;
+            if (IsKeyPressed(KEY_END))       batchFirst = last;
+            if (batchFirst > last) batchFirst = last;
+            if (batchFirst < 0)    batchFirst = 0;
+        }
+
+        // Pick up finished results; stale ones are ignored
+        struct gui_result r;
+        while (gui_worker_poll(&worker, &r)) {
+            if (r.id != currentJob)
+                continue;
+            result = r;
+            currentJob = 0;
+
+            strcpy(cHash, result.hex[GUI_ENGINE_C]);
+            strcpy(rustHash, result.hex[GUI_ENGINE_RUST]);
+            strcpy(opensslHash, result.hex[GUI_ENGINE_OPENSSL]);
 
             // Compare C vs OpenSSL
             if (strcmp(cHash, opensslHash) == 0) {
@@ -116,6 +281,8 @@ int main(void) {
             checkPressed = true;
         }
 
+        gui_worker_progress(&worker, &progress);
+
         BeginDrawing();
         ClearBackground(RAYWHITE);
 
@@ -134,20 +301,47 @@ int main(void) {
         DrawRectangleLines(800, 50, 150, 40, GRAY);
         DrawText("Check Hash", 815, 60, 20, BLACK);
 
-        if (checkPressed) {
+        if (batchMode)
+            DrawText("Batch: type text and press Enter to go back", 190, 100, 16, GRAY);
+        else if (checkPressed && result.name[0] != '\0')
+            DrawText(TextFormat("File: %s (%llu bytes)", result.name,
+                                (unsigned long long)result.bytes), 190, 100, 16, DARKGRAY);
+        else
+            DrawText("or drop a file, a folder or a .sha256 manifest onto the window", 190, 100, 16, GRAY);
+
+        if (batchMode) {
+            draw_batch(&batch, (u32)batchFirst);
+        } else if (currentJob != 0) {
+            int yPos = 150;
+
+            if (progress.id == currentJob) {
+                DrawText("Hashing...", 50, yPos, 24, DARKBLUE);
+                draw_progress("C:", yPos + 50, progress.done[GUI_ENGINE_C], progress.total, DARKBLUE);
+                draw_progress("Rust:", yPos + 90, progress.done[GUI_ENGINE_RUST], progress.total, MAROON);
+                draw_progress("OpenSSL:", yPos + 130, progress.done[GUI_ENGINE_OPENSSL], progress.total, DARKGREEN);
+            } else {
+                DrawText("Waiting for the worker...", 50, yPos, 24, DARKBLUE);
+            }
+        } else if (checkPressed && result.error != 0) {
+            DrawText(TextFormat("Cannot read %s: %s", result.name, strerror(result.error)),
+                     50, 150, 20, RED);
+        } else if (checkPressed) {
             int yPos = 130;
-            
+
             // C Implementation
             DrawText("C SHA-256:", 50, yPos, 20, DARKGRAY);
             DrawText(cHash, 50, yPos + 30, 18, BLACK);
-            
+            DrawText(speed_text(result.bytes, result.seconds[GUI_ENGINE_C]), 750, yPos, 18, GRAY);
+
             // Rust Implementation
             DrawText("Rust SHA-256:", 50, yPos + 80, 20, DARKGRAY);
             DrawText(rustHash, 50, yPos + 110, 18, MAROON);
+            DrawText(speed_text(result.bytes, result.seconds[GUI_ENGINE_RUST]), 750, yPos + 80, 18, GRAY);
 
             // OpenSSL Reference
             DrawText("OpenSSL SHA-256 (Reference):", 50, yPos + 160, 20, DARKGRAY);
             DrawText(opensslHash, 50, yPos + 190, 18, DARKGREEN);
+            DrawText(speed_text(result.bytes, result.seconds[GUI_ENGINE_OPENSSL]), 750, yPos + 160, 18, GRAY);
 
             // Comparison results
             DrawText("Verification Results:", 50, yPos + 260, 24, DARKBLUE);
@@ -166,9 +360,14 @@ int main(void) {
             }
         }
 
+        if (sha256_stats_enabled())
+            draw_core_stats();
+
         EndDrawing();
     }
 
+    gui_batch_stop(&batch);
+    gui_worker_stop(&worker);
     CloseWindow();
     return 0;
 }
\ No newline at end of file
@@ -1,93 +1,291 @@
-#include "sha256.h"
-
-// rotate-right: rotates the bits of x to the right by n positions 
-static inline u32 rotr(u32 x, u32 n) {
-    return (x >> n) | (x << (32 - n));
-}
-
-// SHA-256 logical functions (as defined in the FIPS-180-4 standard)
-#define CH(x,y,z)  ((x & y) ^ (~x & z))        // choose: picks y or z based on x
-#define MAJ(x,y,z) ((x & y) ^ (x & z) ^ (y & z)) // majority: majority vote among x,y,z
-#define BSIG0(x)   (rotr(x,2) ^ rotr(x,13) ^ rotr(x,22)) // big sigma 0
-#define BSIG1(x)   (rotr(x,6) ^ rotr(x,11) ^ rotr(x,25)) // big sigma 1
-#define SSIG0(x)   (rotr(x,7) ^ rotr(x,18) ^ (x >> 3))   // small sigma 0
-#define SSIG1(x)   (rotr(x,17) ^ rotr(x,19) ^ (x >> 10)) // small sigma 1
-
-// Round constants: first 32 bits of cube roots of first 64 primes 
-static const u32 K[64] = {
-  0x428a2f98u,0x71374491u,0xb5c0fbcfu,0xe9b5dba5u,
-  0x3956c25bu,0x59f111f1u,0x923f82a4u,0xab1c5ed5u,
-  0xd807aa98u,0x12835b01u,0x243185beu,0x550c7dc3u,
-  0x72be5d74u,0x80deb1feu,0x9bdc06a7u,0xc19bf174u,
-  0xe49b69c1u,0xefbe4786u,0x0fc19dc6u,0x240ca1ccu,
-  0x2de92c6fu,0x4a7484aau,0x5cb0a9dcu,0x76f988dau,
-  0x983e5152u,0xa831c66du,0xb00327c8u,0xbf597fc7u,
-  0xc6e00bf3u,0xd5a79147u,0x06ca6351u,0x14292967u,
-  0x27b70a85u,0x2e1b2138u,0x4d2c6dfcu,0x53380d13u,
-  0x650a7354u,0x766a0abbu,0x81c2c92eu,0x92722c85u,
-  0xa2bfe8a1u,0xa81a664bu,0xc24b8b70u,0xc76c51a3u,
-  0xd192e819u,0xd6990624u,0xf40e3585u,0x106aa070u,
-  0x19a4c116u,0x1e376c08u,0x2748774cu,0x34b0bcb5u,
-  0x391c0cb3u,0x4ed8aa4au,0x5b9cca4fu,0x682e6ff3u,
-  0x748f82eeu,0x78a5636fu,0x84c87814u,0x8cc70208u,
-  0x90befffau,0xa4506cebu,0xbef9a3f7u,0xc67178f2u
-};
+#include "sha256_internal.h"
+#include "sha256_consts.h"
+#include "sha256_stats.h"
+
+// Round constants (values in sha256_consts.h)
+const u32 sha256_K[64] = { SHA256_K_VALUES };
 
-/* Process one 512-bit (64-byte) block of input.
+// Initial hash values of SHA-256 and SHA-224
+const u32 sha256_iv[8] = { SHA256_H0_VALUES };
+const u32 sha224_iv[8] = { SHA224_H0_VALUES };
+
+/* Process 512-bit (64-byte) blocks of input.
  * This is the "heart" of SHA-256, where the compression function runs.
  * If we mess up here it's going to break everything.
+ * Portable version; used when the CPU has no SHA instructions.
+ * The running state stays in locals for the whole run of blocks.
+ *
+ * Two builds of it:
+ * - default: fully unrolled rounds over a 16-word rolling schedule,
+ *   with the working variables renamed per round instead of moved
+ * - SHA256_SMALL: the compact rolled loop with a 64-word schedule,
+ *   for size-constrained builds
  */
-static void sha256_transform(struct sha256_ctx *ctx, const u8 block[64]) {
+#ifdef SHA256_SMALL
+static void sha256_compress_scalar(u32 state[8], const u8 *data, u64 nblocks) {
     u32 W[64];      // message schedule array
+    u32 H[8];       // running hash state
     u32 a,b,c,d,e,f,g,h; // working variables
     u32 t1, t2;
     u32 i;
 
-    // Step 1: Prepare the message schedule W[0..63]
-    for (i = 0; i < 16; ++i) {
+    for (i = 0; i < 8; ++i) H[i] = state[i];
+
+    while (nblocks--) {
+        // Step 1: Prepare the message schedule W[0..63]
+        // Convert 4 bytes from input block into a 32-bit word (big-endian)
+        if (sha256_aligned4(data)) {
+            for (i = 0; i < 16; ++i) W[i] = load_be32_aligned(&data[i * 4]);
+        } else {
+            for (i = 0; i < 16; ++i) W[i] = load_be32(&data[i * 4]);
+        }
+        // Extend first 16 words into remaining 48 words
+        for (i = 16; i < 64; ++i) {
+            W[i] = SSIG1(W[i-2]) + W[i-7] + SSIG0(W[i-15]) + W[i-16];
+        }
+
+        // Step 2: Initialize working variables with current hash state
+        a = H[0];
+        b = H[1];
+        c = H[2];
+        d = H[3];
+        e = H[4];
+        f = H[5];
+        g = H[6];
+        h = H[7];
+
+        // Step 3: Main compression loop (64 rounds)
+        for (i = 0; i < 64; ++i) {
+            t1 = h + BSIG1(e) + CH(e,f,g) + sha256_K[i] + W[i];
+            t2 = BSIG0(a) + MAJ(a,b,c);
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        // Step 4: Add this block's hash to the cumulative state
+        H[0] += a;
+        H[1] += b;
+        H[2] += c;
+        H[3] += d;
+        H[4] += e;
+        H[5] += f;
+        H[6] += g;
+        H[7] += h;
+
+        data += 64;
+    }
+
+    for (i = 0; i < 8; ++i) state[i] = H[i];
+}
+
+#else
+
+/* One round, with no register moves: the caller rotates the argument
+ * names instead, so the new "a" lands in h and the new "e" in d. */
+#define RND(a,b,c,d,e,f,g,h,i) do {                                  \
+    t1 = h + BSIG1(e) + CH(e,f,g) + sha256_K[i] + W[(i) & 15];       \
+    d += t1;                                                         \
+    h = t1 + BSIG0(a) + MAJ(a,b,c);                                  \
+} while (0)
+
+// Next schedule word, computed in place in the 16-word ring
+#define SCHED(i) \
+    (W[(i) & 15] += SSIG1(W[((i) - 2) & 15]) + W[((i) - 7) & 15] + SSIG0(W[((i) - 15) & 15]))
+
+// Eight rounds bring every name back to where it started
+#define RND8(i) do {                                                 \
+    RND(a,b,c,d,e,f,g,h,(i) + 0);                                    \
+    RND(h,a,b,c,d,e,f,g,(i) + 1);                                    \
+    RND(g,h,a,b,c,d,e,f,(i) + 2);                                    \
+    RND(f,g,h,a,b,c,d,e,(i) + 3);                                    \
+    RND(e,f,g,h,a,b,c,d,(i) + 4);                                    \
+    RND(d,e,f,g,h,a,b,c,(i) + 5);                                    \
+    RND(c,d,e,f,g,h,a,b,(i) + 6);                                    \
+    RND(b,c,d,e,f,g,h,a,(i) + 7);                                    \
+} while (0)
+
+#define SCHED8(i) do {                                               \
+    SCHED((i) + 0); SCHED((i) + 1); SCHED((i) + 2); SCHED((i) + 3);  \
+    SCHED((i) + 4); SCHED((i) + 5); SCHED((i) + 6); SCHED((i) + 7);  \
+} while (0)
+
+static void sha256_compress_scalar(u32 state[8], const u8 *data, u64 nblocks) {
+    u32 W[16];      // rolling message schedule
+    u32 H[8];       // running hash state
+    u32 a,b,c,d,e,f,g,h; // working variables
+    u32 t1;
+    u32 i;
+
+    for (i = 0; i < 8; ++i) H[i] = state[i];
+
+    while (nblocks--) {
         // Convert 4 bytes from input block into a 32-bit word (big-endian)
-        u32 j = i * 4;
-        W[i] = ((u32)block[j] << 24) | ((u32)block[j+1] << 16)
-             | ((u32)block[j+2] << 8) | ((u32)block[j+3]);
-    }
-    // Extend first 16 words into remaining 48 words
-    for (i = 16; i < 64; ++i) {
-        W[i] = SSIG1(W[i-2]) + W[i-7] + SSIG0(W[i-15]) + W[i-16];
-    }
-
-    // Step 2: Initialize working variables with current hash state
-    a = ctx->h[0];
-    b = ctx->h[1];
-    c = ctx->h[2];
-    d = ctx->h[3];
-    e = ctx->h[4];
-    f = ctx->h[5];
-    g = ctx->h[6];
-    h = ctx->h[7];
-
-    // Step 3: Main compression loop (64 rounds)
-    for (i = 0; i < 64; ++i) {
-        t1 = h + BSIG1(e) + CH(e,f,g) + K[i] + W[i];
-        t2 = BSIG0(a) + MAJ(a,b,c);
-        h = g;
-        g = f;
-        f = e;
-        e = d + t1;
-        d = c;
-        c = b;
-        b = a;
-        a = t1 + t2;
-    }
-
-    // Step 4: Add this block's hash to the cumulative state
-    ctx->h[0] += a;
-    ctx->h[1] += b;
-    ctx->h[2] += c;
-    ctx->h[3] += d;
-    ctx->h[4] += e;
-    ctx->h[5] += f;
-    ctx->h[6] += g;
-    ctx->h[7] += h;
+        if (sha256_aligned4(data)) {
+            for (i = 0; i < 16; ++i) W[i] = load_be32_aligned(&data[i * 4]);
+        } else {
+            for (i = 0; i < 16; ++i) W[i] = load_be32(&data[i * 4]);
+        }
+
+        a = H[0];
+        b = H[1];
+        c = H[2];
+        d = H[3];
+        e = H[4];
+        f = H[5];
+        g = H[6];
+        h = H[7];
+
+        // Rounds 0..15 use the block words as loaded
+        RND8(0);
+        RND8(8);
+
+        // Rounds 16..63 extend the schedule 8 words at a time, then use them
+        SCHED8(16); RND8(16);
+        SCHED8(24); RND8(24);
+        SCHED8(32); RND8(32);
+        SCHED8(40); RND8(40);
+        SCHED8(48); RND8(48);
+        SCHED8(56); RND8(56);
+
+        H[0] += a;
+        H[1] += b;
+        H[2] += c;
+        H[3] += d;
+        H[4] += e;
+        H[5] += f;
+        H[6] += g;
+        H[7] += h;
+
+        data += 64;
+    }
+
+    for (i = 0; i < 8; ++i) state[i] = H[i];
+}
+
+#undef RND
+#undef SCHED
+#undef RND8
+#undef SCHED8
+
+#endif
+
+/*
+ * Backend dispatch.
+ * sha256_compress starts out pointing at sha256_compress_auto, which
+ * probes the CPU on the first block, swaps the pointer for the best
+ * backend and forwards the call. After that every run of blocks is a
+ * single indirect call with no further checks.
+ */
+static void sha256_compress_auto(u32 state[8], const u8 *data, u64 nblocks);
+
+static sha256_compress_fn sha256_compress = sha256_compress_auto;
+static enum sha256_backend sha256_active = SHA256_BACKEND_AUTO;
+
+/* Both are read and written with relaxed atomics: the first blocks
+ * may be hashed on several threads at once, each resolving the same
+ * backend, and a plain word access would be a data race. On every
+ * target this builds for a relaxed access is an ordinary load or
+ * store. */
+static inline sha256_compress_fn compress_fn(void) {
+    return __atomic_load_n(&sha256_compress, __ATOMIC_RELAXED);
+}
+
+static inline enum sha256_backend active_backend(void) {
+    return __atomic_load_n(&sha256_active, __ATOMIC_RELAXED);
+}
+
+static void sha256_compress_auto(u32 state[8], const u8 *data, u64 nblocks) {
+    sha256_use_backend(SHA256_BACKEND_AUTO);
+    compress_fn()(state, data, nblocks);
+}
+
+// Best backend this CPU can run
+static enum sha256_backend sha256_detect_backend(void) {
+#ifdef SHA256_HAVE_ARMV8
+    return SHA256_BACKEND_ARMV8;
+#else
+#ifdef SHA256_HAVE_SHANI
+    if (sha256_cpu_has_shani())
+        return SHA256_BACKEND_SHANI;
+#endif
+    return SHA256_BACKEND_SCALAR;
+#endif
+}
+
+int sha256_use_backend(enum sha256_backend backend) {
+    sha256_compress_fn fn;
+
+    if (backend == SHA256_BACKEND_AUTO)
+        backend = sha256_detect_backend();
+
+    switch (backend) {
+    case SHA256_BACKEND_SCALAR:
+        fn = sha256_compress_scalar;
+        break;
+#ifdef SHA256_HAVE_SHANI
+    case SHA256_BACKEND_SHANI:
+        if (!sha256_cpu_has_shani())
+            return -1;
+        fn = sha256_compress_shani;
+        break;
+#endif
+#ifdef SHA256_HAVE_ARMV8
+    case SHA256_BACKEND_ARMV8:
+        fn = sha256_compress_armv8;
+        break;
+#endif
+    default:
+        return -1; // not built in, or not supported by this CPU
+    }
+
+    __atomic_store_n(&sha256_compress, fn, __ATOMIC_RELAXED);
+    __atomic_store_n(&sha256_active, backend, __ATOMIC_RELAXED);
+    return 0;
+}
+
+enum sha256_backend sha256_active_backend(void) {
+    if (active_backend() == SHA256_BACKEND_AUTO)
+        sha256_use_backend(SHA256_BACKEND_AUTO);
+    return active_backend();
+}
+
+const char *sha256_backend_name(void) {
+    switch (sha256_active_backend()) {
+    case SHA256_BACKEND_SHANI: return "sha-ni";
+    case SHA256_BACKEND_ARMV8: return "armv8-sha2";
+    default:                   return "scalar";
+    }
+}
+
+/* Run whole blocks through whichever backend is active. Every
+ * compression in this file comes through here, so SHA256_STATS builds
+ * count and time them in one place. */
+static inline void sha256_blocks(u32 h[8], const u8 *data, u64 nblocks) {
+    SHA256_STATS_START(t0);
+    compress_fn()(h, data, nblocks);
+    SHA256_STATS_ADD(SHA256_STATS_C, compress_calls, 1);
+    SHA256_STATS_ADD(SHA256_STATS_C, blocks, nblocks);
+    SHA256_STATS_STOP(SHA256_STATS_C, compress_cycles, t0);
+}
+
+// Run one block through whichever backend is active
+static void sha256_transform(struct sha256_ctx *ctx, const u8 block[64]) {
+    sha256_blocks(ctx->h, block, 1);
+}
+
+void sha256_compress_blocks(u32 h[8], const u8 *data, u64 nblocks) {
+    sha256_blocks(h, data, nblocks);
+}
+
+void sha256_transform_blocks(struct sha256_ctx *ctx, const u8 *data, u64 nblocks) {
+    ctx->bitlen += nblocks * 512ull;
+    sha256_blocks(ctx->h, data, nblocks);
 }
 
 // Initialize SHA-256 context with standard initial hash values
@@ -105,10 +303,18 @@ void sha256_init(struct sha256_ctx *ctx) {
     ctx->bitlen = 0;  // processed length = 0
 }
 
-// Byte copy (manual memcpy replacement)
-static void memcopy_bytes(u8 *dst, const u8 *src, u32 n) {
+// Same, from any initial hash value (SHA-224 and friends)
+void sha256_init_iv(struct sha256_ctx *ctx, const u32 iv[8]) {
     u32 i;
-    for (i = 0; i < n; ++i) dst[i] = src[i];
+
+    for (i = 0; i < 8; ++i)
+        ctx->h[i] = iv[i];
+    ctx->buflen = 0;
+    ctx->bitlen = 0;
+}
+
+void sha224_init(struct sha256_ctx *ctx) {
+    sha256_init_iv(ctx, sha224_iv);
 }
 
 /*
@@ -116,19 +322,37 @@ static void memcopy_bytes(u8 *dst, const u8 *src, u32 n) {
  * Buffers input, processes full 64-byte blocks.
  */
 void sha256_update(struct sha256_ctx *ctx, const u8 *data, u32 len) {
-    u32 i = 0;
+    sha256_update64(ctx, data, len);
+}
 
-    ctx->bitlen += ((u64)len) * 8ull; // track total length in bits
+/*
+ * Same as sha256_update, for inputs of any size.
+ * Whole blocks are compressed straight from data in one backend call;
+ * only the partial blocks at either end go through ctx->buffer.
+ */
+void sha256_update64(struct sha256_ctx *ctx, const u8 *data, u64 len) {
+    u64 i = 0;
+    u64 nblocks;
+    SHA256_STATS_START(t0);
+
+    SHA256_STATS_ADD(SHA256_STATS_C, update_calls, 1);
+    SHA256_STATS_ADD(SHA256_STATS_C, update_bytes, len);
+    ctx->bitlen += len * 8ull; // track total length in bits
 
     // If buffer already has data, try to fill it to 64 bytes
     if (ctx->buflen > 0) {
         u32 need = 64 - ctx->buflen;
         if (len < need) {
-            memcopy_bytes(&ctx->buffer[ctx->buflen], data, len);
-            ctx->buflen += len;
+            memcopy_bytes(&ctx->buffer[ctx->buflen], data, (u32)len);
+            ctx->buflen += (u32)len;
+            SHA256_STATS_ADD(SHA256_STATS_C, buffer_fills, 1);
+            SHA256_STATS_ADD(SHA256_STATS_C, buffer_bytes, len);
+            SHA256_STATS_STOP(SHA256_STATS_C, update_cycles, t0);
             return; // not enough to process a full block yet
         } else {
             memcopy_bytes(&ctx->buffer[ctx->buflen], data, need);
+            SHA256_STATS_ADD(SHA256_STATS_C, buffer_fills, 1);
+            SHA256_STATS_ADD(SHA256_STATS_C, buffer_bytes, need);
             sha256_transform(ctx, ctx->buffer); // process full buffer
             ctx->buflen = 0;
             i += need;
@@ -136,81 +360,462 @@ void sha256_update(struct sha256_ctx *ctx, const u8 *data, u32 len) {
     }
 
     // Process direct full 64-byte blocks from input
-    // Fixed: Changed condition to prevent buffer overflow
-    while (i + 64 <= len) {
-        sha256_transform(ctx, &data[i]);
-        i += 64;
+    nblocks = (len - i) / 64;
+    if (nblocks > 0) {
+        sha256_blocks(ctx->h, &data[i], nblocks);
+        i += nblocks * 64;
     }
 
     // Copy any leftover bytes into buffer
     if (i < len) {
-        u32 rem = len - i;
+        u32 rem = (u32)(len - i);
         memcopy_bytes(ctx->buffer, &data[i], rem);
         ctx->buflen = rem;
+        SHA256_STATS_ADD(SHA256_STATS_C, buffer_fills, 1);
+        SHA256_STATS_ADD(SHA256_STATS_C, buffer_bytes, rem);
     }
+    SHA256_STATS_STOP(SHA256_STATS_C, update_cycles, t0);
 }
 
 /*
  * Finalize the hash computation:
  * - Apply SHA-256 padding
  * - Append message length
- * - Output final 32-byte hash
+ * - Output the first outlen bytes of the hash (32 for SHA-256)
+ * Inlined into each caller, so the output length is a constant there.
  */
-void sha256_final(struct sha256_ctx *ctx, u8 out_hash32[32]) {
-    u32 i;
+static inline void sha256_finish(struct sha256_ctx *ctx, u8 *out, u32 outlen) {
     u64 bits = ctx->bitlen;
+    // Always < 64; the mask lets the compiler see the pads stay in buffer
+    u32 used = ctx->buflen & 63;
+    SHA256_STATS_START(t0);
+
+    SHA256_STATS_ADD(SHA256_STATS_C, final_calls, 1);
+    SHA256_STATS_ADD(SHA256_STATS_C, final_blocks, used >= 56 ? 2 : 1);
 
     // Append padding: start with 0x80
-    ctx->buffer[ctx->buflen] = 0x80;
-    ctx->buflen++;
+    ctx->buffer[used++] = 0x80;
 
     // Handle case where padding doesn't fit in current block
-    if (ctx->buflen > 56) {
-        while (ctx->buflen < 64) {
-            ctx->buffer[ctx->buflen] = 0;
-            ctx->buflen++;
-        }
+    if (used > 56) {
+        zero_bytes(&ctx->buffer[used], 64 - used);
         sha256_transform(ctx, ctx->buffer);
-        ctx->buflen = 0;
+        used = 0;
     }
 
     // Pad remaining space with zeros
-    while (ctx->buflen < 56) {
-        ctx->buffer[ctx->buflen] = 0;
-        ctx->buflen++;
-    }
+    zero_bytes(&ctx->buffer[used], 56 - used);
+    ctx->buflen = 56;
 
     // Append 64-bit length in big-endian
-    ctx->buffer[56] = (u8)(bits >> 56);
-    ctx->buffer[57] = (u8)(bits >> 48);
-    ctx->buffer[58] = (u8)(bits >> 40);
-    ctx->buffer[59] = (u8)(bits >> 32);
-    ctx->buffer[60] = (u8)(bits >> 24);
-    ctx->buffer[61] = (u8)(bits >> 16);
-    ctx->buffer[62] = (u8)(bits >> 8);
-    ctx->buffer[63] = (u8)bits;
+    store_be32(&ctx->buffer[56], (u32)(bits >> 32));
+    store_be32(&ctx->buffer[60], (u32)bits);
 
     // Process final block
     sha256_transform(ctx, ctx->buffer);
 
     // Output hash
+    store_digest(out, ctx->h, outlen);
+    SHA256_STATS_STOP(SHA256_STATS_C, final_cycles, t0);
+}
+
+void sha256_final(struct sha256_ctx *ctx, u8 out_hash32[32]) {
+    sha256_finish(ctx, out_hash32, 32);
+}
+
+void sha256_final_len(struct sha256_ctx *ctx, u8 *out, u32 outlen) {
+    sha256_finish(ctx, out, outlen < 32 ? outlen : 32);
+}
+
+void sha224_final(struct sha256_ctx *ctx, u8 out_hash28[28]) {
+    sha256_finish(ctx, out_hash28, 28);
+}
+
+void sha256_export(const struct sha256_ctx *ctx, u8 out[SHA256_STATE_BYTES]) {
+    u32 i;
+
+    out[0] = 'S'; out[1] = '2'; out[2] = '5'; out[3] = '6';
+    out[4] = SHA256_STATE_VERSION;
+    out[5] = (u8)ctx->buflen;
+    out[6] = 0;
+    out[7] = 0;
+    store_be32(&out[8], (u32)(ctx->bitlen >> 32));
+    store_be32(&out[12], (u32)ctx->bitlen);
+    for (i = 0; i < 8; ++i)
+        store_be32(&out[16 + i * 4], ctx->h[i]);
+
+    // Only the buffered bytes are state; the rest is written as zero
+    memcopy_bytes(&out[48], ctx->buffer, ctx->buflen);
+    zero_bytes(&out[48 + ctx->buflen], 64 - ctx->buflen);
+}
+
+int sha256_import(struct sha256_ctx *ctx, const u8 in[SHA256_STATE_BYTES]) {
+    u64 bitlen;
+    u32 buflen, i;
+
+    if (in[0] != 'S' || in[1] != '2' || in[2] != '5' || in[3] != '6' ||
+        in[4] != SHA256_STATE_VERSION || in[6] != 0 || in[7] != 0)
+        return -1;
+
+    buflen = in[5];
+    bitlen = ((u64)load_be32(&in[8]) << 32) | load_be32(&in[12]);
+
+    // Whole bytes only, and the buffered count must agree with the length
+    if (buflen > 63 || (bitlen & 7) != 0 || ((bitlen >> 3) & 63) != buflen)
+        return -1;
+
+    for (i = 0; i < 8; ++i)
+        ctx->h[i] = load_be32(&in[16 + i * 4]);
+    memcopy_bytes(ctx->buffer, &in[48], buflen);
+    ctx->buflen = buflen;
+    ctx->bitlen = bitlen;
+    return 0;
+}
+
+void hmac_sha256_key_init(struct hmac_sha256_key *key, const u8 *k, u64 klen) {
+    struct sha256_ctx kctx;
+    u8 pad[64];
+    u32 i;
+
+    // Long keys are replaced by their digest, short ones zero-padded
+    zero_bytes(pad, 64);
+    if (klen > 64) {
+        sha256_init(&kctx);
+        sha256_update64(&kctx, k, klen);
+        sha256_final(&kctx, pad);
+    } else {
+        memcopy_bytes(pad, k, (u32)klen);
+    }
+
+    for (i = 0; i < 64; ++i) pad[i] ^= 0x36;
+    sha256_init(&kctx);
+    sha256_blocks(kctx.h, pad, 1);
+    for (i = 0; i < 8; ++i) key->inner_h[i] = kctx.h[i];
+
+    for (i = 0; i < 64; ++i) pad[i] ^= 0x36 ^ 0x5c;
+    sha256_init(&kctx);
+    sha256_blocks(kctx.h, pad, 1);
+    for (i = 0; i < 8; ++i) key->outer_h[i] = kctx.h[i];
+
+    // Don't leave key material on the stack
+    wipe_bytes(pad, 64);
+    wipe_bytes(&kctx, sizeof(kctx));
+}
+
+void hmac_sha256_init(struct hmac_sha256_ctx *ctx, const struct hmac_sha256_key *key) {
+    u32 i;
+
     for (i = 0; i < 8; ++i) {
-        u32 val = ctx->h[i];
-        out_hash32[i*4 + 0] = (u8)(val >> 24);
-        out_hash32[i*4 + 1] = (u8)(val >> 16);
-        out_hash32[i*4 + 2] = (u8)(val >> 8);
-        out_hash32[i*4 + 3] = (u8)val;
+        ctx->inner.h[i] = key->inner_h[i];
+        ctx->outer_h[i] = key->outer_h[i];
     }
+    ctx->inner.buflen = 0;
+    ctx->inner.bitlen = 512;   // the ipad block is already in
 }
 
-// Convert binary digest into human-readable hex string
-void sha256_to_hex(const u8 hash32[32], char hex_out[65]) {
-    static const char hexchars[] = "0123456789abcdef";
+void hmac_sha256_update(struct hmac_sha256_ctx *ctx, const u8 *data, u64 len) {
+    sha256_update64(&ctx->inner, data, len);
+}
+
+void hmac_sha256_final(struct hmac_sha256_ctx *ctx, u8 out_mac32[32]) {
+    u8 block[64];
+    u32 i;
+
+    /* The outer message is opad block || inner digest: exactly one
+     * more block, written in place with its padding, 768 bits total */
+    sha256_final(&ctx->inner, block);
+    block[32] = 0x80;
+    zero_bytes(&block[33], 64 - 33 - 4);
+    store_be32(&block[60], 768);
+
+    sha256_blocks(ctx->outer_h, block, 1);
+    for (i = 0; i < 8; ++i)
+        store_be32(&out_mac32[i * 4], ctx->outer_h[i]);
+}
+
+void hmac_sha256(const struct hmac_sha256_key *key, const u8 *msg, u64 len, u8 out_mac32[32]) {
+    struct hmac_sha256_ctx ctx;
+
+    hmac_sha256_init(&ctx, key);
+    sha256_update64(&ctx.inner, msg, len);
+    hmac_sha256_final(&ctx, out_mac32);
+}
+
+/*
+ * Context-free one-shot hashing
+ *
+ * The whole message is known up front, so the padding is written
+ * straight into one or two stack blocks and the state never leaves
+ * the (local) h[8]: no struct sha256_ctx, no buflen bookkeeping.
+ */
+/* The padding block of a 64-byte message (0x80, zeros, length 512)
+ * never changes, so neither does its message schedule: these are its
+ * W[t] + K[t], ready for the rounds */
+static const u32 sha256_pad64_wk[64] = {
+    0xc28a2f98u, 0x71374491u, 0xb5c0fbcfu, 0xe9b5dba5u,
+    0x3956c25bu, 0x59f111f1u, 0x923f82a4u, 0xab1c5ed5u,
+    0xd807aa98u, 0x12835b01u, 0x243185beu, 0x550c7dc3u,
+    0x72be5d74u, 0x80deb1feu, 0x9bdc06a7u, 0xc19bf374u,
+    0x649b69c1u, 0xf0fe4786u, 0x0fe1edc6u, 0x240cf254u,
+    0x4fe9346fu, 0x6cc984beu, 0x61b9411eu, 0x16f988fau,
+    0xf2c65152u, 0xa88e5a6du, 0xb019fc65u, 0xb9d99ec7u,
+    0x9a1231c3u, 0xe70eeaa0u, 0xfdb1232bu, 0xc7353eb0u,
+    0x3069bad5u, 0xcb976d5fu, 0x5a0f118fu, 0xdc1eeefdu,
+    0x0a35b689u, 0xde0b7a04u, 0x58f4ca9du, 0xe15d5b16u,
+    0x007f3e86u, 0x37088980u, 0xa507ea32u, 0x6fab9537u,
+    0x17406110u, 0x0d8cd6f1u, 0xcdaa3b6du, 0xc0bbbe37u,
+    0x83613bdau, 0xdb48a363u, 0x0b02e931u, 0x6fd15ca7u,
+    0x521afacau, 0x31338431u, 0x6ed41a95u, 0x6d437890u,
+    0xc39c91f2u, 0x9eccabbdu, 0xb5c9a0e6u, 0x532fb63cu,
+    0xd2c741c6u, 0x07237ea3u, 0xa4954b68u, 0x4c191d76u,
+};
+
+static void sha256_state_out(const u32 h[8], u8 out[32]) {
+    store_digest(out, h, 32);
+}
+
+// 64 rounds over a precomputed W + K schedule
+static void sha256_rounds_wk(u32 state[8], const u32 wk[64]) {
+    u32 a = state[0], b = state[1], c = state[2], d = state[3];
+    u32 e = state[4], f = state[5], g = state[6], h = state[7];
+    u32 t;
+
+    for (t = 0; t < 64; ++t) {
+        u32 t1 = h + BSIG1(e) + CH(e, f, g) + wk[t];
+        u32 t2 = BSIG0(a) + MAJ(a, b, c);
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+// h = state after the whole padded message, starting from iv
+static void sha256_oneshot(const u32 iv[8], const u8 *data, u64 len, u32 h[8]) {
+    u8 tail[128];
+    u64 whole = len / 64;
+    u32 rem = (u32)(len % 64), n, i;
+
+    for (i = 0; i < 8; ++i) h[i] = iv[i];
+    if (whole)
+        sha256_blocks(h, data, whole);
+
+    // The last partial block plus padding: one block, or two if the length doesn't fit
+    n = rem < 56 ? 64 : 128;
+    memcopy_bytes(tail, data + whole * 64, rem);
+    tail[rem] = 0x80;
+    zero_bytes(&tail[rem + 1], n - 8 - rem - 1);
+    store_be32(&tail[n - 8], (u32)(len >> 29));
+    store_be32(&tail[n - 4], (u32)(len << 3));
+    sha256_blocks(h, tail, n / 64);
+}
+
+// h = SHA-256 state of a 32-byte message already in block[0..31]
+static void sha256_block32(u8 block[64], u32 h[8]) {
+    u32 i;
+
+    block[32] = 0x80;
+    zero_bytes(&block[33], 64 - 33 - 4);
+    store_be32(&block[60], 256);
+    for (i = 0; i < 8; ++i) h[i] = sha256_iv[i];
+    sha256_blocks(h, block, 1);
+}
+
+void sha256_digest(const u8 *data, u64 len, u8 out_hash32[32]) {
+    u32 h[8];
+    sha256_oneshot(sha256_iv, data, len, h);
+    sha256_state_out(h, out_hash32);
+}
+
+void sha256_digest_iv(const u32 iv[8], const u8 *data, u64 len, u8 *out, u32 outlen) {
+    u32 h[8];
+    sha256_oneshot(iv, data, len, h);
+    store_digest(out, h, outlen < 32 ? outlen : 32);
+}
+
+// Fixed variants: the IV and the length of the store are constants here
+void sha224_digest(const u8 *data, u64 len, u8 out_hash28[28]) {
+    u32 h[8];
+    sha256_oneshot(sha224_iv, data, len, h);
+    store_digest(out_hash28, h, 28);
+}
+
+void sha256_128_digest(const u8 *data, u64 len, u8 out_hash16[16]) {
+    u32 h[8];
+    sha256_oneshot(sha256_iv, data, len, h);
+    store_digest(out_hash16, h, 16);
+}
+
+void sha256_32(const u8 in[32], u8 out_hash32[32]) {
+    u8 block[64];
+    u32 h[8];
+
+    memcopy_bytes(block, in, 32);
+    sha256_block32(block, h);
+    sha256_state_out(h, out_hash32);
+}
+
+void sha256_64(const u8 in[64], u8 out_hash32[32]) {
+    static const u8 pad64[64] = { 0x80, [62] = 0x02 };   // 0x80, zeros, 512 bits
+    u32 h[8], i;
+
+    for (i = 0; i < 8; ++i) h[i] = sha256_iv[i];
+    sha256_blocks(h, in, 1);
+
+    /* Hardware backends compute a schedule faster than the scalar
+     * rounds can skip one; only the portable code uses the table */
+    if (active_backend() == SHA256_BACKEND_SCALAR)
+        sha256_rounds_wk(h, sha256_pad64_wk);
+    else
+        sha256_blocks(h, pad64, 1);
+    sha256_state_out(h, out_hash32);
+}
+
+void sha256d(const u8 *data, u64 len, u8 out_hash32[32]) {
+    u8 block[64];
+    u32 h[8];
+
+    // The first digest is written straight into the second message block
+    sha256_oneshot(sha256_iv, data, len, h);
+    sha256_state_out(h, block);
+    sha256_block32(block, h);
+    sha256_state_out(h, out_hash32);
+}
+
+/*
+ * Hex encoding and decoding
+ *
+ * With GCC/Clang vectors a digest is formatted 16 bytes at a time:
+ * split into nibbles, interleave high/low, and map 0..15 to ASCII
+ * arithmetically ('0' + n, plus 39 for a..f). Decoding runs the same
+ * in reverse, and every character is validated with one test at the
+ * end. This needs only 16-byte vectors, so it is SSE2 on x86-64 and
+ * NEON on AArch64 with no runtime dispatch.
+ *
+ * Other compilers use two 256-entry tables: the two characters of
+ * every byte value, and value + 1 of every character (0 = not hex).
+ */
+
+#if defined(SHA256_WORD_ACCESS) && defined(__has_builtin)
+#if __has_builtin(__builtin_shufflevector)
+#define SHA256_HEX_VECTOR 1
+#endif
+#endif
+
+#ifdef SHA256_HEX_VECTOR
+typedef u8 sha256_v16 __attribute__((vector_size(16)));
+typedef sha256_v16 __attribute__((may_alias, aligned(1))) sha256_v16_unaligned;
+typedef u64 sha256_v2x64 __attribute__((vector_size(16)));
+
+// Nibbles 0..15 to '0'..'9', 'a'..'f'
+static inline sha256_v16 hex_ascii(sha256_v16 n) {
+    return n + '0' + ((sha256_v16)(n > 9) & 39);
+}
+
+// 64 hex chars of one digest, no terminator
+static inline void sha256_hex64(const u8 hash32[32], char *out) {
+    u32 k;
+    for (k = 0; k < 2; ++k) {
+        sha256_v16 v = *(const sha256_v16_unaligned *)(hash32 + 16 * k);
+        sha256_v16 hi = v >> 4, lo = v & 15;
+
+        *(sha256_v16_unaligned *)(out + 32 * k) = hex_ascii(
+            __builtin_shufflevector(hi, lo, 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23));
+        *(sha256_v16_unaligned *)(out + 32 * k + 16) = hex_ascii(
+            __builtin_shufflevector(hi, lo, 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31));
+    }
+}
+
+// 16 hex chars to nibbles; lanes that are not hex are set in *bad
+static inline sha256_v16 hex_nibbles(const char *p, sha256_v16 *bad) {
+    sha256_v16 c = *(const sha256_v16_unaligned *)p;
+    sha256_v16 digit = c - '0', alpha = (c | 0x20) - 'a';   // | 0x20: lowercase
+    sha256_v16 is_digit = (sha256_v16)(digit < 10), is_alpha = (sha256_v16)(alpha < 6);
+
+    *bad |= ~(is_digit | is_alpha);
+    return (digit & is_digit) | ((alpha + 10) & is_alpha);
+}
+
+int sha256_from_hex(const char *hex, u8 out32[32]) {
+    sha256_v16 bad = {0}, bytes[2];
+    sha256_v2x64 any;
+    u32 k;
+
+    for (k = 0; k < 2; ++k) {
+        sha256_v16 a = hex_nibbles(hex + 32 * k, &bad);
+        sha256_v16 b = hex_nibbles(hex + 32 * k + 16, &bad);
+        sha256_v16 hi = __builtin_shufflevector(a, b, 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+        sha256_v16 lo = __builtin_shufflevector(a, b, 1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+        bytes[k] = (hi << 4) | lo;
+    }
+    any = (sha256_v2x64)bad;
+    if (any[0] | any[1])
+        return -1;
+    *(sha256_v16_unaligned *)out32 = bytes[0];
+    *(sha256_v16_unaligned *)(out32 + 16) = bytes[1];
+    return 0;
+}
+
+#else
+
+// "00" "01" ... "ff": byte b is at sha256_hex_pairs[2*b]
+static const char sha256_hex_pairs[513] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+static const u8 sha256_hex_val[256] = {
+    ['0'] = 1,  ['1'] = 2,  ['2'] = 3,  ['3'] = 4,  ['4'] = 5,
+    ['5'] = 6,  ['6'] = 7,  ['7'] = 8,  ['8'] = 9,  ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+// 64 hex chars of one digest, no terminator
+static inline void sha256_hex64(const u8 hash32[32], char *out) {
     u32 i;
     for (i = 0; i < 32; ++i) {
-        u8 b = hash32[i];
-        hex_out[i*2 + 0] = hexchars[(b >> 4) & 0xF]; // high nibble
-        hex_out[i*2 + 1] = hexchars[b & 0xF];        // low nibble
+        const char *p = &sha256_hex_pairs[hash32[i] * 2];
+        out[i*2 + 0] = p[0];
+        out[i*2 + 1] = p[1];
+    }
+}
+
+int sha256_from_hex(const char *hex, u8 out32[32]) {
+    u8 tmp[32];
+    u32 i, bad = 0;
+
+    for (i = 0; i < 32; ++i) {
+        u32 hi = sha256_hex_val[(u8)hex[i*2 + 0]] - 1u;
+        u32 lo = sha256_hex_val[(u8)hex[i*2 + 1]] - 1u;
+        bad |= (hi | lo) >> 8;   // nonzero only if a table entry was 0
+        tmp[i] = (u8)((hi << 4) | lo);
     }
+    if (bad)
+        return -1;
+    memcopy_bytes(out32, tmp, 32);
+    return 0;
+}
+
+#endif
+
+// Convert binary digest into human-readable hex string
+void sha256_to_hex(const u8 hash32[32], char hex_out[65]) {
+    sha256_hex64(hash32, hex_out);
     hex_out[64] = '\0'; // null-terminate
-}
\ No newline at end of file
+}
+
+u64 sha256_to_hex_batch(const u8 *digests, u64 n, char sep, char *out) {
+    u64 i;
+    for (i = 0; i < n; ++i) {
+        sha256_hex64(digests + i * 32, out + i * 65);
+        out[i * 65 + 64] = sep;
+    }
+    return n * 65;
+}
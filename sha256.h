@@ -51,6 +51,20 @@ void sha256_init(struct sha256_ctx *ctx);
  */
 void sha256_update(struct sha256_ctx *ctx, const u8 *data, u32 len);
 
+/* sha256_update64()
+ * Same as sha256_update(), with a 64-bit length so a single call
+ * can cover buffers larger than 4 GiB (e.g. mmap'd files).
+ */
+void sha256_update64(struct sha256_ctx *ctx, const u8 *data, u64 len);
+
+/* sha256_transform_blocks()
+ * Low-level: compress nblocks whole 64-byte blocks straight from data,
+ * with no buffering. Only valid while no partial block is buffered
+ * (ctx->buflen == 0, e.g. right after sha256_init). The bytes are
+ * counted, so sha256_final() can follow as usual.
+ */
+void sha256_transform_blocks(struct sha256_ctx *ctx, const u8 *data, u64 nblocks);
+
 /* sha256_final()
  * Finish hashing: add padding, process final block,
  * and write the 32-byte digest to out_hash32.
@@ -66,4 +80,176 @@ void sha256_final(struct sha256_ctx *ctx, u8 out_hash32[32]);
  */
 void sha256_to_hex(const u8 hash32[32], char hex_out[65]);
 
+/* sha256_to_hex_batch()
+ * Format n digests, stored back to back in digests (32 bytes each),
+ * into one buffer: 64 lowercase hex chars followed by sep per digest,
+ * no null terminator. out must hold n * 65 bytes.
+ * Returns the number of bytes written (n * 65).
+ */
+u64 sha256_to_hex_batch(const u8 *digests, u64 n, char sep, char *out);
+
+/* sha256_from_hex()
+ * Parse exactly 64 hex chars (either case) into a 32-byte digest.
+ * hex need not be null-terminated.
+ * Returns 0, or -1 (out32 unchanged) if any of the 64 is not hex.
+ */
+int sha256_from_hex(const char *hex, u8 out32[32]);
+
+/*
+ * One-shot hashing of a whole message, without a context
+ *
+ * For hot paths with small, fixed-size inputs (Merkle nodes, hashes
+ * of hashes): the padding is built directly on the stack, so there
+ * is no struct sha256_ctx, no buffering and no padding loops.
+ *
+ * sha256_digest() - any length
+ * sha256_32()     - exactly 32 bytes (e.g. a digest)
+ * sha256_64()     - exactly 64 bytes (e.g. two digests); the constant
+ *                   padding block uses a precomputed message schedule
+ * sha256d()       - SHA-256(SHA-256(data)), any length
+ */
+void sha256_digest(const u8 *data, u64 len, u8 out_hash32[32]);
+void sha256_32(const u8 in[32], u8 out_hash32[32]);
+void sha256_64(const u8 in[64], u8 out_hash32[32]);
+void sha256d(const u8 *data, u64 len, u8 out_hash32[32]);
+
+/*
+ * SHA-224 and truncated digests
+ *
+ * Only the initial hash value and the number of output bytes differ
+ * from SHA-256, so these run on whatever compression backend is
+ * selected (SHA-NI, ARMv8, multi-lane) with no code of their own.
+ * SHA-224 is FIPS 180-4's: its own IV, first 28 bytes of the state.
+ * SHA-256/128 is plain SHA-256 truncated to 16 bytes.
+ *
+ * sha256_init_iv()   - start a context from any 8-word IV
+ * sha256_final_len() - write the first outlen bytes (at most 32)
+ * sha256_digest_iv() - one-shot of the two
+ *
+ * The fixed-length forms (sha224_*, sha256_128_digest) are separate
+ * functions, so their IV and store length are compile-time constants.
+ */
+#define SHA224_DIGEST_SIZE     28
+#define SHA256_128_DIGEST_SIZE 16
+
+extern const u32 sha256_iv[8];
+extern const u32 sha224_iv[8];
+
+void sha256_init_iv(struct sha256_ctx *ctx, const u32 iv[8]);
+void sha256_final_len(struct sha256_ctx *ctx, u8 *out, u32 outlen);
+void sha256_digest_iv(const u32 iv[8], const u8 *data, u64 len, u8 *out, u32 outlen);
+
+void sha224_init(struct sha256_ctx *ctx);
+void sha224_final(struct sha256_ctx *ctx, u8 out_hash28[28]);
+void sha224_digest(const u8 *data, u64 len, u8 out_hash28[28]);
+void sha256_128_digest(const u8 *data, u64 len, u8 out_hash16[16]);
+
+/*
+ * Midstate export / import
+ *
+ * A context can be saved after hashing a common prefix and restored
+ * any number of times to hash messages that start with it. Within one
+ * process a plain struct copy (ctx2 = ctx1) is the cheapest clone;
+ * the byte layout below is for caching midstates, or moving them
+ * between the C and Rust cores (rust_sha256_export/import use the
+ * exact same layout) and across machines.
+ *
+ * Layout, SHA256_STATE_BYTES bytes, integers big-endian:
+ *   0..3    magic "S256"
+ *   4       layout version (SHA256_STATE_VERSION)
+ *   5       bytes in the partial block (0..63)
+ *   6..7    reserved, zero
+ *   8..15   total message length in bits
+ *   16..47  h[0..7]
+ *   48..111 partial block; bytes past the count above are zero
+ */
+#define SHA256_STATE_BYTES   112
+#define SHA256_STATE_VERSION 1
+
+/* sha256_export()
+ * Serialize ctx (between update calls) into out.
+ */
+void sha256_export(const struct sha256_ctx *ctx, u8 out[SHA256_STATE_BYTES]);
+
+/* sha256_import()
+ * Restore a context written by sha256_export() or rust_sha256_export().
+ * Returns 0, or -1 (ctx untouched) if the magic, version or lengths
+ * are not valid.
+ */
+int sha256_import(struct sha256_ctx *ctx, const u8 in[SHA256_STATE_BYTES]);
+
+/*
+ * HMAC-SHA256 (RFC 2104)
+ *
+ * hmac_sha256_key_init() runs the two key-pad compressions once and
+ * keeps the resulting inner and outer midstates. Every message after
+ * that costs only its own blocks plus the two finishing compressions.
+ *
+ * Typical usage:
+ *   struct hmac_sha256_key key;
+ *   hmac_sha256_key_init(&key, secret, secret_len);   // once
+ *   hmac_sha256(&key, msg, msg_len, mac32);           // per message
+ *
+ * or, for messages that arrive in pieces:
+ *   struct hmac_sha256_ctx ctx;
+ *   hmac_sha256_init(&ctx, &key);
+ *   hmac_sha256_update(&ctx, part, part_len);         // any number of times
+ *   hmac_sha256_final(&ctx, mac32);
+ *
+ * A key may be shared by any number of contexts and threads; it is
+ * only read after hmac_sha256_key_init().
+ */
+struct hmac_sha256_key {
+    u32 inner_h[8];    // state after compressing key ^ ipad
+    u32 outer_h[8];    // state after compressing key ^ opad
+};
+
+struct hmac_sha256_ctx {
+    struct sha256_ctx inner;   // H(key ^ ipad || message ...)
+    u32 outer_h[8];            // copied from the key
+};
+
+/* hmac_sha256_key_init()
+ * Precompute the padded-key midstates. Keys longer than 64 bytes are
+ * hashed first, as RFC 2104 requires.
+ */
+void hmac_sha256_key_init(struct hmac_sha256_key *key, const u8 *k, u64 klen);
+
+void hmac_sha256_init(struct hmac_sha256_ctx *ctx, const struct hmac_sha256_key *key);
+void hmac_sha256_update(struct hmac_sha256_ctx *ctx, const u8 *data, u64 len);
+void hmac_sha256_final(struct hmac_sha256_ctx *ctx, u8 out_mac32[32]);
+
+/* hmac_sha256()
+ * One-shot MAC of a whole message. Whole blocks are compressed
+ * straight from msg; only the last partial block is copied.
+ */
+void hmac_sha256(const struct hmac_sha256_key *key, const u8 *msg, u64 len, u8 out_mac32[32]);
+
+/*
+ * Compression backends
+ *
+ * The block function is picked once, on first use, from what the
+ * running CPU supports, so one binary runs everywhere and still uses
+ * the SHA instructions where they exist.
+ * Scalar C is always available as the fallback.
+ */
+enum sha256_backend {
+    SHA256_BACKEND_AUTO = 0,   // best backend for this CPU
+    SHA256_BACKEND_SCALAR,     // portable C
+    SHA256_BACKEND_SHANI,      // x86 SHA extensions (SHA-NI)
+    SHA256_BACKEND_ARMV8       // ARMv8 SHA2 crypto extensions
+};
+
+/* sha256_use_backend()
+ * Force a specific backend (e.g. to compare against scalar).
+ * Returns 0 on success, -1 if it is not built in or the CPU lacks it.
+ * Not thread-safe: call it before hashing starts.
+ */
+int sha256_use_backend(enum sha256_backend backend);
+
+/* sha256_backend_name()
+ * Name of the active backend: "scalar", "sha-ni" or "armv8-sha2".
+ */
+const char *sha256_backend_name(void);
+
 #endif 
\ No newline at end of file
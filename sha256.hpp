@@ -0,0 +1,164 @@
+/* sha256.hpp
+ *
+ * Compile-time SHA-256 for C++14 and later: header-only, constexpr,
+ * no libc and no link dependency. For digests of constant data
+ * (config blobs, string tables) that would otherwise be hashed with
+ * sha256_init/update/final at startup.
+ *
+ * Same constants as the C core (sha256_consts.h) and the same round
+ * structure as its scalar backend: 16-word rolling schedule, FIPS
+ * 180-4 padding.
+ *
+ * Typical usage:
+ *   #include "sha256.hpp"
+ *   using namespace sha256::literals;
+ *
+ *   constexpr sha256::digest kTableDigest = sha256::hash("fixed table");
+ *   constexpr auto kName = "config-v2"_sha256;
+ *
+ *   static constexpr unsigned char blob[] = { ... };
+ *   constexpr auto kBlob = sha256::hash(blob);      // all sizeof(blob) bytes
+ *
+ * A string literal hashes without its terminating NUL; an unsigned
+ * char array hashes all of its bytes. Compilers cap constant
+ * evaluation (GCC: -fconstexpr-ops-limit, Clang: -fconstexpr-steps),
+ * which at GCC's defaults allows roughly 100-200 KiB of input per
+ * hash; raise the limit for bigger blobs.
+ *
+ * The functions also work at run time, at scalar speed, and produce
+ * the same bytes as sha256_final().
+ */
+
+#ifndef SHA256_HPP
+#define SHA256_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sha256_consts.h"
+
+namespace sha256 {
+
+// A 32-byte digest, usable in constant expressions
+struct digest {
+    unsigned char bytes[32];
+
+    constexpr unsigned char operator[](std::size_t i) const { return bytes[i]; }
+    static constexpr std::size_t size() { return 32; }
+
+    friend constexpr bool operator==(const digest &a, const digest &b) {
+        for (std::size_t i = 0; i < 32; ++i)
+            if (a.bytes[i] != b.bytes[i])
+                return false;
+        return true;
+    }
+    friend constexpr bool operator!=(const digest &a, const digest &b) { return !(a == b); }
+};
+
+namespace detail {
+
+constexpr std::uint32_t K[64] = { SHA256_K_VALUES };
+constexpr std::uint32_t H0[8] = { SHA256_H0_VALUES };
+
+// SHA-256 logical functions, as the macros in sha256_internal.h
+constexpr std::uint32_t rotr(std::uint32_t x, unsigned n) { return (x >> n) | (x << (32 - n)); }
+constexpr std::uint32_t ch(std::uint32_t x, std::uint32_t y, std::uint32_t z) { return (x & y) ^ (~x & z); }
+constexpr std::uint32_t maj(std::uint32_t x, std::uint32_t y, std::uint32_t z) { return (x & y) ^ (x & z) ^ (y & z); }
+constexpr std::uint32_t bsig0(std::uint32_t x) { return rotr(x, 2) ^ rotr(x, 13) ^ rotr(x, 22); }
+constexpr std::uint32_t bsig1(std::uint32_t x) { return rotr(x, 6) ^ rotr(x, 11) ^ rotr(x, 25); }
+constexpr std::uint32_t ssig0(std::uint32_t x) { return rotr(x, 7) ^ rotr(x, 18) ^ (x >> 3); }
+constexpr std::uint32_t ssig1(std::uint32_t x) { return rotr(x, 17) ^ rotr(x, 19) ^ (x >> 10); }
+
+// Byte i of the input as 0..255 whether it is char or unsigned char
+template <typename Byte>
+constexpr std::uint32_t byte_at(const Byte *p, std::size_t i) {
+    return static_cast<unsigned char>(p[i]);
+}
+
+// Compress one 64-byte block at p into h
+template <typename Byte>
+constexpr void compress(std::uint32_t (&h)[8], const Byte *p) {
+    std::uint32_t W[16] = {};
+    std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    std::uint32_t e = h[4], f = h[5], g = h[6], hh = h[7];
+
+    for (std::size_t i = 0; i < 64; ++i) {
+        std::uint32_t w = 0;
+        if (i < 16) {
+            w = byte_at(p, i * 4) << 24 | byte_at(p, i * 4 + 1) << 16 |
+                byte_at(p, i * 4 + 2) << 8 | byte_at(p, i * 4 + 3);
+        } else {
+            w = ssig1(W[(i + 14) & 15]) + W[(i + 9) & 15] + ssig0(W[(i + 1) & 15]) + W[i & 15];
+        }
+        W[i & 15] = w;
+
+        std::uint32_t t1 = hh + bsig1(e) + ch(e, f, g) + K[i] + w;
+        std::uint32_t t2 = bsig0(a) + maj(a, b, c);
+        hh = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+template <typename Byte>
+constexpr digest hash_bytes(const Byte *data, std::size_t len) {
+    std::uint32_t h[8] = {};
+    unsigned char tail[128] = {};
+    std::size_t full = len / 64 * 64, rem = len - full;
+    std::size_t tlen = rem < 56 ? 64 : 128, i = 0;
+    std::uint64_t bits = static_cast<std::uint64_t>(len) * 8;
+    digest out = {};
+
+    for (i = 0; i < 8; ++i)
+        h[i] = H0[i];
+    for (i = 0; i < full; i += 64)
+        compress(h, data + i);
+
+    // Tail, 0x80, zeros, 64-bit length: one block, or two if it won't fit
+    for (i = 0; i < rem; ++i)
+        tail[i] = static_cast<unsigned char>(data[full + i]);
+    tail[rem] = 0x80;
+    for (i = 0; i < 8; ++i)
+        tail[tlen - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+    compress(h, tail);
+    if (tlen == 128)
+        compress(h, tail + 64);
+
+    for (i = 0; i < 32; ++i)
+        out.bytes[i] = static_cast<unsigned char>(h[i / 4] >> (24 - 8 * (i % 4)));
+    return out;
+}
+
+} // namespace detail
+
+// Digest of len bytes at data
+constexpr digest hash(const char *data, std::size_t len) { return detail::hash_bytes(data, len); }
+constexpr digest hash(const unsigned char *data, std::size_t len) { return detail::hash_bytes(data, len); }
+
+// Digest of a string literal, without its terminating NUL
+template <std::size_t N>
+constexpr digest hash(const char (&str)[N]) { return detail::hash_bytes(str, N - 1); }
+
+// Digest of a byte array, all N bytes
+template <std::size_t N>
+constexpr digest hash(const unsigned char (&bytes)[N]) { return detail::hash_bytes(bytes, N); }
+
+namespace literals {
+// "text"_sha256
+constexpr digest operator""_sha256(const char *str, std::size_t len) { return detail::hash_bytes(str, len); }
+} // namespace literals
+
+// FIPS 180-4 "abc" example, checked by the compiler wherever this is included
+static_assert(hash("abc")[0] == 0xba && hash("abc")[31] == 0xad, "sha256.hpp: constexpr SHA-256 is broken");
+
+} // namespace sha256
+
+#endif
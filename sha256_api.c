@@ -0,0 +1,127 @@
+/* sha256_api.c
+ *
+ * Opaque-handle interface over both cores (see sha256_api.h).
+ *
+ * A handle is a tagged union of struct sha256_ctx and RustSha256Ctx.
+ * The two are declared separately (sha256.h, sha256_rust.h) and must
+ * stay field-for-field identical for the shared export/import layout
+ * and the union to work; the checks below fail the build if they
+ * drift, and src/lib.rs asserts the same offsets on the Rust side.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "sha256_api.h"
+#include "sha256.h"
+#include "sha256_rust.h"
+
+struct sha256_handle {
+    union {
+        struct sha256_ctx c;
+        RustSha256Ctx rust;
+    } u;
+    u32 engine;
+} __attribute__((aligned(SHA256_HANDLE_ALIGN)));
+
+_Static_assert(sizeof(struct sha256_ctx) == 112, "sha256_ctx size changed");
+_Static_assert(offsetof(struct sha256_ctx, buffer) == 32 && offsetof(struct sha256_ctx, buflen) == 96 &&
+               offsetof(struct sha256_ctx, bitlen) == 104, "sha256_ctx layout changed (see src/lib.rs)");
+_Static_assert(sizeof(struct sha256_ctx) == sizeof(RustSha256Ctx), "C and Rust contexts differ in size");
+_Static_assert(offsetof(struct sha256_ctx, h) == offsetof(RustSha256Ctx, h), "h offset differs");
+_Static_assert(offsetof(struct sha256_ctx, buffer) == offsetof(RustSha256Ctx, buffer), "buffer offset differs");
+_Static_assert(offsetof(struct sha256_ctx, buflen) == offsetof(RustSha256Ctx, buflen), "buflen offset differs");
+_Static_assert(offsetof(struct sha256_ctx, bitlen) == offsetof(RustSha256Ctx, bitlen), "bitlen offset differs");
+_Static_assert(sizeof(struct sha256_handle) == SHA256_HANDLE_SIZE, "handle size is part of the ABI");
+_Static_assert(_Alignof(struct sha256_handle) == SHA256_HANDLE_ALIGN, "handle alignment is part of the ABI");
+_Static_assert(SHA256_API_STATE_BYTES == SHA256_STATE_BYTES, "export size is part of the ABI");
+
+int sha256_api_version(void) {
+    return SHA256_API_VERSION;
+}
+
+const char *sha256_api_backend(int engine) {
+    switch (engine) {
+    case SHA256_API_ENGINE_C:    return sha256_backend_name();
+    case SHA256_API_ENGINE_RUST: return rust_sha256_backend_name();
+    default:                     return NULL;
+    }
+}
+
+sha256_handle *sha256_handle_init(void *mem, int engine) {
+    sha256_handle *h = mem;
+
+    if (!mem || ((uintptr_t)mem & (SHA256_HANDLE_ALIGN - 1)) != 0)
+        return NULL;
+    if (engine != SHA256_API_ENGINE_C && engine != SHA256_API_ENGINE_RUST)
+        return NULL;
+
+    h->engine = (u32)engine;
+    sha256_handle_reset(h);
+    return h;
+}
+
+sha256_handle *sha256_handle_new(int engine) {
+    void *mem;
+
+    if (posix_memalign(&mem, SHA256_HANDLE_ALIGN, SHA256_HANDLE_SIZE) != 0)
+        return NULL;
+    if (!sha256_handle_init(mem, engine)) {
+        free(mem);
+        return NULL;
+    }
+    return mem;
+}
+
+void sha256_handle_free(sha256_handle *h) {
+    free(h);
+}
+
+int sha256_handle_engine(const sha256_handle *h) {
+    return (int)h->engine;
+}
+
+void sha256_handle_reset(sha256_handle *h) {
+    if (h->engine == SHA256_API_ENGINE_RUST)
+        rust_sha256_init(&h->u.rust);
+    else
+        sha256_init(&h->u.c);
+}
+
+void sha256_handle_update(sha256_handle *h, const void *data, size_t len) {
+    if (h->engine == SHA256_API_ENGINE_RUST)
+        rust_sha256_update64(&h->u.rust, data, len);
+    else
+        sha256_update64(&h->u.c, data, len);
+}
+
+void sha256_handle_final(sha256_handle *h, unsigned char out32[32]) {
+    if (h->engine == SHA256_API_ENGINE_RUST)
+        rust_sha256_final(&h->u.rust, out32);
+    else
+        sha256_final(&h->u.c, out32);
+}
+
+void sha256_handle_export(const sha256_handle *h, unsigned char out[SHA256_API_STATE_BYTES]) {
+    if (h->engine == SHA256_API_ENGINE_RUST)
+        rust_sha256_export(&h->u.rust, out);
+    else
+        sha256_export(&h->u.c, out);
+}
+
+int sha256_handle_import(sha256_handle *h, const unsigned char in[SHA256_API_STATE_BYTES]) {
+    if (h->engine == SHA256_API_ENGINE_RUST)
+        return rust_sha256_import(&h->u.rust, in);
+    return sha256_import(&h->u.c, in);
+}
+
+int sha256_api_hash(int engine, const void *data, size_t len, unsigned char out32[32]) {
+    sha256_handle h;
+
+    if (!sha256_handle_init(&h, engine))
+        return -1;
+    sha256_handle_update(&h, data, len);
+    sha256_handle_final(&h, out32);
+    return 0;
+}
@@ -0,0 +1,123 @@
+/* sha256_api.h
+ *
+ * Stable public interface of libsha256.so / libsha256.a: both
+ * engines (the C core and the Rust core) behind one opaque handle.
+ *
+ * Everything a caller needs to link against the library is here.
+ * Nothing in this header depends on the layout of struct sha256_ctx or
+ * RustSha256Ctx, so those can change without breaking programs built
+ * against it. Only the symbols declared here are exported (see
+ * sha256.map); the ABI major version is SHA256_API_VERSION and the
+ * shared object is libsha256.so.1.
+ *
+ * A handle is SHA256_HANDLE_SIZE bytes aligned to SHA256_HANDLE_ALIGN
+ * (one 64-byte cache-line pair), so handles packed in an array never
+ * share a cache line between threads and never straddle one.
+ *
+ * Typical usage:
+ *   sha256_handle *h = sha256_handle_new(SHA256_API_ENGINE_C);
+ *   sha256_handle_update(h, data, len);
+ *   sha256_handle_final(h, out32);
+ *   sha256_handle_free(h);
+ *
+ * Or many handles in caller-owned memory:
+ *   void *mem = aligned_alloc(SHA256_HANDLE_ALIGN, n * SHA256_HANDLE_SIZE);
+ *   for (i = 0; i < n; ++i)
+ *       hs[i] = sha256_handle_init((char *)mem + i * SHA256_HANDLE_SIZE,
+ *                                  SHA256_API_ENGINE_RUST);
+ */
+
+#ifndef SHA256_API_H
+#define SHA256_API_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHA256_API_VERSION   1     // bumped on any incompatible change
+
+#define SHA256_HANDLE_SIZE   128   // bytes per handle
+#define SHA256_HANDLE_ALIGN  64    // required alignment of a handle
+
+#define SHA256_API_STATE_BYTES 112 // sha256_handle_export() output
+
+// Engines
+#define SHA256_API_ENGINE_C     0  // C core (sha256.c)
+#define SHA256_API_ENGINE_RUST  1  // Rust core (src/lib.rs)
+
+typedef struct sha256_handle sha256_handle;
+
+/* sha256_api_version()
+ * SHA256_API_VERSION of the library actually loaded.
+ */
+int sha256_api_version(void);
+
+/* sha256_api_backend()
+ * Compression backend an engine runs on this CPU ("scalar",
+ * "sha-ni", "armv8-sha2"), or NULL for an unknown engine.
+ */
+const char *sha256_api_backend(int engine);
+
+/* sha256_handle_new()
+ * Allocate and initialize an aligned handle.
+ * Returns NULL on an unknown engine or out of memory.
+ */
+sha256_handle *sha256_handle_new(int engine);
+
+/* sha256_handle_free()
+ * Free a handle from sha256_handle_new(). NULL is ignored.
+ */
+void sha256_handle_free(sha256_handle *h);
+
+/* sha256_handle_init()
+ * Initialize a handle in caller memory: SHA256_HANDLE_SIZE bytes
+ * aligned to SHA256_HANDLE_ALIGN. Returns the handle, or NULL if mem
+ * is misaligned or the engine is unknown. Nothing to free afterwards.
+ */
+sha256_handle *sha256_handle_init(void *mem, int engine);
+
+/* sha256_handle_engine()
+ * Engine the handle was created with.
+ */
+int sha256_handle_engine(const sha256_handle *h);
+
+/* sha256_handle_reset()
+ * Start a new message on the same engine.
+ */
+void sha256_handle_reset(sha256_handle *h);
+
+/* sha256_handle_update()
+ * Feed len bytes of data; any length, any number of calls.
+ */
+void sha256_handle_update(sha256_handle *h, const void *data, size_t len);
+
+/* sha256_handle_final()
+ * Write the 32-byte digest. Call sha256_handle_reset() before reuse.
+ */
+void sha256_handle_final(sha256_handle *h, unsigned char out32[32]);
+
+/* sha256_handle_export()
+ * Save the running state in the versioned layout shared by both
+ * engines, so it can be resumed later, elsewhere or on the other one.
+ */
+void sha256_handle_export(const sha256_handle *h, unsigned char out[SHA256_API_STATE_BYTES]);
+
+/* sha256_handle_import()
+ * Resume a state from sha256_handle_export().
+ * Returns 0, or -1 (handle unchanged) if the bytes are not valid.
+ */
+int sha256_handle_import(sha256_handle *h, const unsigned char in[SHA256_API_STATE_BYTES]);
+
+/* sha256_api_hash()
+ * Hash one whole message with an engine.
+ * Returns 0, or -1 on an unknown engine.
+ */
+int sha256_api_hash(int engine, const void *data, size_t len, unsigned char out32[32]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
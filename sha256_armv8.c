@@ -0,0 +1,75 @@
+/* sha256_armv8.c
+ *
+ * SHA-256 compression using the ARMv8 SHA2 crypto extensions
+ * (SHA256H / SHA256H2 / SHA256SU0 / SHA256SU1).
+ *
+ * Only built when the compiler targets those extensions,
+ * e.g. gcc -march=armv8-a+crypto. Otherwise this file is empty
+ * and sha256.c uses the scalar path.
+ */
+
+#include "sha256_internal.h"
+
+#ifdef SHA256_HAVE_ARMV8
+
+#include <arm_neon.h>
+
+/* Four rounds: SHA256H updates ABCD, SHA256H2 updates EFGH and needs
+ * the ABCD value from before the update. */
+#define RND4(m, i) do {                                   \
+    tmp = vaddq_u32(m, vld1q_u32(&sha256_K[i]));          \
+    abcd_prev = state0;                                   \
+    state0 = vsha256hq_u32(state0, state1, tmp);          \
+    state1 = vsha256h2q_u32(state1, abcd_prev, tmp);      \
+} while (0)
+
+// Turn W[t-16..t-13] into W[t..t+3]
+#define SCHED(m0, m1, m2, m3) \
+    m0 = vsha256su1q_u32(vsha256su0q_u32(m0, m1), m2, m3)
+
+void sha256_compress_armv8(u32 h[8], const u8 *data, u64 nblocks) {
+    uint32x4_t state0, state1, abcd, efgh, abcd_prev, tmp;
+    uint32x4_t m0, m1, m2, m3;
+
+    state0 = vld1q_u32(&h[0]);
+    state1 = vld1q_u32(&h[4]);
+
+    while (nblocks--) {
+        abcd = state0;
+        efgh = state1;
+
+        // Load the block as 16 big-endian words
+        m0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 0)));
+        m1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+        m2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+        m3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+        RND4(m0,  0); SCHED(m0, m1, m2, m3);
+        RND4(m1,  4); SCHED(m1, m2, m3, m0);
+        RND4(m2,  8); SCHED(m2, m3, m0, m1);
+        RND4(m3, 12); SCHED(m3, m0, m1, m2);
+        RND4(m0, 16); SCHED(m0, m1, m2, m3);
+        RND4(m1, 20); SCHED(m1, m2, m3, m0);
+        RND4(m2, 24); SCHED(m2, m3, m0, m1);
+        RND4(m3, 28); SCHED(m3, m0, m1, m2);
+        RND4(m0, 32); SCHED(m0, m1, m2, m3);
+        RND4(m1, 36); SCHED(m1, m2, m3, m0);
+        RND4(m2, 40); SCHED(m2, m3, m0, m1);
+        RND4(m3, 44); SCHED(m3, m0, m1, m2);
+        RND4(m0, 48);
+        RND4(m1, 52);
+        RND4(m2, 56);
+        RND4(m3, 60);
+
+        // Add this block's result to the running state
+        state0 = vaddq_u32(state0, abcd);
+        state1 = vaddq_u32(state1, efgh);
+
+        data += 64;
+    }
+
+    vst1q_u32(&h[0], state0);
+    vst1q_u32(&h[4], state1);
+}
+
+#endif
@@ -0,0 +1,240 @@
+/* sha256_bench.c
+ *
+ * Throughput benchmark: C core and Rust core (every backend this CPU
+ * supports, for each) and OpenSSL's libcrypto SHA256(), over message
+ * sizes from 0 B up to 1 GiB.
+ *
+ *   sha256_bench [--json] [--max SIZE] [--cpu N] [--min-time SECONDS]
+ *
+ * Each measurement is one full hash (init + update + final) of a
+ * message of the given size, repeated for at least --min-time seconds
+ * after a warm-up pass. The thread is pinned to one core so the
+ * numbers do not jump between cores or frequency domains.
+ *
+ * Output is CSV (default) or JSON, one row per engine and size:
+ *   engine,size,iterations,ns_per_hash,cycles_per_byte,gb_per_s
+ * cycles are TSC reference cycles (x86 only; -1 elsewhere).
+ */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <openssl/sha.h>
+
+#include "sha256.h"
+#include "sha256_rust.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+// One engine under test: hash len bytes of data into out
+struct engine {
+    char name[32];
+    void (*hash)(const u8 *data, u64 len, u8 out[32]);
+    enum sha256_backend backend;   // C and Rust engines only
+};
+
+static void hash_c(const u8 *data, u64 len, u8 out[32]) {
+    struct sha256_ctx ctx;
+    sha256_init(&ctx);
+    sha256_update64(&ctx, data, len);
+    sha256_final(&ctx, out);
+}
+
+static void hash_rust(const u8 *data, u64 len, u8 out[32]) {
+    RustSha256Ctx ctx;
+    rust_sha256_init(&ctx);
+    rust_sha256_update64(&ctx, data, len);
+    rust_sha256_final(&ctx, out);
+}
+
+static void hash_openssl(const u8 *data, u64 len, u8 out[32]) {
+    SHA256(data, (size_t)len, out);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static unsigned long long cycles(void) {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// "4096", "64K", "4M", "1G" -> bytes; 0 on error
+static unsigned long long parse_size(const char *s) {
+    char *end;
+    unsigned long long v = strtoull(s, &end, 10);
+
+    switch (*end) {
+    case 'K': case 'k': v <<= 10; end++; break;
+    case 'M': case 'm': v <<= 20; end++; break;
+    case 'G': case 'g': v <<= 30; end++; break;
+    default: break;
+    }
+    return (*end == '\0') ? v : 0;
+}
+
+static void usage(FILE *out) {
+    fprintf(out,
+        "Usage: sha256_bench [options]\n"
+        "\n"
+        "  --json             JSON output instead of CSV\n"
+        "  --max SIZE         largest message size (default 1G)\n"
+        "  --cpu N            pin to CPU N (default 0; -1 to not pin)\n"
+        "  --min-time SECS    time spent per engine and size (default 0.2)\n"
+        "  -h, --help         show this help\n");
+}
+
+int main(int argc, char **argv) {
+    static const struct option longopts[] = {
+        { "json",     no_argument,       NULL, 'j' },
+        { "max",      required_argument, NULL, 'm' },
+        { "cpu",      required_argument, NULL, 'c' },
+        { "min-time", required_argument, NULL, 't' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    static const enum sha256_backend c_backends[] = {
+        SHA256_BACKEND_SCALAR, SHA256_BACKEND_SHANI, SHA256_BACKEND_ARMV8
+    };
+    struct engine engines[12];
+    int nengines = 0;
+    int json = 0, cpu = 0, first_row = 1;
+    unsigned long long max_size = 1ull << 30;
+    double min_time = 0.2;
+    u64 size;
+    u8 *data, digest[32];
+    size_t b;
+    int c, e;
+
+    while ((c = getopt_long(argc, argv, "h", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'j': json = 1; break;
+        case 'm':
+            max_size = parse_size(optarg);
+            if (max_size == 0 && strcmp(optarg, "0") != 0) {
+                fprintf(stderr, "sha256_bench: invalid size '%s'\n", optarg);
+                return 2;
+            }
+            break;
+        case 'c': cpu = atoi(optarg); break;
+        case 't': min_time = atof(optarg); break;
+        case 'h': usage(stdout); return 0;
+        default:  usage(stderr); return 2;
+        }
+    }
+
+    // Pin to one core
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+            perror("sha256_bench: sched_setaffinity");
+    }
+
+    // One C engine per backend this machine can run
+    for (b = 0; b < sizeof(c_backends) / sizeof(c_backends[0]); ++b) {
+        if (sha256_use_backend(c_backends[b]) != 0)
+            continue;
+        snprintf(engines[nengines].name, sizeof(engines[nengines].name), "c-%s", sha256_backend_name());
+        engines[nengines].hash = hash_c;
+        engines[nengines].backend = c_backends[b];
+        nengines++;
+    }
+    // Same for the Rust core
+    for (b = 0; b < sizeof(c_backends) / sizeof(c_backends[0]); ++b) {
+        if (rust_sha256_use_backend(c_backends[b]) != 0)
+            continue;
+        snprintf(engines[nengines].name, sizeof(engines[nengines].name), "rust-%s", rust_sha256_backend_name());
+        engines[nengines].hash = hash_rust;
+        engines[nengines].backend = c_backends[b];
+        nengines++;
+    }
+    strcpy(engines[nengines].name, "openssl");
+    engines[nengines++].hash = hash_openssl;
+
+    if (posix_memalign((void **)&data, 64, max_size ? max_size : 1) != 0) {
+        fprintf(stderr, "sha256_bench: cannot allocate %llu bytes\n", max_size);
+        return 1;
+    }
+    for (size = 0; size < max_size; ++size)
+        data[size] = (u8)(size * 131 + 7);
+
+    if (json)
+        printf("{\n  \"tsc_cycles\": %s,\n  \"results\": [\n", cycles() ? "true" : "false");
+    else
+        printf("engine,size,iterations,ns_per_hash,cycles_per_byte,gb_per_s\n");
+
+    // Sizes: 0, 1, 16, then powers of 4 from 64 B up to max_size
+    for (size = 0; size <= max_size; ) {
+        for (e = 0; e < nengines; ++e) {
+            struct engine *en = &engines[e];
+            unsigned long long iters, i, c0, c1;
+            double t0, t1, ns, cpb, gbs;
+
+            if (en->hash == hash_c)
+                sha256_use_backend(en->backend);
+            else if (en->hash == hash_rust)
+                rust_sha256_use_backend(en->backend);
+
+            /* Warm-up for a tenth of the measuring time (at least one
+             * hash), which also tells us how many hashes to time */
+            i = 0;
+            t0 = now_seconds();
+            do {
+                en->hash(data, size, digest);
+                i++;
+                t1 = now_seconds();
+            } while (t1 - t0 < min_time / 10);
+            iters = (unsigned long long)((double)i * min_time / (t1 - t0));
+            if (iters < 1) iters = 1;
+
+            t0 = now_seconds();
+            c0 = cycles();
+            for (i = 0; i < iters; ++i)
+                en->hash(data, size, digest);
+            c1 = cycles();
+            t1 = now_seconds();
+
+            ns = (t1 - t0) * 1e9 / (double)iters;
+            gbs = size ? (double)size / ns : 0.0;
+            cpb = (c1 && size) ? (double)(c1 - c0) / (double)iters / (double)size : -1.0;
+
+            if (json) {
+                printf("%s    { \"engine\": \"%s\", \"size\": %llu, \"iterations\": %llu, "
+                       "\"ns_per_hash\": %.1f, \"cycles_per_byte\": %.3f, \"gb_per_s\": %.3f }",
+                       first_row ? "" : ",\n", en->name, (unsigned long long)size, iters, ns, cpb, gbs);
+                first_row = 0;
+            } else {
+                printf("%s,%llu,%llu,%.1f,%.3f,%.3f\n",
+                       en->name, (unsigned long long)size, iters, ns, cpb, gbs);
+            }
+            fflush(stdout);
+        }
+
+        if (size == 0)       size = 1;
+        else if (size == 1)  size = 16;
+        else if (size == 16) size = 64;
+        else                 size *= 4;
+    }
+
+    if (json)
+        printf("\n  ]\n}\n");
+
+    free(data);
+    return 0;
+}
@@ -0,0 +1,537 @@
+/* sha256_cli.c
+ *
+ * Headless command-line front end for the C and Rust SHA-256 cores.
+ *
+ *   sha256_cli [--rust] [FILE...]            hash, sha256sum format
+ *   sha256_cli -c [--quiet|--status] [FILE]  verify a sha256sum manifest
+ *   sha256_cli --tree [-j N] [--leaf-size SIZE] [FILE...]
+ *   sha256_cli --io-uring [--queue-depth N] [FILE...]
+ *   sha256_cli --log [--log-interval SIZE] [FILE...]
+ *
+ * Prints one "<hex digest>  <name>" line per input, like sha256sum.
+ * With no FILE, or when FILE is "-", reads standard input.
+ * Regular files are hashed straight out of the page cache through
+ * mmap (sha256_file.c); pipes and network filesystems go through one
+ * large read buffer, so memory use does not depend on file size.
+ * Long file lists are hashed CLI_WINDOW files at a time on the
+ * work-stealing pool (sha256_sched.c) and printed in input order.
+ * With --log, each file keeps a FILE.s256log sidecar (sha256_log.c)
+ * so that a file that was only appended to since the last run costs
+ * just the new bytes.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sha256.h"
+#include "sha256_file.h"
+#include "sha256_log.h"
+#include "sha256_rust.h"
+#include "sha256_sched.h"
+#include "sha256_stats.h"
+#include "sha256_tree.h"
+#include "sha256_uring.h"
+
+#define CLI_WINDOW 4096   // files hashed per sha256_sched_files() call
+
+struct cli_opts {
+    int tree;                          // --tree: parallel tree hash
+    int check;                         // -c: verify a manifest
+    int quiet;                         // --quiet: don't print OK lines
+    int status;                        // --status: print nothing, exit code only
+    int stats;                         // --stats: throughput summary on stderr
+    int log;                           // --log: resume from FILE.s256log sidecars
+    u64 log_interval;                  // --log-interval: bytes between checkpoints
+    struct sha256_tree_opts tree_opts; // also carries the engine choice
+    struct sha256_file_opts file_opts; // plain hashing: engine, --no-mmap
+};
+
+// Totals for --stats
+static u64 stat_files;
+static u64 stat_bytes;
+
+static void usage(FILE *out) {
+    fprintf(out,
+        "Usage: sha256_cli [options] [FILE...]\n"
+        "Print or check SHA-256 checksums (sha256sum format).\n"
+        "\n"
+        "  -c, --check       read checksums from FILE and verify them\n"
+        "      --quiet       with -c, don't print OK for each file\n"
+        "      --status      with -c, print nothing; the exit code tells\n"
+        "  --stats           print files/s and MB/s to stderr when done\n"
+        "                    (and the core counters in a STATS=1 build)\n"
+        "  --tree            parallel tree hash (Merkle root over fixed-size leaves;\n"
+        "                    differs from plain SHA-256)\n"
+        "  --leaf-size SIZE  tree leaf size, e.g. 65536, 4M (default 1M)\n"
+        "  -j, --threads N   worker threads for tree leaves or for many files\n"
+        "                    (default: all CPUs)\n"
+        "  --rust            hash with the Rust core instead of the C core\n"
+        "  --no-mmap         read files into a buffer instead of mapping them\n"
+        "  --io-uring        read files through io_uring where the kernel allows it\n"
+        "  --queue-depth N   io_uring reads in flight per file (default 16)\n"
+        "  --log             append-only files: keep checkpoints in FILE.s256log\n"
+        "                    and only hash what was appended since the last run\n"
+        "  --log-interval SIZE  bytes between --log checkpoints (default 64M)\n"
+        "  -h, --help        show this help\n"
+        "\n"
+        "With no FILE, or when FILE is -, read standard input.\n");
+}
+
+// "4096", "64K", "4M", "1G" -> bytes; 0 on error or overflow
+static unsigned long long parse_size(const char *s) {
+    char *end;
+    unsigned long long v;
+    int shift = 0;
+
+    errno = 0;
+    v = strtoull(s, &end, 10);
+    if (errno == ERANGE)
+        return 0;
+    switch (*end) {
+    case 'K': case 'k': shift = 10; end++; break;
+    case 'M': case 'm': shift = 20; end++; break;
+    case 'G': case 'g': shift = 30; end++; break;
+    default: break;
+    }
+    if (*end != '\0' || v > ULLONG_MAX >> shift)
+        return 0;
+    return v << shift;
+}
+
+// Decimal count in 1..max -> *out; -1 if s is anything else
+static int parse_count(const char *s, unsigned long max, u32 *out) {
+    char *end;
+    unsigned long v;
+
+    if (*s < '0' || *s > '9')
+        return -1;   // strtoul() would take "-1" or " 1"
+    errno = 0;
+    v = strtoul(s, &end, 10);
+    if (errno == ERANGE || *end != '\0' || v == 0 || v > max)
+        return -1;
+    *out = (u32)v;
+    return 0;
+}
+
+// Open a named input; "-" is standard input
+static int open_input(const char *path) {
+    return strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+}
+
+// Plain SHA-256: mmap or buffered reads, see sha256_file.h
+static int hash_stream(const char *path, const struct cli_opts *o, u8 out[32]) {
+    u64 len = 0;
+    int rc, err;
+    int fd;
+
+    // --log: C core from the sidecar's checkpoint; pipes have no sidecar
+    if (o->log && strcmp(path, "-") != 0) {
+        u64 hashed = 0;
+        rc = sha256_log_file(path, NULL, o->log_interval, out, &len, &hashed);
+        if (rc == 0)
+            stat_bytes += hashed;   // what had to be read, not the file size
+        return rc;
+    }
+
+    fd = open_input(path);
+    if (fd < 0)
+        return -1;
+
+    rc = sha256_file_fd(fd, &o->file_opts, out, &len);
+    err = errno;
+    if (rc == 0)
+        stat_bytes += len;
+
+    if (fd != STDIN_FILENO)
+        close(fd);
+    errno = err;
+    return rc;
+}
+
+static int hash_tree(const char *path, const struct cli_opts *o, u8 out[32]) {
+    int fd = open_input(path);
+    struct stat st;
+    int rc;
+
+    if (fd < 0)
+        return -1;
+
+    rc = sha256_tree_fd(fd, &o->tree_opts, out);
+    if (rc == 0 && fstat(fd, &st) == 0) {
+        stat_bytes += (u64)st.st_size;
+    } else if (rc != 0 && errno == ESPIPE) {
+        // Pipes and files that report no size: leaves need random access
+        struct sha256_file_data file;
+        rc = sha256_file_load(fd, 0, &file);
+        if (rc == 0) {
+            rc = sha256_tree_hash(file.data, file.len, &o->tree_opts, out);
+            stat_bytes += file.len;
+            sha256_file_release(&file);
+        }
+    }
+
+    if (fd != STDIN_FILENO)
+        close(fd);
+    return rc;
+}
+
+static int hash_file(const char *path, const struct cli_opts *o, u8 out[32]) {
+    int rc = o->tree ? hash_tree(path, o, out) : hash_stream(path, o, out);
+    if (rc == 0)
+        stat_files++;
+    return rc;
+}
+
+/* Hash n named files into files[] (errno in .error), in parallel
+ * unless an input is standard input or --tree already parallelises
+ * within each file. */
+static void hash_files(char *const names[], u32 n, const struct cli_opts *o,
+                       struct sha256_sched_file *files) {
+    struct sha256_sched_file_opts opts;
+    int serial = o->tree || o->log || n == 1;
+    u32 i;
+
+    for (i = 0; i < n; ++i) {
+        files[i].path = names[i];
+        files[i].error = 0;
+        if (strcmp(names[i], "-") == 0)
+            serial = 1;
+    }
+
+    memset(&opts, 0, sizeof(opts));
+    opts.sched.threads = o->tree_opts.threads;
+    opts.engine = o->file_opts.engine;
+    opts.flags = o->file_opts.flags;
+    opts.queue_depth = o->file_opts.queue_depth;
+    if (!serial && sha256_sched_files(files, n, &opts) == 0) {
+        for (i = 0; i < n; ++i) {
+            if (files[i].error == 0) {
+                stat_files++;
+                stat_bytes += files[i].bytes;
+            }
+        }
+        return;
+    }
+
+    for (i = 0; i < n; ++i)
+        if (hash_file(names[i], o, files[i].digest) != 0)
+            files[i].error = errno;
+}
+
+// One manifest line waiting to be checked; name is NULL for a bad line
+struct check_entry {
+    char *name;
+    u8 expected[32];
+    unsigned long lineno;
+};
+
+struct check_totals {
+    unsigned long bad_format, bad_read, mismatched;
+    int any_ok;
+};
+
+/* Hash the files of n queued lines and report them in manifest order,
+ * then free the names */
+static void check_window(const char *manifest, struct check_entry *entries, u32 n,
+                         char **names, struct sha256_sched_file *files,
+                         const struct cli_opts *o, struct check_totals *t) {
+    u32 i, k = 0;
+
+    for (i = 0; i < n; ++i)
+        if (entries[i].name)
+            names[k++] = entries[i].name;
+    hash_files(names, k, o, files);
+
+    for (i = 0, k = 0; i < n; ++i) {
+        const char *name = entries[i].name;
+        const struct sha256_sched_file *f = &files[k];
+
+        if (!name) {
+            if (!o->status) {
+                fflush(stdout);
+                fprintf(stderr, "sha256_cli: %s: %lu: improperly formatted SHA256 checksum line\n",
+                        manifest, entries[i].lineno);
+            }
+            t->bad_format++;
+            continue;
+        }
+        k++;
+
+        if (f->error != 0) {
+            if (!o->status) {
+                fflush(stdout);
+                fprintf(stderr, "sha256_cli: %s: %s\n", name, strerror(f->error));
+                printf("%s: FAILED open or read\n", name);
+            }
+            t->bad_read++;
+        } else if (memcmp(f->digest, entries[i].expected, 32) != 0) {
+            if (!o->status)
+                printf("%s: FAILED\n", name);
+            t->mismatched++;
+        } else {
+            if (!o->status && !o->quiet)
+                printf("%s: OK\n", name);
+            t->any_ok = 1;
+        }
+        free(entries[i].name);
+    }
+}
+
+/* -c: verify every "<hex>  <name>" (or "<hex> *<name>") line of a
+ * sha256sum manifest, CLI_WINDOW lines at a time. Returns the exit
+ * status. */
+static int check_manifest(const char *manifest, const struct cli_opts *o) {
+    FILE *in = strcmp(manifest, "-") == 0 ? stdin : fopen(manifest, "r");
+    struct check_entry *entries = malloc(CLI_WINDOW * sizeof(*entries));
+    char **names = malloc(CLI_WINDOW * sizeof(*names));
+    struct sha256_sched_file *files = malloc(CLI_WINDOW * sizeof(*files));
+    struct check_totals t = { 0 };
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    unsigned long lineno = 0;
+    u32 queued = 0;
+
+    if (!in || !entries || !names || !files) {
+        fprintf(stderr, "sha256_cli: %s: %s\n", manifest, strerror(in ? ENOMEM : errno));
+        if (in && in != stdin)
+            fclose(in);
+        free(entries);
+        free(names);
+        free(files);
+        return 1;
+    }
+
+    while ((n = getline(&line, &cap, in)) != -1) {
+        struct check_entry *e = &entries[queued];
+
+        lineno++;
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r'))
+            line[--n] = '\0';
+        if (n == 0 || line[0] == '#')
+            continue;
+
+        e->lineno = lineno;
+        e->name = NULL;
+        if (n >= 67 && line[64] == ' ' && (line[65] == ' ' || line[65] == '*') &&
+            sha256_from_hex(line, e->expected) == 0) {
+            e->name = strdup(line + 66);
+            if (!e->name) {
+                fprintf(stderr, "sha256_cli: %s: %s\n", manifest, strerror(ENOMEM));
+                t.bad_read++;
+                break;
+            }
+        }
+        if (++queued == CLI_WINDOW) {
+            check_window(manifest, entries, queued, names, files, o, &t);
+            queued = 0;
+        }
+    }
+    check_window(manifest, entries, queued, names, files, o, &t);
+
+    free(line);
+    free(entries);
+    free(names);
+    free(files);
+    if (in != stdin)
+        fclose(in);
+
+    if (!o->status) {
+        fflush(stdout);   // the OK / FAILED lines come before the summary
+        if (t.bad_format)
+            fprintf(stderr, "sha256_cli: WARNING: %lu line%s improperly formatted\n",
+                    t.bad_format, t.bad_format == 1 ? " is" : "s are");
+        if (t.bad_read)
+            fprintf(stderr, "sha256_cli: WARNING: %lu listed file%s could not be read\n",
+                    t.bad_read, t.bad_read == 1 ? "" : "s");
+        if (t.mismatched)
+            fprintf(stderr, "sha256_cli: WARNING: %lu computed checksum%s did NOT match\n",
+                    t.mismatched, t.mismatched == 1 ? "" : "s");
+        if (!t.any_ok && !t.bad_read && !t.mismatched)
+            fprintf(stderr, "sha256_cli: %s: no properly formatted SHA256 checksum lines found\n",
+                    manifest);
+    }
+
+    return (t.bad_read || t.mismatched || !t.any_ok) ? 1 : 0;
+}
+
+// STATS=1 builds: per-engine hot-path counters, summed over all threads
+static void print_core_stats(void) {
+    static const char *const name[SHA256_STATS_ENGINES] = { "C", "Rust" };
+    u32 e;
+
+    for (e = 0; e < SHA256_STATS_ENGINES; ++e) {
+        struct sha256_stats s;
+        char line[320];
+
+        sha256_stats_get((enum sha256_stats_engine)e, &s);
+        if (s.update_calls == 0 && s.compress_calls == 0)
+            continue;
+        sha256_stats_format(&s, line, sizeof(line));
+        fprintf(stderr, "sha256_cli: %s core: %s\n", name[e], line);
+    }
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+    static const struct option longopts[] = {
+        { "check",     no_argument,       NULL, 'c' },
+        { "quiet",     no_argument,       NULL, 'q' },
+        { "status",    no_argument,       NULL, 's' },
+        { "stats",     no_argument,       NULL, 'S' },
+        { "tree",      no_argument,       NULL, 't' },
+        { "leaf-size", required_argument, NULL, 'l' },
+        { "threads",   required_argument, NULL, 'j' },
+        { "rust",      no_argument,       NULL, 'r' },
+        { "no-mmap",   no_argument,       NULL, 'M' },
+        { "io-uring",  no_argument,       NULL, 'U' },
+        { "queue-depth", required_argument, NULL, 'Q' },
+        { "log",       no_argument,       NULL, 'L' },
+        { "log-interval", required_argument, NULL, 'I' },
+        { "help",      no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    static char *stdin_only[] = { "-" };
+    struct cli_opts o;
+    char **files;
+    int nfiles, i, c, status = 0;
+    double start;
+
+    memset(&o, 0, sizeof(o));
+
+    while ((c = getopt_long(argc, argv, "cj:h", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'c':
+            o.check = 1;
+            break;
+        case 'q':
+            o.quiet = 1;
+            break;
+        case 's':
+            o.status = 1;
+            break;
+        case 'S':
+            o.stats = 1;
+            break;
+        case 't':
+            o.tree = 1;
+            break;
+        case 'l':
+            o.tree_opts.leaf_size = parse_size(optarg);
+            if (o.tree_opts.leaf_size == 0) {
+                fprintf(stderr, "sha256_cli: invalid leaf size '%s'\n", optarg);
+                return 2;
+            }
+            break;
+        case 'j':
+            if (parse_count(optarg, SHA256_SCHED_MAX_THREADS, &o.tree_opts.threads) != 0) {
+                fprintf(stderr, "sha256_cli: threads must be 1..%d\n", SHA256_SCHED_MAX_THREADS);
+                return 2;
+            }
+            break;
+        case 'r':
+            o.tree_opts.engine = SHA256_ENGINE_RUST;
+            o.file_opts.engine = SHA256_ENGINE_RUST;
+            break;
+        case 'M':
+            o.file_opts.flags |= SHA256_FILE_NO_MMAP;
+            break;
+        case 'U':
+            o.file_opts.flags |= SHA256_FILE_URING;
+            break;
+        case 'Q':
+            if (parse_count(optarg, SHA256_URING_MAX_DEPTH, &o.file_opts.queue_depth) != 0) {
+                fprintf(stderr, "sha256_cli: queue depth must be 1..%d\n", SHA256_URING_MAX_DEPTH);
+                return 2;
+            }
+            break;
+        case 'L':
+            o.log = 1;
+            break;
+        case 'I':
+            o.log_interval = parse_size(optarg);
+            if (o.log_interval == 0) {
+                fprintf(stderr, "sha256_cli: invalid log interval '%s'\n", optarg);
+                return 2;
+            }
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 2;
+        }
+    }
+
+    if (o.log && o.tree) {
+        fprintf(stderr, "sha256_cli: --log hashes plain SHA-256 and cannot be combined with --tree\n");
+        return 2;
+    }
+
+    files = argv + optind;
+    nfiles = argc - optind;
+    if (nfiles == 0) {
+        files = stdin_only;
+        nfiles = 1;
+    }
+
+    start = now_seconds();
+
+    if (o.check) {
+        for (i = 0; i < nfiles; ++i)
+            status |= check_manifest(files[i], &o);
+    } else {
+        struct sha256_sched_file *out = malloc(CLI_WINDOW * sizeof(*out));
+
+        if (!out) {
+            fprintf(stderr, "sha256_cli: %s\n", strerror(ENOMEM));
+            return 1;
+        }
+        for (i = 0; i < nfiles; i += CLI_WINDOW) {
+            u32 n = nfiles - i < CLI_WINDOW ? (u32)(nfiles - i) : CLI_WINDOW, k;
+
+            hash_files(files + i, n, &o, out);
+            for (k = 0; k < n; ++k) {
+                char hex[65];
+
+                if (out[k].error != 0) {
+                    fflush(stdout);
+                    fprintf(stderr, "sha256_cli: %s: %s\n", files[i + k], strerror(out[k].error));
+                    status = 1;
+                    continue;
+                }
+                sha256_to_hex(out[k].digest, hex);
+                printf("%s  %s\n", hex, files[i + k]);
+            }
+        }
+        free(out);
+    }
+
+    if (o.stats) {
+        double secs = now_seconds() - start;
+        if (secs <= 0) secs = 1e-9;
+        fflush(stdout);
+        fprintf(stderr, "sha256_cli: %llu files, %llu bytes in %.3f s: %.1f files/s, %.1f MB/s (%s)\n",
+                (unsigned long long)stat_files, (unsigned long long)stat_bytes, secs,
+                (double)stat_files / secs, (double)stat_bytes / secs / 1e6,
+                o.tree_opts.engine == SHA256_ENGINE_RUST ? rust_sha256_backend_name() : sha256_backend_name());
+        if (sha256_stats_enabled())
+            print_core_stats();
+    }
+
+    return status;
+}
@@ -0,0 +1,290 @@
+/* sha256_file.c
+ *
+ * Zero-copy whole-file hashing (see sha256_file.h).
+ *
+ * Mapped windows are a multiple of both the page size and the block
+ * size, so every window but the last is fed to the core as whole
+ * blocks and ctx->buffer stays empty until the tail. Mapping window
+ * by window keeps the address space use bounded on 32-bit hosts and
+ * lets each window's pages go as soon as it is done.
+ *
+ * The io_uring path hashes each chunk straight out of the registered
+ * buffer it was read into. If io_uring turns out not to work (no
+ * ring, or the kernel rejects the read opcode), the file is hashed
+ * again from the start the usual way.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+
+#include "sha256_file.h"
+#include "sha256_rust.h"
+#include "sha256_uring.h"
+
+// Either core behind one interface
+struct file_hash {
+    enum sha256_engine engine;
+    struct sha256_ctx c;
+    RustSha256Ctx rust;
+};
+
+static void fh_init(struct file_hash *fh, enum sha256_engine engine) {
+    fh->engine = engine;
+    if (engine == SHA256_ENGINE_RUST) rust_sha256_init(&fh->rust);
+    else                              sha256_init(&fh->c);
+}
+
+static void fh_update(struct file_hash *fh, const u8 *data, u64 len) {
+    if (fh->engine == SHA256_ENGINE_RUST) rust_sha256_update64(&fh->rust, data, len);
+    else                                  sha256_update64(&fh->c, data, len);
+}
+
+static void fh_final(struct file_hash *fh, u8 out[32]) {
+    if (fh->engine == SHA256_ENGINE_RUST) rust_sha256_final(&fh->rust, out);
+    else                                  sha256_final(&fh->c, out);
+}
+
+/* Network and userspace filesystems can change under a mapping or
+ * fault slowly page by page; read those into a buffer instead */
+static int is_remote_fs(int fd) {
+#ifdef __linux__
+    struct statfs sfs;
+
+    if (fstatfs(fd, &sfs) != 0)
+        return 0;
+    switch ((unsigned long)sfs.f_type) {
+    case 0x6969UL:       // NFS
+    case 0x517BUL:       // SMB
+    case 0xFF534D42UL:   // CIFS
+    case 0xFE534D42UL:   // SMB2
+    case 0x65735546UL:   // FUSE
+    case 0x00C36400UL:   // Ceph
+    case 0x01021997UL:   // 9p
+        return 1;
+    default:
+        return 0;
+    }
+#else
+    (void)fd;
+    return 0;
+#endif
+}
+
+static int hash_mapped(int fd, u64 size, struct file_hash *fh) {
+    u64 off = 0;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    while (off < size) {
+        u64 n = size - off;
+        void *map;
+
+        if (n > SHA256_FILE_MAP_WINDOW) n = SHA256_FILE_MAP_WINDOW;
+        map = mmap(NULL, (size_t)n, PROT_READ, MAP_PRIVATE, fd, (off_t)off);
+        if (map == MAP_FAILED)
+            return -1;
+        madvise(map, (size_t)n, MADV_SEQUENTIAL);
+        madvise(map, (size_t)n, MADV_WILLNEED);
+
+        fh_update(fh, map, n);
+        munmap(map, (size_t)n);
+        off += n;
+    }
+    return 0;
+}
+
+/* Buffered path. Seekable files are read with pread() from offset 0,
+ * everything else with read() from the current position. */
+static int hash_buffered(int fd, int seekable, struct file_hash *fh, u64 *len_out) {
+    u64 off = 0;
+    u8 *buf;
+
+    if (posix_memalign((void **)&buf, 4096, SHA256_FILE_BUF_SIZE) != 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (;;) {
+        ssize_t r = seekable ? pread(fd, buf, SHA256_FILE_BUF_SIZE, (off_t)off)
+                             : read(fd, buf, SHA256_FILE_BUF_SIZE);
+        if (r < 0) {
+            int err = errno;
+            if (err == EINTR) continue;
+            free(buf);
+            errno = err;
+            return -1;
+        }
+        if (r == 0)
+            break;
+        fh_update(fh, buf, (u64)r);
+        off += (u64)r;
+    }
+
+    free(buf);
+    *len_out = off;
+    return 0;
+}
+
+/* io_uring path. Returns 0, -1 on a read error, or 1 if io_uring is
+ * not usable and the caller should use another path. */
+static int hash_uring(int fd, u32 depth, struct file_hash *fh, u64 *len_out) {
+    struct sha256_uring r;
+    const u8 *data;
+    ssize_t n;
+    u64 off = 0;
+    int err;
+
+    if (sha256_uring_init(&r, fd, depth) != 0)
+        return 1;
+    while ((n = sha256_uring_next(&r, &data)) > 0) {
+        fh_update(fh, data, (u64)n);
+        off += (u64)n;
+    }
+    err = errno;
+    sha256_uring_free(&r);
+
+    if (n < 0) {
+        if (err == EINVAL || err == EOPNOTSUPP || err == ENOSYS)
+            return 1;
+        errno = err;
+        return -1;
+    }
+    *len_out = off;
+    return 0;
+}
+
+int sha256_file_fd(int fd, const struct sha256_file_opts *opts, u8 out_hash32[32], u64 *len_out) {
+    struct file_hash fh;
+    struct stat st;
+    u64 len = 0;
+    u32 flags = opts ? opts->flags : 0;
+    int regular, rc;
+
+    if (fstat(fd, &st) != 0)
+        return -1;
+    regular = S_ISREG(st.st_mode);
+
+    fh_init(&fh, opts ? opts->engine : SHA256_ENGINE_C);
+
+    if (regular && (flags & SHA256_FILE_URING)) {
+        rc = hash_uring(fd, opts->queue_depth, &fh, &len);
+        if (rc == 0)
+            goto done;
+        if (rc < 0)
+            return -1;
+        fh_init(&fh, fh.engine);   // io_uring refused: hash it the usual way
+    }
+
+    if (regular && st.st_size > 0 && !(flags & SHA256_FILE_NO_MMAP) && !is_remote_fs(fd)) {
+        len = (u64)st.st_size;
+        rc = hash_mapped(fd, len, &fh);
+        if (rc != 0 && (errno == ENODEV || errno == EACCES || errno == EINVAL)) {
+            // Filesystem refuses mappings: start over with buffered reads
+            fh_init(&fh, fh.engine);
+            rc = hash_buffered(fd, 1, &fh, &len);
+        }
+    } else {
+        rc = hash_buffered(fd, regular, &fh, &len);
+    }
+    if (rc != 0)
+        return -1;
+
+done:
+    fh_final(&fh, out_hash32);
+    if (len_out)
+        *len_out = len;
+    return 0;
+}
+
+int sha256_file_path(const char *path, const struct sha256_file_opts *opts, u8 out_hash32[32], u64 *len_out) {
+    int fd = open(path, O_RDONLY);
+    int rc, err;
+
+    if (fd < 0)
+        return -1;
+    rc = sha256_file_fd(fd, opts, out_hash32, len_out);
+    err = errno;
+    close(fd);
+    errno = err;
+    return rc;
+}
+
+// Read fd to end of file into one growing buffer; NULL with errno set
+static u8 *read_all(int fd, u64 *len_out) {
+    size_t cap = 1 << 20, len = 0;
+    u8 *buf = malloc(cap);
+
+    errno = ENOMEM;
+    while (buf) {
+        ssize_t r;
+        if (len == cap) {
+            u8 *grown = cap <= SIZE_MAX / 2 ? realloc(buf, cap * 2) : NULL;
+            if (!grown) {
+                errno = ENOMEM;
+                break;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+        r = read(fd, buf + len, cap - len);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (r == 0) {
+            *len_out = len;
+            return buf;
+        }
+        len += (size_t)r;
+    }
+    free(buf);
+    return NULL;
+}
+
+int sha256_file_load(int fd, u32 flags, struct sha256_file_data *d) {
+    struct stat st;
+
+    d->data = (const u8 *)"";
+    d->len = 0;
+    d->map = NULL;
+    d->heap = NULL;
+    if (fstat(fd, &st) != 0)
+        return -1;
+
+    if (!(flags & SHA256_FILE_NO_MMAP) && S_ISREG(st.st_mode) && st.st_size > 0
+        && (u64)st.st_size <= SIZE_MAX && !is_remote_fs(fd)) {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+            d->map = map;
+            d->data = map;
+            d->len = (u64)st.st_size;
+            return 0;
+        }
+    }
+
+    d->heap = read_all(fd, &d->len);
+    if (!d->heap)
+        return -1;
+    d->data = d->heap;
+    return 0;
+}
+
+void sha256_file_release(struct sha256_file_data *d) {
+    if (d->map)
+        munmap(d->map, (size_t)d->len);
+    free(d->heap);
+    d->map = NULL;
+    d->heap = NULL;
+}
@@ -0,0 +1,94 @@
+/* sha256_file.h
+ *
+ * Plain SHA-256 of a whole file with as few copies as possible.
+ *
+ * Regular files on local filesystems are mmap()ed window by window
+ * and handed to the core as whole 64-byte blocks, straight out of the
+ * page cache: no read() into a user buffer, and nothing copied into
+ * ctx->buffer except the final partial block. Pipes, terminals and
+ * files on network filesystems (NFS, SMB/CIFS, FUSE, Ceph) are read
+ * into one large page-aligned buffer instead, with pread() where the
+ * file is seekable and read() where it is not.
+ *
+ * With SHA256_FILE_URING, regular files are read through io_uring
+ * instead (sha256_uring.h), with queue_depth reads in flight so the
+ * device keeps working while the core hashes. That helps on fast
+ * storage and cold caches; files already in the page cache are faster
+ * through mmap. Where io_uring is missing or refused the flag is
+ * ignored.
+ *
+ * Typical usage:
+ *   struct sha256_file_opts opts = { 0 };     // C core, mmap allowed
+ *   sha256_file_path("image.iso", &opts, digest32, NULL);
+ *
+ * Like sha256_tree.c this module needs a hosted POSIX system.
+ */
+
+#ifndef SHA256_FILE_H
+#define SHA256_FILE_H
+
+#include "sha256.h"
+#include "sha256_tree.h"   // enum sha256_engine
+
+#define SHA256_FILE_MAP_WINDOW (64ull << 20)   // bytes mapped at a time
+#define SHA256_FILE_BUF_SIZE   (1u << 20)      // read()/pread() buffer
+
+// Flags for sha256_file_opts.flags
+#define SHA256_FILE_NO_MMAP 0x1   // always use the read()/pread() path
+#define SHA256_FILE_URING   0x2   // regular files: io_uring reads, if available
+
+/*
+ * File hashing options. Zero means "default": C core, mmap wherever
+ * it is safe, SHA256_URING_DEFAULT_DEPTH reads in flight.
+ */
+struct sha256_file_opts {
+    enum sha256_engine engine; // which core hashes the data
+    u32 flags;                 // SHA256_FILE_* flags
+    u32 queue_depth;           // SHA256_FILE_URING: reads in flight
+};
+
+/* sha256_file_fd()
+ * Hash the file behind fd up to end of file: a regular file from its
+ * first byte, a pipe from wherever it is now. fd is not closed.
+ * If len_out is not NULL it receives the number of bytes hashed.
+ * Returns 0, or -1 on a read or allocation error (errno is set).
+ *
+ * As with any mmap()-based reader, truncating the file while it is
+ * being hashed raises SIGBUS; use SHA256_FILE_NO_MMAP for files that
+ * other processes may shrink.
+ */
+int sha256_file_fd(int fd, const struct sha256_file_opts *opts, u8 out_hash32[32], u64 *len_out);
+
+/* sha256_file_path()
+ * Open path read-only and hash it with sha256_file_fd().
+ */
+int sha256_file_path(const char *path, const struct sha256_file_opts *opts, u8 out_hash32[32], u64 *len_out);
+
+/*
+ * Whole file in memory, for callers that need every byte at once
+ * (several engines over the same data, random access for tree leaves).
+ * Regular files on local filesystems are mapped whole, with
+ * MADV_SEQUENTIAL; everything else (pipes, empty or special files,
+ * network filesystems, a failed mmap()) is read to end of file into
+ * a growing heap buffer.
+ */
+struct sha256_file_data {
+    const u8 *data;            // len bytes, never NULL ("" when empty)
+    u64 len;
+    void *map;                 // whole-file mapping, or NULL
+    u8 *heap;                  // read() buffer, or NULL
+};
+
+/* sha256_file_load()
+ * Load the file behind fd; flags are SHA256_FILE_* (SHA256_FILE_NO_MMAP
+ * always reads). fd can be closed right after. Returns 0, or -1 with
+ * errno set and nothing to release.
+ */
+int sha256_file_load(int fd, u32 flags, struct sha256_file_data *d);
+
+/* sha256_file_release()
+ * Unmap or free what sha256_file_load() set up.
+ */
+void sha256_file_release(struct sha256_file_data *d);
+
+#endif
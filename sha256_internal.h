@@ -0,0 +1,177 @@
+/* sha256_internal.h
+ *
+ * Private declarations shared between the C SHA-256 core (sha256.c)
+ * and its hardware backends. Not part of the public API: only the
+ * sha256*.c files include this.
+ */
+
+#ifndef SHA256_INTERNAL_H
+#define SHA256_INTERNAL_H
+
+#include "sha256.h"
+
+/* rotate-right: rotates the bits of x to the right by n positions.
+ * A macro rather than a function so the round macros below also work
+ * on GCC vector types (sha256_mb.c runs them on 4/8/16 lanes at once).
+ */
+#define ROTR(x,n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+// SHA-256 logical functions (as defined in the FIPS-180-4 standard)
+#define CH(x,y,z)  ((x & y) ^ (~x & z))        // choose: picks y or z based on x
+#define MAJ(x,y,z) ((x & y) ^ (x & z) ^ (y & z)) // majority: majority vote among x,y,z
+#define BSIG0(x)   (ROTR(x,2) ^ ROTR(x,13) ^ ROTR(x,22)) // big sigma 0
+#define BSIG1(x)   (ROTR(x,6) ^ ROTR(x,11) ^ ROTR(x,25)) // big sigma 1
+#define SSIG0(x)   (ROTR(x,7) ^ ROTR(x,18) ^ (x >> 3))   // small sigma 0
+#define SSIG1(x)   (ROTR(x,17) ^ ROTR(x,19) ^ (x >> 10)) // small sigma 1
+
+// Round constants (defined in sha256.c)
+extern const u32 sha256_K[64];
+
+/*
+ * Word-wide memory access, still without libc.
+ * With GCC/Clang we go through may_alias types with alignment 1:
+ * the compiler emits plain (unaligned) word loads and stores where
+ * the CPU allows them, and never turns them into memcpy() calls,
+ * even at -O0. Other compilers fall back to byte accesses.
+ */
+#if defined(__GNUC__) && defined(__BYTE_ORDER__)
+#define SHA256_WORD_ACCESS 1
+typedef u32 __attribute__((may_alias, aligned(1))) u32_unaligned;
+typedef u64 __attribute__((may_alias, aligned(1))) u64_unaligned;
+typedef u32 __attribute__((may_alias)) u32_aligned;
+typedef __UINTPTR_TYPE__ sha256_uptr;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SHA256_BE32(x) __builtin_bswap32(x)
+#else
+#define SHA256_BE32(x) (x)
+#endif
+#endif
+
+// Byte copy (manual memcpy replacement), 8 bytes at a time where possible
+static inline void memcopy_bytes(u8 *dst, const u8 *src, u32 n) {
+#ifdef SHA256_WORD_ACCESS
+    while (n >= 8) {
+        *(u64_unaligned *)dst = *(const u64_unaligned *)src;
+        dst += 8;
+        src += 8;
+        n -= 8;
+    }
+    if (n >= 4) {
+        *(u32_unaligned *)dst = *(const u32_unaligned *)src;
+        dst += 4;
+        src += 4;
+        n -= 4;
+    }
+#endif
+    while (n > 0) {
+        *dst++ = *src++;
+        n--;
+    }
+}
+
+// Byte fill with zeros (manual memset replacement), same idea
+static inline void zero_bytes(u8 *dst, u32 n) {
+#ifdef SHA256_WORD_ACCESS
+    while (n >= 8) {
+        *(u64_unaligned *)dst = 0;
+        dst += 8;
+        n -= 8;
+    }
+#endif
+    while (n > 0) {
+        *dst++ = 0;
+        n--;
+    }
+}
+
+/* Zero key material. The empty asm claims to read the buffer, so the
+ * stores survive even when the buffer is a local about to go out of
+ * scope; plain zero_bytes() there is a dead store the compiler drops. */
+static inline void wipe_bytes(void *p, u32 n) {
+    zero_bytes((u8 *)p, n);
+    __asm__ __volatile__("" : : "r"(p) : "memory");
+}
+
+// Read a 32-bit big-endian word
+static inline u32 load_be32(const u8 *p) {
+#ifdef SHA256_WORD_ACCESS
+    return SHA256_BE32(*(const u32_unaligned *)p);
+#else
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | (u32)p[3];
+#endif
+}
+
+// Write a 32-bit big-endian word
+static inline void store_be32(u8 *p, u32 v) {
+#ifdef SHA256_WORD_ACCESS
+    *(u32_unaligned *)p = SHA256_BE32(v);
+#else
+    p[0] = (u8)(v >> 24);
+    p[1] = (u8)(v >> 16);
+    p[2] = (u8)(v >> 8);
+    p[3] = (u8)v;
+#endif
+}
+
+/* First outlen bytes (at most 32) of the big-endian state: the digest
+ * and its truncations. Inlined, so a constant outlen leaves only the
+ * stores it needs. */
+static inline void store_digest(u8 *out, const u32 h[8], u32 outlen) {
+    u32 i;
+
+    for (i = 0; i + 4 <= outlen; i += 4)
+        store_be32(&out[i], h[i / 4]);
+    for (; i < outlen; ++i)
+        out[i] = (u8)(h[i / 4] >> (24 - 8 * (i % 4)));
+}
+
+/* Aligned input fast path: on CPUs without cheap unaligned loads
+ * (many embedded cores) the unaligned load_be32 above turns back into
+ * four byte loads. When the block is 4-byte aligned a plain word load
+ * is safe, so the message schedule uses that instead. */
+#ifdef SHA256_WORD_ACCESS
+#define sha256_aligned4(p)     (((sha256_uptr)(p) & 3) == 0)
+#define load_be32_aligned(p)   SHA256_BE32(*(const u32_aligned *)(p))
+#else
+#define sha256_aligned4(p)     0
+#define load_be32_aligned(p)   load_be32(p)
+#endif
+
+/*
+ * Compression function signature used by every backend:
+ * mixes nblocks consecutive 64-byte blocks into the 8-word state h,
+ * keeping the state in registers for the whole run.
+ */
+typedef void (*sha256_compress_fn)(u32 h[8], const u8 *data, u64 nblocks);
+
+/* Run nblocks consecutive blocks through the active backend.
+ * Used by the other C modules (multi-lane engine) for lanes they
+ * hash one at a time. */
+void sha256_compress_blocks(u32 h[8], const u8 *data, u64 nblocks);
+
+// Backend in use (resolving it first if nothing has been hashed yet)
+enum sha256_backend sha256_active_backend(void);
+
+/*
+ * Intel/AMD SHA extensions (sha256_shani.c).
+ * Built with GCC/Clang on x86; only called after the CPUID check passes.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_HAVE_SHANI 1
+void sha256_compress_shani(u32 h[8], const u8 *data, u64 nblocks);
+int  sha256_cpu_has_shani(void);
+#endif
+
+/*
+ * ARMv8 SHA2 crypto extensions (sha256_armv8.c).
+ * There is no portable user-space way to probe for them, so this
+ * backend is only built when the compiler targets them
+ * (e.g. -march=armv8-a+crypto), and is then always usable.
+ */
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define SHA256_HAVE_ARMV8 1
+void sha256_compress_armv8(u32 h[8], const u8 *data, u64 nblocks);
+#endif
+
+#endif
@@ -0,0 +1,211 @@
+/* sha256_kdf.c
+ *
+ * PBKDF2 and HKDF over HMAC-SHA256 (see sha256_kdf.h).
+ *
+ * PBKDF2 inner loop: U_j = HMAC(P, U_{j-1}) with a 32-byte U, i.e.
+ *
+ *   inner = compress(key.inner_h, U_{j-1} || pad)
+ *   U_j   = compress(key.outer_h, inner   || pad)
+ *
+ * where pad is the same 0x80 / zeros / 768-bit length tail both
+ * times. Each lane keeps one 64-byte block with that tail written
+ * once; only the first 32 bytes change between compressions, and
+ * nothing goes through the sha256_ctx buffering or sha256_final.
+ */
+
+#include "sha256_kdf.h"
+#include "sha256_internal.h"
+#include "sha256_mb.h"
+
+#define PBKDF2_MAX_OUT (0xffffffffull * 32)
+
+// One (password, output block) pair of a PBKDF2 call
+struct pbkdf2_lane {
+    struct hmac_sha256_key key;
+    u32 u[8];          // U_j
+    u32 t[8];          // U_1 ^ ... ^ U_j
+    u8 block[64];      // 32 message bytes, then the fixed padding
+    u8 *out;           // this block's share of the output
+    u32 outlen;        // 1..32
+};
+
+static void store_words(u8 *p, const u32 w[8]) {
+    u32 i;
+    for (i = 0; i < 8; ++i)
+        store_be32(&p[i * 4], w[i]);
+}
+
+/* Compress one block per lane. A single lane goes straight to the
+ * core backend; more go through the SIMD lane kernels. */
+static void compress_lanes(u32 *const st[], const u8 *const blk[], u32 n) {
+    static const u64 one[SHA256_MB_MAX_LANES] = {
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+    };
+
+    if (n == 1)
+        sha256_compress_blocks(st[0], blk[0], 1);
+    else
+        sha256_mb_blocks(st, blk, one, n);
+}
+
+// U_1 for lane l: HMAC(P, S || INT(index)), then set up the 32-byte block
+static void lane_start(struct pbkdf2_lane *l, const struct sha256_pbkdf2_job *job, u32 index) {
+    struct hmac_sha256_ctx ctx;
+    u8 be_index[4];
+    u32 i;
+
+    hmac_sha256_key_init(&l->key, job->pw, job->pwlen);
+    store_be32(be_index, index);
+    hmac_sha256_init(&ctx, &l->key);
+    hmac_sha256_update(&ctx, job->salt, job->saltlen);
+    hmac_sha256_update(&ctx, be_index, 4);
+    hmac_sha256_final(&ctx, l->block);
+
+    for (i = 0; i < 8; ++i)
+        l->t[i] = l->u[i] = load_be32(&l->block[i * 4]);
+
+    // 32-byte message after one key block: 768 bits
+    l->block[32] = 0x80;
+    zero_bytes(&l->block[33], 64 - 33 - 4);
+    store_be32(&l->block[60], 768);
+}
+
+// Iterations 2..c for n lanes at once, then write the outputs
+static void lanes_run(struct pbkdf2_lane *lanes, u32 n, u32 iterations) {
+    u32 st[SHA256_MB_MAX_LANES][8];
+    u32 *stp[SHA256_MB_MAX_LANES];
+    const u8 *blk[SHA256_MB_MAX_LANES];
+    u32 j, l, i;
+
+    for (l = 0; l < n; ++l) {
+        stp[l] = st[l];
+        blk[l] = lanes[l].block;
+    }
+
+    for (j = 1; j < iterations; ++j) {
+        // inner = H(key ^ ipad || U_{j-1}); block already holds U_{j-1}
+        for (l = 0; l < n; ++l)
+            for (i = 0; i < 8; ++i) st[l][i] = lanes[l].key.inner_h[i];
+        compress_lanes(stp, blk, n);
+
+        // U_j = H(key ^ opad || inner)
+        for (l = 0; l < n; ++l) {
+            store_words(lanes[l].block, st[l]);
+            for (i = 0; i < 8; ++i) st[l][i] = lanes[l].key.outer_h[i];
+        }
+        compress_lanes(stp, blk, n);
+
+        for (l = 0; l < n; ++l) {
+            for (i = 0; i < 8; ++i) {
+                lanes[l].u[i] = st[l][i];
+                lanes[l].t[i] ^= st[l][i];
+            }
+            store_words(lanes[l].block, lanes[l].u);
+        }
+    }
+
+    for (l = 0; l < n; ++l) {
+        u8 t[32];
+        store_words(t, lanes[l].t);
+        memcopy_bytes(lanes[l].out, t, lanes[l].outlen);
+        wipe_bytes(t, 32);
+        wipe_bytes(&lanes[l], sizeof(lanes[l]));   // key material
+    }
+    wipe_bytes(st, sizeof(st));
+}
+
+int sha256_pbkdf2_batch(const struct sha256_pbkdf2_job *jobs, u32 n, u32 iterations) {
+    struct pbkdf2_lane lanes[SHA256_MB_MAX_LANES];
+    u32 nl = 0, k;
+
+    if (iterations == 0)
+        return -1;
+    for (k = 0; k < n; ++k)
+        if (jobs[k].outlen > PBKDF2_MAX_OUT)
+            return -1;
+
+    // Every output block of every job becomes one lane
+    for (k = 0; k < n; ++k) {
+        u64 off;
+        u32 index = 1;
+
+        for (off = 0; off < jobs[k].outlen; off += 32, ++index) {
+            struct pbkdf2_lane *l = &lanes[nl];
+            u64 left = jobs[k].outlen - off;
+
+            lane_start(l, &jobs[k], index);
+            l->out = jobs[k].out + off;
+            l->outlen = left < 32 ? (u32)left : 32;
+
+            if (++nl == SHA256_MB_MAX_LANES) {
+                lanes_run(lanes, nl, iterations);
+                nl = 0;
+            }
+        }
+    }
+    if (nl)
+        lanes_run(lanes, nl, iterations);
+    return 0;
+}
+
+int sha256_pbkdf2(const u8 *pw, u64 pwlen, const u8 *salt, u64 saltlen,
+                  u32 iterations, u8 *out, u64 outlen) {
+    struct sha256_pbkdf2_job job;
+
+    job.pw = pw;
+    job.pwlen = pwlen;
+    job.salt = salt;
+    job.saltlen = saltlen;
+    job.out = out;
+    job.outlen = outlen;
+    return sha256_pbkdf2_batch(&job, 1, iterations);
+}
+
+void sha256_hkdf_extract(const u8 *salt, u64 saltlen, const u8 *ikm, u64 ikmlen, u8 prk[32]) {
+    struct hmac_sha256_key key;
+
+    // An empty key and 32 zero bytes pad to the same HMAC block
+    hmac_sha256_key_init(&key, salt, saltlen);
+    hmac_sha256(&key, ikm, ikmlen, prk);
+    wipe_bytes(&key, sizeof(key));
+}
+
+int sha256_hkdf_expand(const u8 prk[32], const u8 *info, u64 infolen, u8 *out, u64 outlen) {
+    struct hmac_sha256_key key;
+    u8 t[32];
+    u64 off;
+    u8 counter = 1;
+
+    if (outlen > 255 * 32)
+        return -1;
+
+    // T(i) = HMAC(PRK, T(i-1) || info || i); the key pads are done once
+    hmac_sha256_key_init(&key, prk, 32);
+    for (off = 0; off < outlen; off += 32, ++counter) {
+        struct hmac_sha256_ctx ctx;
+        u64 left = outlen - off;
+
+        hmac_sha256_init(&ctx, &key);
+        if (counter > 1)
+            hmac_sha256_update(&ctx, t, 32);
+        hmac_sha256_update(&ctx, info, infolen);
+        hmac_sha256_update(&ctx, &counter, 1);
+        hmac_sha256_final(&ctx, t);
+        memcopy_bytes(out + off, t, left < 32 ? (u32)left : 32);
+    }
+
+    wipe_bytes(t, 32);
+    wipe_bytes(&key, sizeof(key));
+    return 0;
+}
+
+int sha256_hkdf(const u8 *salt, u64 saltlen, const u8 *ikm, u64 ikmlen,
+                const u8 *info, u64 infolen, u8 *out, u64 outlen) {
+    u8 prk[32];
+    int rc;
+
+    sha256_hkdf_extract(salt, saltlen, ikm, ikmlen, prk);
+    rc = sha256_hkdf_expand(prk, info, infolen, out, outlen);
+    wipe_bytes(prk, 32);
+    return rc;
+}
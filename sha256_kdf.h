@@ -0,0 +1,69 @@
+/* sha256_kdf.h
+ *
+ * Key derivation on top of HMAC-SHA256:
+ *   PBKDF2-HMAC-SHA256 (RFC 8018)  - password hashing
+ *   HKDF-SHA256        (RFC 5869)  - extract-and-expand
+ *
+ * PBKDF2 spends almost all of its time in the iteration loop, where
+ * every step is HMAC of a 32-byte value: two compressions over one
+ * block whose padding never changes. That loop runs on the cached
+ * HMAC key midstates with prebuilt padding blocks, and packs every
+ * (password, output block) pair of a call into the multi-buffer
+ * lanes (sha256_mb_blocks), so several passwords or a long output
+ * are derived side by side.
+ *
+ * Typical usage:
+ *   u8 dk[32];
+ *   sha256_pbkdf2(pw, pwlen, salt, saltlen, 600000, dk, sizeof(dk));
+ *
+ * Like sha256.c this only needs the compiler, no libc.
+ */
+
+#ifndef SHA256_KDF_H
+#define SHA256_KDF_H
+
+#include "sha256.h"
+
+/* sha256_pbkdf2()
+ * Derive outlen bytes from a password and salt with the given
+ * iteration count. Returns 0, or -1 if iterations is 0 or outlen is
+ * too large ((2^32 - 1) * 32 bytes).
+ */
+int sha256_pbkdf2(const u8 *pw, u64 pwlen, const u8 *salt, u64 saltlen,
+                  u32 iterations, u8 *out, u64 outlen);
+
+// One password for sha256_pbkdf2_batch()
+struct sha256_pbkdf2_job {
+    const u8 *pw;
+    u64 pwlen;
+    const u8 *salt;
+    u64 saltlen;
+    u8 *out;
+    u64 outlen;
+};
+
+/* sha256_pbkdf2_batch()
+ * Same as calling sha256_pbkdf2() on each job with one shared
+ * iteration count, but all output blocks of all jobs run in parallel
+ * lanes. Returns 0, or -1 (nothing written) on the conditions above.
+ */
+int sha256_pbkdf2_batch(const struct sha256_pbkdf2_job *jobs, u32 n, u32 iterations);
+
+/* sha256_hkdf_extract()
+ * PRK = HMAC(salt, ikm). An empty salt means 32 zero bytes (RFC 5869).
+ */
+void sha256_hkdf_extract(const u8 *salt, u64 saltlen, const u8 *ikm, u64 ikmlen, u8 prk[32]);
+
+/* sha256_hkdf_expand()
+ * Expand a PRK into outlen bytes bound to info.
+ * Returns 0, or -1 if outlen is over 255 * 32 bytes.
+ */
+int sha256_hkdf_expand(const u8 prk[32], const u8 *info, u64 infolen, u8 *out, u64 outlen);
+
+/* sha256_hkdf()
+ * Extract then expand in one call.
+ */
+int sha256_hkdf(const u8 *salt, u64 saltlen, const u8 *ikm, u64 ikmlen,
+                const u8 *info, u64 infolen, u8 *out, u64 outlen);
+
+#endif
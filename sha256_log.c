@@ -0,0 +1,367 @@
+/* sha256_log.c
+ *
+ * Rolling hash of append-only files (see sha256_log.h).
+ *
+ * The interval is a whole number of blocks, so at every checkpoint
+ * ctx->buffer is empty and the state is fully described by h[8] and
+ * the offset: a checkpoint is 32 bytes, in memory and in the sidecar.
+ * Appends are cut at the checkpoint offsets and everything in between
+ * goes to sha256_update64() in one call, so whole blocks still reach
+ * the backend in long runs.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sha256_log.h"
+#include "sha256_internal.h"
+
+#define LOG_HEAD      136          // sidecar bytes before the checkpoints
+#define LOG_BUF_SIZE  (1u << 20)   // pread() buffer for new bytes
+
+static const u8 log_magic[4] = { 'S', '2', 'L', 'G' };
+
+static void store_be64(u8 *p, u64 v) {
+    store_be32(p, (u32)(v >> 32));
+    store_be32(p + 4, (u32)v);
+}
+
+static u64 load_be64(const u8 *p) {
+    return (u64)load_be32(p) << 32 | load_be32(p + 4);
+}
+
+// Room for n checkpoints in all; 0, or -1 with ENOMEM
+static int log_reserve(struct sha256_log *log, u64 n) {
+    u32 (*grown)[8];
+    u64 cap = log->cap ? log->cap : 16;
+
+    if (n <= log->cap)
+        return 0;
+    while (cap < n)
+        cap *= 2;
+    if (cap > SIZE_MAX / sizeof(*log->ckpt) || !(grown = realloc(log->ckpt, cap * sizeof(*log->ckpt)))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    log->ckpt = grown;
+    log->cap = cap;
+    return 0;
+}
+
+void sha256_log_init(struct sha256_log *log, u64 interval) {
+    if (interval == 0)
+        interval = SHA256_LOG_DEFAULT_INTERVAL;
+    log->interval = (interval + 63) & ~63ull;
+    log->ckpt = NULL;
+    log->cap = 0;
+    sha256_log_reset(log);
+}
+
+void sha256_log_free(struct sha256_log *log) {
+    free(log->ckpt);
+    log->ckpt = NULL;
+    log->cap = 0;
+    sha256_log_reset(log);
+}
+
+void sha256_log_reset(struct sha256_log *log) {
+    sha256_init(&log->ctx);
+    log->len = 0;
+    log->nckpt = 0;
+}
+
+int sha256_log_append(struct sha256_log *log, const u8 *data, u64 len) {
+    u64 room, n, i;
+
+    if (log_reserve(log, (log->len + len) / log->interval) != 0)
+        return -1;
+
+    while (len > 0) {
+        room = log->interval - log->len % log->interval;
+        n = len < room ? len : room;
+        sha256_update64(&log->ctx, data, n);
+        log->len += n;
+        data += n;
+        len -= n;
+        if (n == room) {
+            for (i = 0; i < 8; ++i)
+                log->ckpt[log->nckpt][i] = log->ctx.h[i];
+            log->nckpt++;
+        }
+    }
+    return 0;
+}
+
+void sha256_log_digest(const struct sha256_log *log, u8 out_hash32[32]) {
+    struct sha256_ctx ctx = log->ctx;
+    sha256_final(&ctx, out_hash32);
+}
+
+u64 sha256_log_truncate(struct sha256_log *log, u64 len) {
+    u64 k;
+
+    if (len >= log->len)
+        return log->len;
+
+    k = len / log->interval;
+    if (k == 0) {
+        sha256_init(&log->ctx);
+    } else {
+        sha256_init_iv(&log->ctx, log->ckpt[k - 1]);
+        log->ctx.bitlen = k * log->interval * 8;
+    }
+    log->nckpt = k;
+    log->len = k * log->interval;
+    return log->len;
+}
+
+static int write_all(int fd, const u8 *p, size_t n) {
+    ssize_t r;
+
+    while (n > 0) {
+        r = write(fd, p, n);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+int sha256_log_save(const struct sha256_log *log, const char *path) {
+    size_t size = LOG_HEAD + (size_t)log->nckpt * 32 + 32, plen = strlen(path);
+    u8 *buf = malloc(size);
+    char *tmp = malloc(plen + 8);
+    u64 i;
+    u32 j;
+    int fd, err;
+
+    if (!buf || !tmp) {
+        free(buf);
+        free(tmp);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    memcpy(buf, log_magic, 4);
+    buf[4] = SHA256_LOG_VERSION;
+    buf[5] = buf[6] = buf[7] = 0;
+    store_be64(buf + 8, log->interval);
+    store_be64(buf + 16, log->len);
+    sha256_export(&log->ctx, buf + 24);
+    for (i = 0; i < log->nckpt; ++i)
+        for (j = 0; j < 8; ++j)
+            store_be32(buf + LOG_HEAD + i * 32 + j * 4, log->ckpt[i][j]);
+    sha256_digest(buf, size - 32, buf + size - 32);
+
+    // Temporary file next to path, so the rename stays on one filesystem
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".XXXXXX", 8);
+    fd = mkostemp(tmp, O_CLOEXEC);
+    if (fd < 0 || write_all(fd, buf, size) != 0 || fsync(fd) != 0 || close(fd) != 0) {
+        err = errno;
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmp);
+        }
+        goto out;
+    }
+    err = rename(tmp, path) == 0 ? 0 : errno;
+    if (err)
+        unlink(tmp);
+
+out:
+    free(buf);
+    free(tmp);
+    errno = err;
+    return err ? -1 : 0;
+}
+
+static int read_all(int fd, u8 *p, size_t n) {
+    ssize_t r;
+
+    while (n > 0) {
+        r = read(fd, p, n);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (r == 0) {
+            errno = EINVAL;   // shorter than fstat() said
+            return -1;
+        }
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+// Sidecar bytes -> ctx, len and checkpoints; 0 if they are consistent
+static int log_parse(const struct sha256_log *log, const u8 *buf, size_t size,
+                     struct sha256_ctx *ctx, u64 *len) {
+    u8 sum[32];
+    u64 n;
+    u32 i;
+
+    if (size < LOG_HEAD + 32)
+        return -1;
+    sha256_digest(buf, size - 32, sum);
+    if (memcmp(sum, buf + size - 32, 32) != 0 || memcmp(buf, log_magic, 4) != 0
+        || buf[4] != SHA256_LOG_VERSION || buf[5] || buf[6] || buf[7]
+        || load_be64(buf + 8) != log->interval)
+        return -1;
+
+    *len = load_be64(buf + 16);
+    n = *len / log->interval;
+    if (n > (size - LOG_HEAD - 32) / 32 || size != LOG_HEAD + n * 32 + 32)
+        return -1;
+    if (sha256_import(ctx, buf + 24) != 0 || ctx->bitlen != *len * 8)
+        return -1;
+
+    // At a checkpoint the running state is that checkpoint
+    if (n > 0 && *len % log->interval == 0)
+        for (i = 0; i < 8; ++i)
+            if (ctx->h[i] != load_be32(buf + LOG_HEAD + (n - 1) * 32 + i * 4))
+                return -1;
+    return 0;
+}
+
+int sha256_log_load(struct sha256_log *log, const char *path) {
+    struct sha256_ctx ctx;
+    struct stat st;
+    u8 *buf = NULL;
+    u64 len, n, i;
+    u32 j;
+    int fd = open(path, O_RDONLY | O_CLOEXEC), err = 0;
+
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st) != 0) {
+        err = errno;
+    } else if (st.st_size < LOG_HEAD + 32 || (u64)st.st_size > SIZE_MAX) {
+        err = EINVAL;
+    } else if (!(buf = malloc((size_t)st.st_size))) {
+        err = ENOMEM;
+    } else if (read_all(fd, buf, (size_t)st.st_size) != 0) {
+        err = errno;
+    } else if (log_parse(log, buf, (size_t)st.st_size, &ctx, &len) != 0) {
+        err = EINVAL;
+    } else if (log_reserve(log, len / log->interval) != 0) {
+        err = ENOMEM;
+    } else {
+        n = len / log->interval;
+        for (i = 0; i < n; ++i)
+            for (j = 0; j < 8; ++j)
+                log->ckpt[i][j] = load_be32(buf + LOG_HEAD + i * 32 + j * 4);
+        log->ctx = ctx;
+        log->len = len;
+        log->nckpt = n;
+    }
+
+    free(buf);
+    close(fd);
+    errno = err;
+    return err ? -1 : 0;
+}
+
+int sha256_log_sync_fd(struct sha256_log *log, int fd) {
+    struct stat st;
+    u8 *buf;
+    ssize_t r;
+    int err = 0;
+
+    if (fstat(fd, &st) != 0)
+        return -1;
+    if (S_ISREG(st.st_mode) && (u64)st.st_size < log->len)
+        sha256_log_truncate(log, (u64)st.st_size);
+
+    buf = malloc(LOG_BUF_SIZE);
+    if (!buf) {
+        errno = ENOMEM;
+        return -1;
+    }
+    for (;;) {
+        r = pread(fd, buf, LOG_BUF_SIZE, (off_t)log->len);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            err = errno;
+            break;
+        }
+        if (r == 0)
+            break;
+        if (sha256_log_append(log, buf, (u64)r) != 0) {
+            err = errno;
+            break;
+        }
+    }
+    free(buf);
+    errno = err;
+    return err ? -1 : 0;
+}
+
+int sha256_log_file(const char *path, const char *ckpt_path, u64 interval,
+                    u8 out_hash32[32], u64 *len_out, u64 *hashed_out) {
+    struct sha256_log log;
+    struct stat st;
+    char *sidecar = NULL;
+    u64 saved = 0, from;
+    int loaded, fd, err = 0;
+
+    if (!ckpt_path) {
+        size_t plen = strlen(path);
+        sidecar = malloc(plen + sizeof(SHA256_LOG_SUFFIX));
+        if (!sidecar) {
+            errno = ENOMEM;
+            return -1;
+        }
+        memcpy(sidecar, path, plen);
+        memcpy(sidecar + plen, SHA256_LOG_SUFFIX, sizeof(SHA256_LOG_SUFFIX));
+        ckpt_path = sidecar;
+    }
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        free(sidecar);
+        return -1;
+    }
+
+    // A missing or unusable sidecar just means hashing from the start
+    sha256_log_init(&log, interval);
+    loaded = sha256_log_load(&log, ckpt_path) == 0;
+    if (loaded)
+        saved = log.len;
+
+    if (fstat(fd, &st) != 0) {
+        err = errno;
+    } else {
+        if ((u64)st.st_size < log.len)
+            sha256_log_truncate(&log, (u64)st.st_size);
+        from = log.len;
+        if (sha256_log_sync_fd(&log, fd) != 0) {
+            err = errno;
+        } else {
+            sha256_log_digest(&log, out_hash32);
+            if (len_out)
+                *len_out = log.len;
+            if (hashed_out)
+                *hashed_out = log.len - from;
+            if (!loaded || log.len != saved)
+                sha256_log_save(&log, ckpt_path);
+        }
+    }
+
+    close(fd);
+    sha256_log_free(&log);
+    free(sidecar);
+    errno = err;
+    return err ? -1 : 0;
+}
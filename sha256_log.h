@@ -0,0 +1,141 @@
+/* sha256_log.h
+ *
+ * Rolling SHA-256 of an append-only file (log segments, journals):
+ * after an append only the new bytes are hashed, not the whole file.
+ *
+ * A struct sha256_log keeps the running context over everything
+ * appended so far, plus a checkpoint every `interval` bytes: the
+ * state words at that offset. Digests are taken from a copy of the
+ * running context, so asking for one costs at most two blocks and the
+ * log keeps growing. Checkpoints are what make the state survive
+ * things a single midstate cannot: the file being cut back (crash
+ * recovery truncating a torn record) resumes from the last checkpoint
+ * at or below the new length, and rehashes at most interval bytes.
+ *
+ * The state can be saved next to the file (a "sidecar", by default
+ * FILE.s256log) so a restart does not rehash gigabytes:
+ *
+ *   sha256_log_file("segment.log", NULL, 64 << 20, digest32, NULL, NULL);
+ *
+ * loads the sidecar if there is a valid one, hashes only what was
+ * appended since, writes the sidecar back and returns the digest of the
+ * whole file. The same steps one at a time:
+ *
+ *   struct sha256_log log;
+ *   sha256_log_init(&log, 64 << 20);
+ *   sha256_log_load(&log, "segment.log.s256log");  // -1: start from 0
+ *   sha256_log_sync_fd(&log, fd);                   // hash new bytes
+ *   sha256_log_digest(&log, digest32);
+ *   sha256_log_save(&log, "segment.log.s256log");
+ *   sha256_log_free(&log);
+ *
+ * The sidecar is trusted like any cache: it is only checked against
+ * itself (a trailing SHA-256) and against the file's length, not
+ * against the data the checkpoints cover. A file that is rewritten
+ * in place rather than appended to needs sha256_log_reset().
+ *
+ * Sidecar layout, integers big-endian:
+ *   0..3      magic "S2LG"
+ *   4         layout version (SHA256_LOG_VERSION)
+ *   5..7      reserved, zero
+ *   8..15     interval in bytes
+ *   16..23    log length in bytes at save time
+ *   24..135   the running context, sha256_export() layout
+ *   136..     one 32-byte record per checkpoint: h[0..7] after
+ *             (i + 1) * interval bytes; length / interval of them
+ *   last 32   SHA-256 of every byte before it
+ *
+ * Like sha256_file.c this module needs a hosted POSIX system.
+ */
+
+#ifndef SHA256_LOG_H
+#define SHA256_LOG_H
+
+#include "sha256.h"
+
+#define SHA256_LOG_VERSION          1
+#define SHA256_LOG_DEFAULT_INTERVAL (64ull << 20)   // bytes between checkpoints
+#define SHA256_LOG_SUFFIX           ".s256log"       // default sidecar: FILE + this
+
+struct sha256_log {
+    struct sha256_ctx ctx;     // running state over the first len bytes
+    u64 len;                   // bytes appended so far
+    u64 interval;              // checkpoint spacing, a multiple of 64
+    u32 (*ckpt)[8];            // state after (i + 1) * interval bytes
+    u64 nckpt;                 // len / interval
+    u64 cap;                   // checkpoints allocated
+};
+
+/* sha256_log_init()
+ * Start an empty log with a checkpoint every interval bytes (rounded
+ * up to a whole block; 0 means SHA256_LOG_DEFAULT_INTERVAL).
+ * Allocates nothing until the first checkpoint.
+ */
+void sha256_log_init(struct sha256_log *log, u64 interval);
+
+/* sha256_log_free()
+ * Free the checkpoints. The log can be reused after sha256_log_init().
+ */
+void sha256_log_free(struct sha256_log *log);
+
+/* sha256_log_reset()
+ * Back to an empty log, same interval; the checkpoint array is kept.
+ */
+void sha256_log_reset(struct sha256_log *log);
+
+/* sha256_log_append()
+ * Hash len more bytes onto the end. Returns 0, or -1 if the room for
+ * their checkpoints cannot be allocated (errno is ENOMEM); the log is
+ * unchanged then.
+ */
+int sha256_log_append(struct sha256_log *log, const u8 *data, u64 len);
+
+/* sha256_log_digest()
+ * SHA-256 of everything appended so far. The log is not changed, so
+ * appending can go on.
+ */
+void sha256_log_digest(const struct sha256_log *log, u8 out_hash32[32]);
+
+/* sha256_log_truncate()
+ * Forget everything past the last checkpoint at or below len. Returns
+ * the new log length; the caller appends the bytes from there to len
+ * again (less than interval of them).
+ */
+u64 sha256_log_truncate(struct sha256_log *log, u64 len);
+
+/* sha256_log_save()
+ * Write the sidecar to path, atomically: to a temporary file in the
+ * same directory, fsync()ed, then renamed over path.
+ * Returns 0, or -1 with errno set.
+ */
+int sha256_log_save(const struct sha256_log *log, const char *path);
+
+/* sha256_log_load()
+ * Replace the log with the one saved at path. Returns 0, or -1 with
+ * errno set: EINVAL if the sidecar is damaged, from another layout
+ * version or another interval than the log's, ENOMEM, or whatever
+ * open()/read() reported. The log is unchanged on error.
+ */
+int sha256_log_load(struct sha256_log *log, const char *path);
+
+/* sha256_log_sync_fd()
+ * Bring the log up to date with the file behind fd: if the file got
+ * shorter than the log, truncate to it; then hash from the log length
+ * to end of file with pread(), so fd's offset is not used or moved.
+ * Returns 0, or -1 with errno set.
+ */
+int sha256_log_sync_fd(struct sha256_log *log, int fd);
+
+/* sha256_log_file()
+ * The whole warm-restart cycle for one file: load the sidecar at
+ * ckpt_path (NULL: path + SHA256_LOG_SUFFIX) if it is valid, sync
+ * with the file, save the sidecar if anything changed, and write the
+ * digest of the whole file. A sidecar that cannot be written is not
+ * an error; the digest is still right. If len_out is not NULL it
+ * receives the file length and hashed_out, if not NULL, the bytes
+ * that actually had to be read. Returns 0, or -1 with errno set.
+ */
+int sha256_log_file(const char *path, const char *ckpt_path, u64 interval,
+                    u8 out_hash32[32], u64 *len_out, u64 *hashed_out);
+
+#endif
@@ -0,0 +1,371 @@
+/* sha256_mb.c
+ *
+ * Multi-buffer SHA-256 (see sha256_mb.h).
+ *
+ * Each lane keeps an ordinary sha256_ctx. The update/final paths do
+ * the per-lane buffering in scalar code and then hand runs of whole
+ * blocks to sha256_mb_blocks(), which packs the busy lanes into SIMD
+ * passes. Lanes of different lengths drop out as they run dry; when
+ * only a few are left they go through the single-lane core instead,
+ * which is faster than a mostly empty vector pass.
+ */
+
+#include "sha256_mb.h"
+#include "sha256_internal.h"
+
+typedef void (*sha256_mb_fn)(u32 *const state[], const u8 *const data[], u64 nblocks);
+
+/*
+ * Lane kernels, one per SIMD width, generated from the same template.
+ * Needs GCC/Clang vector extensions; other compilers only get the
+ * serial path.
+ */
+#ifdef __GNUC__
+#define SHA256_MB_VECTORS 1
+
+// 4 lanes: baseline SSE2 on x86-64, NEON on AArch64
+#define MB_NAME   sha256_mb_x4
+#define MB_VEC    sha256_mb_v4
+#define MB_LANES  4
+#define MB_TARGET
+#include "sha256_mb_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA256_MB_X86 1
+#include <cpuid.h>
+
+// 8 lanes: AVX2
+#define MB_NAME   sha256_mb_x8
+#define MB_VEC    sha256_mb_v8
+#define MB_LANES  8
+#define MB_TARGET __attribute__((target("avx2")))
+#include "sha256_mb_kernel.h"
+
+// 16 lanes: AVX-512
+#define MB_NAME   sha256_mb_x16
+#define MB_VEC    sha256_mb_v16
+#define MB_LANES  16
+#define MB_TARGET __attribute__((target("avx512f")))
+#include "sha256_mb_kernel.h"
+
+// Register state the OS saves on context switch (XCR0)
+static u64 xgetbv0(void) {
+    u32 lo, hi;
+    __asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((u64)hi << 32) | lo;
+}
+
+/* AVX2 / AVX-512F usable: the CPU has them (CPUID) and the OS
+ * saves the YMM / ZMM registers (OSXSAVE + XCR0). */
+static int cpu_has_avx(u32 leaf7_bit, u64 xcr0_mask) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    if (!(ecx & (1u << 27)) || !(ecx & (1u << 28)))   // OSXSAVE, AVX
+        return 0;
+    if ((xgetbv0() & xcr0_mask) != xcr0_mask)
+        return 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return 0;
+    return (ebx & (1u << leaf7_bit)) != 0;
+}
+
+#define cpu_has_avx2()    cpu_has_avx(5, 0x06)    // YMM state
+#define cpu_has_avx512()  cpu_has_avx(16, 0xE6)   // YMM + opmask + ZMM state
+#endif
+#endif
+
+// Serial "kernel": stands in when no vector kernel is available
+static void sha256_mb_serial(u32 *const state[], const u8 *const data[], u64 nblocks) {
+    sha256_compress_blocks(state[0], data[0], nblocks);
+}
+
+static sha256_mb_fn sha256_mb_kernel;
+static u32 sha256_mb_width;
+static enum sha256_mb_backend sha256_mb_active = SHA256_MB_AUTO;
+
+/* Resolved lazily, possibly on several threads at once, so all three
+ * are accessed atomically. The kernel starts out NULL: it and the
+ * width are stored before sha256_mb_active is released, and every
+ * reader acquires sha256_mb_active before loading them. */
+static inline enum sha256_mb_backend mb_active(void) {
+    return __atomic_load_n(&sha256_mb_active, __ATOMIC_ACQUIRE);
+}
+
+static inline void mb_resolve(void) {
+    if (mb_active() == SHA256_MB_AUTO)
+        sha256_mb_use_backend(SHA256_MB_AUTO);
+}
+
+// Widest kernel this CPU can run
+static enum sha256_mb_backend sha256_mb_detect(void) {
+#ifdef SHA256_MB_X86
+    if (cpu_has_avx512())
+        return SHA256_MB_X16;
+#endif
+#ifdef SHA256_MB_VECTORS
+    // With SHA instructions one lane at a time beats 4 or 8 vector lanes
+    if (sha256_active_backend() != SHA256_BACKEND_SCALAR)
+        return SHA256_MB_SERIAL;
+#ifdef SHA256_MB_X86
+    if (cpu_has_avx2())
+        return SHA256_MB_X8;
+#endif
+    return SHA256_MB_X4;
+#else
+    return SHA256_MB_SERIAL;
+#endif
+}
+
+int sha256_mb_use_backend(enum sha256_mb_backend backend) {
+    sha256_mb_fn kernel;
+    u32 width;
+
+    if (backend == SHA256_MB_AUTO)
+        backend = sha256_mb_detect();
+
+    switch (backend) {
+    case SHA256_MB_SERIAL:
+        kernel = sha256_mb_serial;
+        width = 1;
+        break;
+#ifdef SHA256_MB_VECTORS
+    case SHA256_MB_X4:
+        kernel = sha256_mb_x4;
+        width = 4;
+        break;
+#endif
+#ifdef SHA256_MB_X86
+    case SHA256_MB_X8:
+        if (!cpu_has_avx2())
+            return -1;
+        kernel = sha256_mb_x8;
+        width = 8;
+        break;
+    case SHA256_MB_X16:
+        if (!cpu_has_avx512())
+            return -1;
+        kernel = sha256_mb_x16;
+        width = 16;
+        break;
+#endif
+    default:
+        return -1; // not built in, or not supported by this CPU
+    }
+
+    __atomic_store_n(&sha256_mb_kernel, kernel, __ATOMIC_RELAXED);
+    __atomic_store_n(&sha256_mb_width, width, __ATOMIC_RELAXED);
+    __atomic_store_n(&sha256_mb_active, backend, __ATOMIC_RELEASE);
+    return 0;
+}
+
+const char *sha256_mb_backend_name(void) {
+    mb_resolve();
+
+    switch (mb_active()) {
+    case SHA256_MB_X4:  return "x4";
+    case SHA256_MB_X8:  return "x8-avx2";
+    case SHA256_MB_X16: return "x16-avx512";
+    default:            return "serial";
+    }
+}
+
+u32 sha256_mb_lanes(void) {
+    mb_resolve();
+    return __atomic_load_n(&sha256_mb_width, __ATOMIC_RELAXED);
+}
+
+/* Up to SHA256_MB_MAX_LANES lanes: keep packing the lanes that still
+ * have blocks into kernel passes until every lane is done. */
+static void sha256_mb_group(u32 *const state[], const u8 *const data[], const u64 nblocks[], u32 n) {
+    const u8 *ptr[SHA256_MB_MAX_LANES];
+    u64 left[SHA256_MB_MAX_LANES];
+    u32 *kstate[SHA256_MB_MAX_LANES];
+    const u8 *kdata[SHA256_MB_MAX_LANES];
+    u32 pick[SHA256_MB_MAX_LANES];
+    u32 scratch[8];        // state for idle kernel lanes, discarded
+    sha256_mb_fn kernel = __atomic_load_n(&sha256_mb_kernel, __ATOMIC_RELAXED);
+    u32 width = __atomic_load_n(&sha256_mb_width, __ATOMIC_RELAXED);
+    u32 i, cnt;
+    u64 steps;
+
+    for (i = 0; i < n; ++i) {
+        ptr[i] = data[i];
+        left[i] = nblocks[i];
+    }
+
+    for (;;) {
+        // Next batch of busy lanes
+        cnt = 0;
+        for (i = 0; i < n && cnt < width; ++i)
+            if (left[i] > 0)
+                pick[cnt++] = i;
+        if (cnt == 0)
+            break;
+
+        // Under a quarter full: finish these lanes one at a time
+        if (cnt * 4 < width || width == 1) {
+            for (i = 0; i < cnt; ++i) {
+                sha256_compress_blocks(state[pick[i]], ptr[pick[i]], left[pick[i]]);
+                left[pick[i]] = 0;
+            }
+            continue;
+        }
+
+        // Run all picked lanes for as long as the shortest one lasts
+        steps = left[pick[0]];
+        for (i = 1; i < cnt; ++i)
+            if (left[pick[i]] < steps)
+                steps = left[pick[i]];
+
+        for (i = 0; i < width; ++i) {
+            if (i < cnt) {
+                kstate[i] = state[pick[i]];
+                kdata[i] = ptr[pick[i]];
+            } else {
+                kstate[i] = scratch;
+                kdata[i] = ptr[pick[0]];
+            }
+        }
+        kernel(kstate, kdata, steps);
+
+        for (i = 0; i < cnt; ++i) {
+            ptr[pick[i]] += steps * 64;
+            left[pick[i]] -= steps;
+        }
+    }
+}
+
+// Inlined into update / final, which is also where gcc can see the lanes are set
+static inline void mb_blocks(u32 *const state[], const u8 *const data[], const u64 nblocks[], u32 n) {
+    u32 base, cnt;
+
+    mb_resolve();
+
+    for (base = 0; base < n; base += cnt) {
+        cnt = n - base;
+        if (cnt > SHA256_MB_MAX_LANES)
+            cnt = SHA256_MB_MAX_LANES;
+        sha256_mb_group(state + base, data + base, nblocks + base, cnt);
+    }
+}
+
+void sha256_mb_blocks(u32 *const state[], const u8 *const data[], const u64 nblocks[], u32 n) {
+    mb_blocks(state, data, nblocks, n);
+}
+
+void sha256_mb_init(struct sha256_ctx_mb *ctx, u32 nlanes) {
+    sha256_mb_init_iv(ctx, nlanes, sha256_iv);
+}
+
+void sha256_mb_init_iv(struct sha256_ctx_mb *ctx, u32 nlanes, const u32 iv[8]) {
+    u32 i;
+
+    if (nlanes < 1)
+        nlanes = 1;
+    if (nlanes > SHA256_MB_MAX_LANES)
+        nlanes = SHA256_MB_MAX_LANES;
+
+    ctx->nlanes = nlanes;
+    for (i = 0; i < nlanes; ++i)
+        sha256_init_iv(&ctx->lane[i], iv);
+}
+
+void sha256_mb_update(struct sha256_ctx_mb *ctx, const u8 *const data[], const u32 len[]) {
+    u32 *state[SHA256_MB_MAX_LANES];
+    const u8 *ptr[SHA256_MB_MAX_LANES];
+    u64 nblocks[SHA256_MB_MAX_LANES];
+    u32 used[SHA256_MB_MAX_LANES];
+    u32 n = ctx->nlanes;
+    u32 i;
+
+    // Step 1: top up partially filled buffers
+    for (i = 0; i < n; ++i) {
+        struct sha256_ctx *lane = &ctx->lane[i];
+
+        lane->bitlen += ((u64)len[i]) * 8ull;
+        state[i] = lane->h;
+        ptr[i] = lane->buffer;
+        nblocks[i] = 0;
+        used[i] = 0;
+
+        if (lane->buflen > 0) {
+            u32 need = 64 - lane->buflen;
+            u32 take = len[i] < need ? len[i] : need;
+
+            memcopy_bytes(&lane->buffer[lane->buflen], data[i], take);
+            lane->buflen += take;
+            used[i] = take;
+            if (lane->buflen == 64) {
+                nblocks[i] = 1;
+                lane->buflen = 0;
+            }
+        }
+    }
+    mb_blocks(state, ptr, nblocks, n);
+
+    // Step 2: whole blocks straight from the input
+    for (i = 0; i < n; ++i) {
+        ptr[i] = data[i] + used[i];
+        nblocks[i] = (len[i] - used[i]) / 64;
+    }
+    mb_blocks(state, ptr, nblocks, n);
+
+    // Step 3: keep leftovers for next time
+    for (i = 0; i < n; ++i) {
+        u32 off = used[i] + (u32)nblocks[i] * 64;
+
+        if (off < len[i]) {
+            memcopy_bytes(ctx->lane[i].buffer, data[i] + off, len[i] - off);
+            ctx->lane[i].buflen = len[i] - off;
+        }
+    }
+}
+
+// Pad every lane and run the last blocks; the digests are then in lane[i].h
+static void sha256_mb_pad(struct sha256_ctx_mb *ctx) {
+    u8 pad[SHA256_MB_MAX_LANES][128];
+    u32 *state[SHA256_MB_MAX_LANES];
+    const u8 *ptr[SHA256_MB_MAX_LANES];
+    u64 nblocks[SHA256_MB_MAX_LANES];
+    u32 n = ctx->nlanes;
+    u32 i, j, end;
+
+    // Build each lane's padding: 0x80, zeros, 64-bit bit length
+    for (i = 0; i < n; ++i) {
+        struct sha256_ctx *lane = &ctx->lane[i];
+        u64 bits = lane->bitlen;
+
+        memcopy_bytes(pad[i], lane->buffer, lane->buflen);
+        pad[i][lane->buflen] = 0x80;
+        nblocks[i] = (lane->buflen < 56) ? 1 : 2;
+        end = (u32)nblocks[i] * 64;
+        for (j = lane->buflen + 1; j < end - 8; ++j)
+            pad[i][j] = 0;
+        store_be32(&pad[i][end - 8], (u32)(bits >> 32));
+        store_be32(&pad[i][end - 4], (u32)bits);
+
+        state[i] = lane->h;
+        ptr[i] = pad[i];
+    }
+    mb_blocks(state, ptr, nblocks, n);
+}
+
+void sha256_mb_final(struct sha256_ctx_mb *ctx, u8 out_hash32[][32]) {
+    u32 i;
+
+    sha256_mb_pad(ctx);
+    for (i = 0; i < ctx->nlanes; ++i)
+        store_digest(out_hash32[i], ctx->lane[i].h, 32);
+}
+
+void sha256_mb_final_len(struct sha256_ctx_mb *ctx, u8 *const out[], u32 outlen) {
+    u32 i;
+
+    if (outlen > 32)
+        outlen = 32;
+    sha256_mb_pad(ctx);
+    for (i = 0; i < ctx->nlanes; ++i)
+        store_digest(out[i], ctx->lane[i].h, outlen);
+}
@@ -0,0 +1,92 @@
+/* sha256_mb.h
+ *
+ * Multi-buffer SHA-256: hash several independent messages at once,
+ * one message per SIMD lane (4 lanes SSE2/NEON, 8 AVX2, 16 AVX-512).
+ *
+ * Typical usage:
+ *   struct sha256_ctx_mb ctx;
+ *   const u8 *msgs[8];  u32 lens[8];  u8 digests[8][32];
+ *   sha256_mb_init(&ctx, 8);
+ *   sha256_mb_update(&ctx, msgs, lens);   // any lengths, may repeat
+ *   sha256_mb_final(&ctx, digests);
+ *
+ * Digests are identical to running sha256_init/update/final on each
+ * message separately. Like sha256.c this only needs the compiler,
+ * no libc.
+ */
+
+#ifndef SHA256_MB_H
+#define SHA256_MB_H
+
+#include "sha256.h"
+
+#define SHA256_MB_MAX_LANES 16
+
+/*
+ * One ordinary sha256_ctx per lane, so each lane keeps its own
+ * partial block and length and finishes on its own.
+ */
+struct sha256_ctx_mb {
+    struct sha256_ctx lane[SHA256_MB_MAX_LANES];
+    u32 nlanes;        // lanes in use (1..SHA256_MB_MAX_LANES)
+};
+
+/* sha256_mb_init()
+ * Start nlanes independent hashes (clamped to 1..SHA256_MB_MAX_LANES).
+ */
+void sha256_mb_init(struct sha256_ctx_mb *ctx, u32 nlanes);
+
+/* sha256_mb_init_iv()
+ * Same, with every lane starting from iv (sha224_iv for SHA-224).
+ */
+void sha256_mb_init_iv(struct sha256_ctx_mb *ctx, u32 nlanes, const u32 iv[8]);
+
+/* sha256_mb_update()
+ * Feed len[i] bytes from data[i] into lane i, for every lane.
+ * Lengths may differ; a lane with len 0 is left untouched.
+ */
+void sha256_mb_update(struct sha256_ctx_mb *ctx, const u8 *const data[], const u32 len[]);
+
+/* sha256_mb_final()
+ * Pad every lane and write lane i's digest to out_hash32[i].
+ */
+void sha256_mb_final(struct sha256_ctx_mb *ctx, u8 out_hash32[][32]);
+
+/* sha256_mb_final_len()
+ * Same, writing the first outlen bytes (at most 32) of lane i's
+ * digest to out[i]: 28 for SHA-224, 16 for SHA-256/128.
+ */
+void sha256_mb_final_len(struct sha256_ctx_mb *ctx, u8 *const out[], u32 outlen);
+
+/* sha256_mb_blocks()
+ * Low-level entry point: for each of the n lanes, compress nblocks[i]
+ * whole 64-byte blocks from data[i] into the 8-word state[i].
+ * No buffering or padding. n may be larger than the SIMD width.
+ */
+void sha256_mb_blocks(u32 *const state[], const u8 *const data[], const u64 nblocks[], u32 n);
+
+/*
+ * Lane kernels. Picked once on first use from what the CPU supports.
+ */
+enum sha256_mb_backend {
+    SHA256_MB_AUTO = 0,    // widest kernel this CPU runs
+    SHA256_MB_SERIAL,      // one lane at a time through the core backend
+    SHA256_MB_X4,          // 4 lanes: SSE2 / NEON / generic vectors
+    SHA256_MB_X8,          // 8 lanes: AVX2
+    SHA256_MB_X16          // 16 lanes: AVX-512
+};
+
+/* sha256_mb_use_backend()
+ * Force a lane kernel. Returns 0 on success, -1 if unavailable.
+ * Not thread-safe: call it before hashing starts.
+ */
+int sha256_mb_use_backend(enum sha256_mb_backend backend);
+
+/* sha256_mb_backend_name() / sha256_mb_lanes()
+ * Active kernel ("serial", "x4", "x8-avx2", "x16-avx512")
+ * and how many lanes it processes per pass.
+ */
+const char *sha256_mb_backend_name(void);
+u32 sha256_mb_lanes(void);
+
+#endif
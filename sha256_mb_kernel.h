@@ -0,0 +1,90 @@
+/* sha256_mb_kernel.h
+ *
+ * Lane kernel template, included by sha256_mb.c once per SIMD width.
+ * It is the scalar compression loop from sha256.c with every u32
+ * replaced by a GCC vector of MB_LANES words: lane j of each vector
+ * belongs to message j. The round macros (CH, MAJ, BSIG0, ...) are
+ * used unchanged, since they work on vector types too.
+ *
+ * Before including, define:
+ *   MB_NAME   - name of the kernel function
+ *   MB_VEC    - name for its vector type
+ *   MB_LANES  - lanes per vector (4, 8 or 16)
+ *   MB_TARGET - function attributes selecting the ISA (may be empty)
+ */
+
+typedef u32 MB_VEC __attribute__((vector_size(MB_LANES * 4)));
+
+/* Compress nblocks blocks in each of MB_LANES lanes.
+ * state[j] and data[j] belong to lane j; every lane advances by the
+ * same number of blocks. */
+MB_TARGET
+static void MB_NAME(u32 *const state[], const u8 *const data[], u64 nblocks) {
+    MB_VEC s[8], W[16];
+    MB_VEC a, b, c, d, e, f, g, h, t1, t2;
+    u32 i, j;
+    u64 off = 0;
+
+    // Transpose the lane states: s[i] holds word i of every lane
+    for (i = 0; i < 8; ++i)
+        for (j = 0; j < MB_LANES; ++j)
+            s[i][j] = state[j][i];
+
+    while (nblocks--) {
+        a = s[0];
+        b = s[1];
+        c = s[2];
+        d = s[3];
+        e = s[4];
+        f = s[5];
+        g = s[6];
+        h = s[7];
+
+#define MB_ROUND(i) do {                                            \
+        t1 = h + BSIG1(e) + CH(e,f,g) + sha256_K[i] + W[(i) & 15];  \
+        t2 = BSIG0(a) + MAJ(a,b,c);                                 \
+        h = g;                                                      \
+        g = f;                                                      \
+        f = e;                                                      \
+        e = d + t1;                                                 \
+        d = c;                                                      \
+        c = b;                                                      \
+        b = a;                                                      \
+        a = t1 + t2;                                                \
+    } while (0)
+
+        // Rounds 0..15: gather word i of every lane's block
+        for (i = 0; i < 16; ++i) {
+            for (j = 0; j < MB_LANES; ++j)
+                W[i][j] = load_be32(data[j] + off + i * 4);
+            MB_ROUND(i);
+        }
+
+        // Rounds 16..63: extend the schedule in a 16-word ring
+        for (i = 16; i < 64; ++i) {
+            W[i & 15] += SSIG1(W[(i - 2) & 15]) + W[(i - 7) & 15] + SSIG0(W[(i - 15) & 15]);
+            MB_ROUND(i);
+        }
+
+#undef MB_ROUND
+
+        s[0] += a;
+        s[1] += b;
+        s[2] += c;
+        s[3] += d;
+        s[4] += e;
+        s[5] += f;
+        s[6] += g;
+        s[7] += h;
+        off += 64;
+    }
+
+    for (i = 0; i < 8; ++i)
+        for (j = 0; j < MB_LANES; ++j)
+            state[j][i] = s[i][j];
+}
+
+#undef MB_NAME
+#undef MB_VEC
+#undef MB_LANES
+#undef MB_TARGET
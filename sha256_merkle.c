@@ -0,0 +1,209 @@
+/* sha256_merkle.c
+ *
+ * Flat-array Merkle tree (see sha256_merkle.h).
+ *
+ * A node message is 0x01 || left || right = 65 bytes, i.e. always
+ * exactly two blocks once padded (the second holds the last byte of
+ * right, 0x80 and the 520-bit length). Building a level writes those
+ * two blocks for up to SHA256_MB_MAX_LANES parents into a scratch
+ * area and compresses them all in one sha256_mb_blocks() call.
+ */
+
+#include "sha256_merkle.h"
+#include "sha256_internal.h"
+#include "sha256_mb.h"
+
+#define NODE_MSG 128   // two padded blocks per node
+
+// Write the two padded blocks of 0x01 || left || right
+static void node_message(u8 msg[NODE_MSG], const u8 left[32], const u8 right[32]) {
+    msg[0] = 0x01;
+    memcopy_bytes(&msg[1], left, 32);
+    memcopy_bytes(&msg[33], right, 32);
+    msg[65] = 0x80;
+    zero_bytes(&msg[66], NODE_MSG - 66 - 4);
+    store_be32(&msg[NODE_MSG - 4], 65 * 8);
+}
+
+static void init_state(u32 h[8]) {
+    struct sha256_ctx ctx;
+    u32 i;
+
+    sha256_init(&ctx);
+    for (i = 0; i < 8; ++i)
+        h[i] = ctx.h[i];
+}
+
+static void state_out(const u32 h[8], u8 out[32]) {
+    u32 i;
+    for (i = 0; i < 8; ++i)
+        store_be32(&out[i * 4], h[i]);
+}
+
+// One node at a time, for path updates and verification
+static void node_hash(const u8 left[32], const u8 right[32], u8 out[32]) {
+    u8 msg[NODE_MSG];
+    u32 h[8];
+
+    node_message(msg, left, right);
+    init_state(h);
+    sha256_compress_blocks(h, msg, 2);
+    state_out(h, out);
+}
+
+u64 sha256_merkle_nodes(u64 nleaves) {
+    u64 total = 0;
+
+    if (nleaves == 0)
+        return 0;
+    while (nleaves > 1) {
+        total += nleaves;
+        nleaves = (nleaves + 1) / 2;
+    }
+    return total + 1;
+}
+
+void sha256_merkle_leaf(const u8 *data, u64 len, u8 out_leaf32[32]) {
+    struct sha256_ctx ctx;
+    static const u8 prefix = 0x00;
+
+    sha256_init(&ctx);
+    sha256_update64(&ctx, &prefix, 1);
+    sha256_update64(&ctx, data, len);
+    sha256_final(&ctx, out_leaf32);
+}
+
+int sha256_merkle_init(struct sha256_merkle *t, u8 (*nodes)[32], u64 nleaves) {
+    u64 off = 0, len = nleaves;
+    u32 l = 0;
+
+    if (nleaves == 0)
+        return -1;
+
+    for (;;) {
+        t->level_off[l] = off;
+        t->level_len[l] = len;
+        l++;
+        if (len == 1)
+            break;
+        off += len;
+        len = (len + 1) / 2;
+    }
+
+    t->node = nodes;
+    t->nleaves = nleaves;
+    t->nlevels = l;
+    return 0;
+}
+
+void sha256_merkle_build(struct sha256_merkle *t) {
+    static const u64 two[SHA256_MB_MAX_LANES] = {
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2
+    };
+    u8 msg[SHA256_MB_MAX_LANES][NODE_MSG];
+    u32 st[SHA256_MB_MAX_LANES][8];
+    u32 *stp[SHA256_MB_MAX_LANES];
+    const u8 *msgp[SHA256_MB_MAX_LANES];
+    u32 l, k;
+
+    for (k = 0; k < SHA256_MB_MAX_LANES; ++k) {
+        stp[k] = st[k];
+        msgp[k] = msg[k];
+    }
+
+    for (l = 1; l < t->nlevels; ++l) {
+        u8 (*child)[32] = t->node + t->level_off[l - 1];
+        u8 (*parent)[32] = t->node + t->level_off[l];
+        u64 npairs = t->level_len[l - 1] / 2, p = 0;
+
+        // Whole pairs, one batch of lanes at a time
+        while (p < npairs) {
+            u32 n = npairs - p < SHA256_MB_MAX_LANES ? (u32)(npairs - p) : SHA256_MB_MAX_LANES;
+
+            for (k = 0; k < n; ++k) {
+                node_message(msg[k], child[2 * (p + k)], child[2 * (p + k) + 1]);
+                init_state(st[k]);
+            }
+            sha256_mb_blocks(stp, msgp, two, n);
+            for (k = 0; k < n; ++k)
+                state_out(st[k], parent[p + k]);
+            p += n;
+        }
+
+        // The odd one out moves up as-is
+        if (t->level_len[l - 1] & 1)
+            memcopy_bytes(parent[npairs], child[t->level_len[l - 1] - 1], 32);
+    }
+}
+
+const u8 *sha256_merkle_root(const struct sha256_merkle *t) {
+    return t->node[t->level_off[t->nlevels - 1]];
+}
+
+int sha256_merkle_update(struct sha256_merkle *t, u64 index, const u8 leaf32[32]) {
+    u32 l;
+
+    if (index >= t->nleaves)
+        return -1;
+    memcopy_bytes(t->node[index], leaf32, 32);
+
+    for (l = 1; l < t->nlevels; ++l) {
+        u8 (*child)[32] = t->node + t->level_off[l - 1];
+        u8 *up = t->node[t->level_off[l] + index / 2];
+        u64 left = index & ~1ull;
+
+        if (left + 1 < t->level_len[l - 1])
+            node_hash(child[left], child[left + 1], up);
+        else
+            memcopy_bytes(up, child[left], 32);
+        index /= 2;
+    }
+    return 0;
+}
+
+int sha256_merkle_proof(const struct sha256_merkle *t, u64 index, u8 path[][32]) {
+    u32 l;
+    int n = 0;
+
+    if (index >= t->nleaves)
+        return -1;
+
+    for (l = 0; l + 1 < t->nlevels; ++l) {
+        u64 sib = index ^ 1;
+        if (sib < t->level_len[l])
+            memcopy_bytes(path[n++], t->node[t->level_off[l] + sib], 32);
+        index /= 2;
+    }
+    return n;
+}
+
+int sha256_merkle_verify(const u8 leaf32[32], u64 index, u64 nleaves,
+                         const u8 path[][32], u32 npath, const u8 root32[32]) {
+    u8 cur[32];
+    u64 len = nleaves;
+    u32 used = 0, i;
+    u8 diff = 0;
+
+    if (index >= nleaves)
+        return 0;
+    memcopy_bytes(cur, leaf32, 32);
+
+    // Walk the same shape the builder made: pair up, or move up alone
+    while (len > 1) {
+        if ((index ^ 1) < len) {
+            if (used == npath)
+                return 0;
+            if (index & 1) node_hash(path[used], cur, cur);
+            else           node_hash(cur, path[used], cur);
+            used++;
+        }
+        index /= 2;
+        len = (len + 1) / 2;
+    }
+    if (used != npath)
+        return 0;
+
+    for (i = 0; i < 32; ++i)
+        diff |= (u8)(cur[i] ^ root32[i]);
+    return diff == 0;
+}
@@ -0,0 +1,96 @@
+/* sha256_merkle.h
+ *
+ * Merkle trees over many leaves, with cheap single-leaf updates and
+ * inclusion proofs.
+ *
+ * Same hashing rules as sha256_tree.h:
+ *   leaf = SHA-256(0x00 || leaf data)       (sha256_merkle_leaf)
+ *   node = SHA-256(0x01 || left || right)
+ * and an odd node at the end of a level moves up unchanged, so a tree
+ * over fixed-size chunks of a file has the same root as
+ * sha256_tree_hash() with that leaf size.
+ *
+ * All nodes live in one flat array in level order: the n leaves
+ * first, then each level above, root last. Levels are built bottom-up
+ * one at a time through the multi-lane engine; updating one leaf
+ * rehashes only its path to the root.
+ *
+ * Typical usage:
+ *   struct sha256_merkle t;
+ *   u8 (*nodes)[32] = malloc(sha256_merkle_nodes(n) * 32);
+ *   sha256_merkle_init(&t, nodes, n);
+ *   for (i = 0; i < n; ++i) sha256_merkle_leaf(data[i], len[i], nodes[i]);
+ *   sha256_merkle_build(&t);
+ *   ...
+ *   sha256_merkle_update(&t, 42, new_leaf32);   // O(log n)
+ *
+ * Storage is supplied by the caller; like sha256.c this only needs
+ * the compiler, no libc.
+ */
+
+#ifndef SHA256_MERKLE_H
+#define SHA256_MERKLE_H
+
+#include "sha256.h"
+
+#define SHA256_MERKLE_MAX_LEVELS 65   // leaves + up to 64 levels above
+#define SHA256_MERKLE_MAX_PROOF  64   // siblings in a proof, at most
+
+struct sha256_merkle {
+    u8 (*node)[32];                        // all nodes, leaves first
+    u64 nleaves;
+    u32 nlevels;                           // 1 for a single leaf
+    u64 level_off[SHA256_MERKLE_MAX_LEVELS]; // first node of each level
+    u64 level_len[SHA256_MERKLE_MAX_LEVELS]; // nodes in each level
+};
+
+/* sha256_merkle_nodes()
+ * Number of 32-byte nodes a tree over nleaves leaves needs.
+ */
+u64 sha256_merkle_nodes(u64 nleaves);
+
+/* sha256_merkle_leaf()
+ * Leaf hash of one piece of data: SHA-256(0x00 || data).
+ */
+void sha256_merkle_leaf(const u8 *data, u64 len, u8 out_leaf32[32]);
+
+/* sha256_merkle_init()
+ * Lay out a tree over nodes (sha256_merkle_nodes(nleaves) entries).
+ * The caller then writes the leaf hashes to nodes[0..nleaves-1].
+ * Returns 0, or -1 if nleaves is 0.
+ */
+int sha256_merkle_init(struct sha256_merkle *t, u8 (*nodes)[32], u64 nleaves);
+
+/* sha256_merkle_build()
+ * Hash every level above the leaves.
+ */
+void sha256_merkle_build(struct sha256_merkle *t);
+
+/* sha256_merkle_root()
+ * The root node (valid after sha256_merkle_build()).
+ */
+const u8 *sha256_merkle_root(const struct sha256_merkle *t);
+
+/* sha256_merkle_update()
+ * Replace leaf index and rehash its path to the root.
+ * Returns 0, or -1 if index is out of range.
+ */
+int sha256_merkle_update(struct sha256_merkle *t, u64 index, const u8 leaf32[32]);
+
+/* sha256_merkle_proof()
+ * Write the sibling hashes for leaf index, bottom-up, to path (room
+ * for SHA256_MERKLE_MAX_PROOF). Levels where the node moves up
+ * unpaired contribute nothing. Returns the number written, or -1 if
+ * index is out of range.
+ */
+int sha256_merkle_proof(const struct sha256_merkle *t, u64 index, u8 path[][32]);
+
+/* sha256_merkle_verify()
+ * Check that leaf32 is leaf index of a tree with nleaves leaves and
+ * the given root, using a path from sha256_merkle_proof().
+ * Returns 1 if it is, 0 if not.
+ */
+int sha256_merkle_verify(const u8 leaf32[32], u64 index, u64 nleaves,
+                         const u8 path[][32], u32 npath, const u8 root32[32]);
+
+#endif
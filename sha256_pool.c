@@ -0,0 +1,179 @@
+/* sha256_pool.c
+ *
+ * Slab-backed context pool (see sha256_pool.h).
+ *
+ * Slots are named by index + 1, so 0 can mean "none" and a free list
+ * fits in 32 bits. A free batch is a chain of slots linked through
+ * next; the pool keeps a lock-free stack of batches linked through
+ * the first slot's batch_next. Its head carries a tag that changes on
+ * every push and pop, so a pop that raced with a pop and a push of the
+ * same batch fails its compare-and-swap instead of corrupting the
+ * stack (ABA). Slots that were never handed out are not on any list:
+ * carved counts how far into the slab batches have been cut, which is
+ * what makes sha256_pool_reset() O(1).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256_pool.h"
+
+struct pool_slot {
+    struct sha256_ctx ctx;     // first, so a ctx pointer is a slot pointer
+    u32 next;                  // next slot of the batch + 1
+    u32 batch_next;            // first slot only: next free batch + 1
+    u32 batch_len;             // first slot only: slots in the batch
+    u32 spare;
+} __attribute__((aligned(64)));
+
+_Static_assert(sizeof(struct pool_slot) == SHA256_POOL_SLOT, "slot size is part of the API");
+_Static_assert(SHA256_POOL_ALIGN == 64, "slots are aligned to 64 bytes");
+
+static struct pool_slot *slot_at(const struct sha256_pool *pool, u32 ref) {
+    return (struct pool_slot *)pool->slab + (ref - 1);
+}
+
+// Push a chain of n slots starting at ref onto the shared stack
+static void push_batch(struct sha256_pool *pool, u32 ref, u32 n) {
+    struct pool_slot *s = slot_at(pool, ref);
+    u64 head = __atomic_load_n(&pool->free_head, __ATOMIC_RELAXED);
+
+    s->batch_len = n;
+    do {
+        __atomic_store_n(&s->batch_next, (u32)head, __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&pool->free_head, &head, ((head >> 32) + 1) << 32 | ref,
+                                          1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+// Pop a batch from the shared stack; returns its first slot + 1, or 0
+static u32 pop_batch(struct sha256_pool *pool, u32 *n) {
+    u64 head = __atomic_load_n(&pool->free_head, __ATOMIC_ACQUIRE);
+    u32 ref, next;
+
+    do {
+        ref = (u32)head;
+        if (ref == 0)
+            return 0;
+        // May be stale if another thread won the slot; then the tag has moved and the CAS fails
+        next = __atomic_load_n(&slot_at(pool, ref)->batch_next, __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&pool->free_head, &head, ((head >> 32) + 1) << 32 | next,
+                                          1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    *n = slot_at(pool, ref)->batch_len;
+    return ref;
+}
+
+// Cut up to a batch of never-used slots off the slab, linked in order
+static u32 carve_batch(struct sha256_pool *pool, u32 *n) {
+    u32 start = __atomic_load_n(&pool->carved, __ATOMIC_RELAXED), i;
+
+    do {
+        if (start >= pool->nslots)
+            return 0;
+        *n = pool->nslots - start < SHA256_POOL_BATCH ? pool->nslots - start : SHA256_POOL_BATCH;
+    } while (!__atomic_compare_exchange_n(&pool->carved, &start, start + *n,
+                                          1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    for (i = 0; i < *n; ++i)
+        slot_at(pool, start + i + 1)->next = i + 1 < *n ? start + i + 2 : 0;
+    return start + 1;
+}
+
+// Drop slots of an earlier epoch: sha256_pool_reset() took them back
+static void cache_sync(struct sha256_pool_cache *cache) {
+    u32 epoch = __atomic_load_n(&cache->pool->epoch, __ATOMIC_ACQUIRE);
+
+    if (cache->epoch != epoch) {
+        cache->cur = cache->cur_count = cache->full = 0;
+        cache->epoch = epoch;
+    }
+}
+
+int sha256_pool_init(struct sha256_pool *pool, void *mem, u64 bytes) {
+    u64 n = bytes / SHA256_POOL_SLOT;
+
+    if (!mem || ((uintptr_t)mem & (SHA256_POOL_ALIGN - 1)) != 0 || n == 0)
+        return -1;
+    if (n > 0xfffffffeu)
+        n = 0xfffffffeu;   // refs are u32 with 0 meaning none
+
+    pool->slab = mem;
+    pool->nslots = (u32)n;
+    pool->epoch = 0;
+    pool->free_head = 0;
+    pool->carved = 0;
+    return 0;
+}
+
+void sha256_pool_reset(struct sha256_pool *pool) {
+    u64 head = __atomic_load_n(&pool->free_head, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&pool->free_head, ((head >> 32) + 1) << 32, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->carved, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->epoch, pool->epoch + 1, __ATOMIC_RELEASE);
+}
+
+void sha256_pool_cache_init(struct sha256_pool_cache *cache, struct sha256_pool *pool) {
+    cache->pool = pool;
+    cache->cur = cache->cur_count = cache->full = 0;
+    cache->epoch = __atomic_load_n(&pool->epoch, __ATOMIC_ACQUIRE);
+}
+
+struct sha256_ctx *sha256_pool_get(struct sha256_pool_cache *cache) {
+    struct sha256_pool *pool = cache->pool;
+    struct pool_slot *s;
+    u32 n = 0;
+
+    cache_sync(cache);
+    if (cache->cur == 0) {
+        if (cache->full) {
+            cache->cur = cache->full;
+            n = SHA256_POOL_BATCH;
+            cache->full = 0;
+        } else if (!(cache->cur = pop_batch(pool, &n)) && !(cache->cur = carve_batch(pool, &n))) {
+            return NULL;
+        }
+        cache->cur_count = n;
+    }
+
+    s = slot_at(pool, cache->cur);
+    cache->cur = s->next;
+    cache->cur_count--;
+    sha256_init(&s->ctx);
+    return &s->ctx;
+}
+
+u32 sha256_pool_get_many(struct sha256_pool_cache *cache, struct sha256_ctx *out[], u32 n) {
+    u32 i;
+
+    for (i = 0; i < n; ++i)
+        if (!(out[i] = sha256_pool_get(cache)))
+            break;
+    return i;
+}
+
+void sha256_pool_put(struct sha256_pool_cache *cache, struct sha256_ctx *ctx) {
+    struct pool_slot *s = (struct pool_slot *)ctx;
+    struct sha256_pool *pool = cache->pool;
+
+    cache_sync(cache);
+    // The current batch is full: it becomes the spare, the old spare goes back to the pool
+    if (cache->cur_count == SHA256_POOL_BATCH) {
+        if (cache->full)
+            push_batch(pool, cache->full, SHA256_POOL_BATCH);
+        cache->full = cache->cur;
+        cache->cur = 0;
+        cache->cur_count = 0;
+    }
+    s->next = cache->cur;
+    cache->cur = (u32)(s - (struct pool_slot *)pool->slab) + 1;
+    cache->cur_count++;
+}
+
+void sha256_pool_cache_flush(struct sha256_pool_cache *cache) {
+    cache_sync(cache);
+    if (cache->cur)
+        push_batch(cache->pool, cache->cur, cache->cur_count);
+    if (cache->full)
+        push_batch(cache->pool, cache->full, SHA256_POOL_BATCH);
+    cache->cur = cache->cur_count = cache->full = 0;
+}
@@ -0,0 +1,108 @@
+/* sha256_pool.h
+ *
+ * Context pool: many short-lived sha256_ctx out of one preallocated
+ * slab, for servers that hash one small message per request.
+ *
+ * Every context sits in its own SHA256_POOL_SLOT-byte slot aligned to
+ * a cache line, so contexts of different threads never share a line.
+ * Getting a context is sha256_init() on a free slot; nothing is
+ * allocated or cleared. The slab is caller memory, carved into slots
+ * lazily, and sha256_pool_reset() takes every slot back in O(1).
+ *
+ * Free slots live in per-thread caches (struct sha256_pool_cache), so
+ * get and put are a few plain loads and stores. Only when a cache
+ * runs empty or holds two full batches does it touch the shared pool,
+ * moving SHA256_POOL_BATCH slots at once with one compare-and-swap.
+ * A context may be put back through any cache of the same pool, so a
+ * context can be got on one thread and released on another.
+ *
+ * Typical usage:
+ *   static struct sha256_pool pool;
+ *   static __thread struct sha256_pool_cache cache;
+ *
+ *   sha256_pool_init(&pool, slab, n * SHA256_POOL_SLOT);   // once
+ *   sha256_pool_cache_init(&cache, &pool);                 // per thread
+ *
+ *   struct sha256_ctx *ctx = sha256_pool_get(&cache);      // per request
+ *   sha256_update(ctx, data, len);
+ *   sha256_final(ctx, out32);
+ *   sha256_pool_put(&cache, ctx);
+ *
+ *   sha256_pool_cache_flush(&cache);                       // thread exit
+ *
+ * Like sha256.c this only needs the compiler, no libc.
+ */
+
+#ifndef SHA256_POOL_H
+#define SHA256_POOL_H
+
+#include "sha256.h"
+
+#define SHA256_POOL_SLOT   128   // bytes per context: the ctx and the free-list links
+#define SHA256_POOL_ALIGN  64    // alignment the slab needs
+#define SHA256_POOL_BATCH  32    // slots moved between a cache and the pool at once
+
+struct sha256_pool {
+    u8 *slab;                  // nslots slots of SHA256_POOL_SLOT bytes
+    u32 nslots;
+    u32 epoch;                 // bumped by sha256_pool_reset()
+
+    // Written by every thread's cache, so on a line of their own
+    u64 free_head __attribute__((aligned(64))); // tag << 32 | first slot of a free batch + 1
+    u32 carved;                // slots taken out of the slab so far
+};
+
+// One thread's free slots: a batch being filled and emptied, and a full spare
+struct sha256_pool_cache {
+    struct sha256_pool *pool;
+    u32 cur;                   // first slot of the current batch + 1, 0 if empty
+    u32 cur_count;
+    u32 full;                  // a full batch (SHA256_POOL_BATCH slots) + 1, or 0
+    u32 epoch;                 // pool epoch the slots above belong to
+};
+
+/* sha256_pool_init()
+ * Lay out a pool over bytes of mem, which must be aligned to
+ * SHA256_POOL_ALIGN; it holds bytes / SHA256_POOL_SLOT contexts.
+ * Returns 0, or -1 if mem is misaligned or too small for one context.
+ */
+int sha256_pool_init(struct sha256_pool *pool, void *mem, u64 bytes);
+
+/* sha256_pool_reset()
+ * Make every slot free again, in O(1). No context of the pool may be
+ * in use, and no other thread may be using the pool; caches drop what
+ * they hold the next time they are used.
+ */
+void sha256_pool_reset(struct sha256_pool *pool);
+
+/* sha256_pool_cache_init()
+ * Start an empty cache on pool; one per thread, never shared.
+ */
+void sha256_pool_cache_init(struct sha256_pool_cache *cache, struct sha256_pool *pool);
+
+/* sha256_pool_get()
+ * A context ready for sha256_update() (as after sha256_init()), or
+ * NULL if every slot is in use.
+ */
+struct sha256_ctx *sha256_pool_get(struct sha256_pool_cache *cache);
+
+/* sha256_pool_get_many()
+ * Up to n contexts into out[]; returns how many (fewer only when the
+ * pool runs out).
+ */
+u32 sha256_pool_get_many(struct sha256_pool_cache *cache, struct sha256_ctx *out[], u32 n);
+
+/* sha256_pool_put()
+ * Give back a context from sha256_pool_get() on any cache of the
+ * same pool. It must not be used afterwards.
+ */
+void sha256_pool_put(struct sha256_pool_cache *cache, struct sha256_ctx *ctx);
+
+/* sha256_pool_cache_flush()
+ * Return every slot the cache holds to the pool. Call it before the
+ * thread exits or the cache is dropped; slots left in a cache are
+ * not available to other threads until sha256_pool_reset().
+ */
+void sha256_pool_cache_flush(struct sha256_pool_cache *cache);
+
+#endif
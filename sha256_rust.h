@@ -0,0 +1,103 @@
+/* sha256_rust.h
+ *
+ * C declarations for the Rust SHA-256 library (src/lib.rs,
+ * built as target/release/libsha256_rust.a).
+ *
+ * Typical usage:
+ *   RustSha256Ctx ctx;
+ *   rust_sha256_init(&ctx);
+ *   rust_sha256_update(&ctx, data_ptr, data_len);
+ *   rust_sha256_final(&ctx, out32);
+ */
+
+#ifndef SHA256_RUST_H
+#define SHA256_RUST_H
+
+#include "sha256.h"
+
+/*
+ * Rust context (#[repr(C)] Sha256Ctx).
+ * Must match the memory layout of the Rust struct field for field.
+ */
+typedef struct {
+    u32 h[8];
+    u8  buffer[64];
+    u32 buflen;
+    u64 bitlen;
+} RustSha256Ctx;
+
+/*
+ * Rust HMAC-SHA256 key and context (#[repr(C)] HmacSha256Key /
+ * HmacSha256Ctx); same fields as struct hmac_sha256_key / _ctx.
+ */
+typedef struct {
+    u32 inner_h[8];
+    u32 outer_h[8];
+} RustHmacSha256Key;
+
+typedef struct {
+    RustSha256Ctx inner;
+    u32 outer_h[8];
+} RustHmacSha256Ctx;
+
+extern void rust_sha256_init(RustSha256Ctx *ctx);
+extern void rust_sha256_update(RustSha256Ctx *ctx, const u8 *data, u32 len);
+extern void rust_sha256_update64(RustSha256Ctx *ctx, const u8 *data, u64 len);
+extern void rust_sha256_final(RustSha256Ctx *ctx, u8 out_hash32[32]);
+extern void rust_sha256_to_hex(const u8 hash32[32], char hex_out[65]);
+extern u64  rust_sha256_to_hex_batch(const u8 *digests, u64 n, char sep, char *out);
+extern int  rust_sha256_from_hex(const char *hex, u8 out32[32]);
+
+/* HMAC-SHA256, mirroring hmac_sha256_*() in sha256.h */
+extern void rust_hmac_sha256_key_init(RustHmacSha256Key *key, const u8 *k, u64 klen);
+extern void rust_hmac_sha256_init(RustHmacSha256Ctx *ctx, const RustHmacSha256Key *key);
+extern void rust_hmac_sha256_update(RustHmacSha256Ctx *ctx, const u8 *data, u64 len);
+extern void rust_hmac_sha256_final(RustHmacSha256Ctx *ctx, u8 out_mac32[32]);
+extern void rust_hmac_sha256(const RustHmacSha256Key *key, const u8 *msg, u64 len, u8 out_mac32[32]);
+
+/* Midstate export / import. Same SHA256_STATE_BYTES layout as
+ * sha256_export() / sha256_import(), so a state saved by either core
+ * can be resumed by the other. Import returns 0, or -1 if invalid. */
+extern void rust_sha256_export(const RustSha256Ctx *ctx, u8 out[SHA256_STATE_BYTES]);
+extern int  rust_sha256_import(RustSha256Ctx *ctx, const u8 in[SHA256_STATE_BYTES]);
+
+/* SHA-224 and truncated digests, mirroring sha256_init_iv() and
+ * friends in sha256.h; outlen is clamped to 32. */
+extern void rust_sha256_init_iv(RustSha256Ctx *ctx, const u32 iv[8]);
+extern void rust_sha224_init(RustSha256Ctx *ctx);
+extern void rust_sha256_final_len(RustSha256Ctx *ctx, u8 *out, u32 outlen);
+extern void rust_sha224_final(RustSha256Ctx *ctx, u8 out_hash28[28]);
+
+/* Context pool of the Rust core (src/pool.rs), the same design as
+ * sha256_pool.h: 128-byte slots aligned to 64 bytes in caller memory,
+ * one cache per thread. The structs mirror #[repr(C)] Sha256Pool and
+ * PoolCache; only the functions below touch their fields. */
+typedef struct {
+    u8 *slab;
+    u32 nslots;
+    u32 epoch;
+    u64 free_head __attribute__((aligned(64)));
+    u32 carved;
+} RustSha256Pool;
+
+typedef struct {
+    RustSha256Pool *pool;
+    u32 cur, cur_count, full, epoch;
+} RustSha256PoolCache;
+
+extern int  rust_sha256_pool_init(RustSha256Pool *pool, void *mem, u64 bytes);
+extern void rust_sha256_pool_reset(RustSha256Pool *pool);
+extern void rust_sha256_pool_cache_init(RustSha256PoolCache *cache, RustSha256Pool *pool);
+extern RustSha256Ctx *rust_sha256_pool_get(RustSha256PoolCache *cache);
+extern u32  rust_sha256_pool_get_many(RustSha256PoolCache *cache, RustSha256Ctx *out[], u32 n);
+extern void rust_sha256_pool_put(RustSha256PoolCache *cache, RustSha256Ctx *ctx);
+extern void rust_sha256_pool_cache_flush(RustSha256PoolCache *cache);
+
+/* Compression backend of the Rust core, chosen on first use like the
+ * C core's. Takes enum sha256_backend values; returns 0, or -1 if
+ * that backend is not built in or the CPU lacks it. The name is
+ * "scalar", "sha-ni" or "armv8-sha2". */
+extern int  rust_sha256_use_backend(int backend);
+extern const char *rust_sha256_backend_name(void);
+
+#endif
@@ -0,0 +1,511 @@
+/* sha256_sched.c
+ *
+ * Work-stealing pool and parallel file hashing (see sha256_sched.h).
+ *
+ * The deque follows Chase and Lev ("Dynamic circular work-stealing
+ * deque", SPAA 2005) with the C11 orderings of Le et al. ("Correct and
+ * efficient work-stealing for weak memory models", PPoPP 2013). It
+ * never grows: ranges are only ever halved, so a deque holds at most
+ * one range per halving, about log2(n / grain) of them, and 64 slots
+ * cover any 32-bit n. A range is packed as begin << 32 | end into one
+ * u64, so slots are read and written atomically.
+ *
+ * Termination uses one shared count of items not yet run; a worker
+ * that finds nothing to steal yields and tries again until it is 0.
+ * After SCHED_SPIN_ROUNDS failed tries in a row it sweeps every deque
+ * once more and then sleeps on a condition variable, so one long item
+ * (a huge file) does not keep the other cores spinning. Pushes and the
+ * count reaching 0 bump an event counter and wake sleepers; a worker
+ * only goes to sleep if the counter has not moved since before its
+ * sweep, so no push is missed.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sha256_sched.h"
+#include "sha256_file.h"
+#include "sha256_mb.h"
+#include "sha256_rust.h"
+
+#define SCHED_DEQUE_SLOTS 64
+#define SCHED_EMPTY       0ull    // an empty range, never pushed
+#define SCHED_SPIN_ROUNDS 64      // failed steals before a worker sleeps
+
+// One worker's deque; top and bottom on separate cache lines
+struct sched_deque {
+    int64_t top __attribute__((aligned(64)));       // thieves take here
+    int64_t bottom __attribute__((aligned(64)));    // owner pushes and pops here
+    u64 slot[SCHED_DEQUE_SLOTS];
+};
+
+struct sched_pool {
+    struct sched_deque *deques;
+    struct sha256_sched_worker *workers;
+    u32 threads;
+    u32 grain;
+    sha256_sched_fn fn;
+    void *arg;
+    const int *stop;
+    u64 remaining;             // items not yet run (atomic)
+    u64 events;                // pushes and the end of the run (atomic)
+    u32 sleepers;              // workers in pool_sleep() (atomic)
+    pthread_mutex_t lock;      // guards the sleep / wake hand-off
+    pthread_cond_t wake;
+};
+
+static u64 range_pack(u64 begin, u64 end) { return begin << 32 | end; }
+static u64 range_begin(u64 r)             { return r >> 32; }
+static u64 range_end(u64 r)               { return r & 0xFFFFFFFFull; }
+
+/*
+ * Chase-Lev deque
+ */
+
+// Owner only. Returns 0, or -1 if the deque is full
+static int deque_push(struct sched_deque *d, u64 r) {
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+
+    if (b - t >= SCHED_DEQUE_SLOTS)
+        return -1;
+    __atomic_store_n(&d->slot[b & (SCHED_DEQUE_SLOTS - 1)], r, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Owner only: newest range, or SCHED_EMPTY
+static u64 deque_take(struct sched_deque *d) {
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    int64_t t;
+    u64 r = SCHED_EMPTY;
+
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+    if (t <= b) {
+        r = __atomic_load_n(&d->slot[b & (SCHED_DEQUE_SLOTS - 1)], __ATOMIC_RELAXED);
+        if (t == b) {
+            // Last range: race the thieves for it
+            if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0,
+                                             __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+                r = SCHED_EMPTY;
+            __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return r;
+}
+
+// Any thread: oldest (largest) range, or SCHED_EMPTY if none or lost a race
+static u64 deque_steal(struct sched_deque *d) {
+    int64_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    int64_t b;
+    u64 r;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b)
+        return SCHED_EMPTY;
+    r = __atomic_load_n(&d->slot[t & (SCHED_DEQUE_SLOTS - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return SCHED_EMPTY;
+    return r;
+}
+
+/*
+ * Pool
+ */
+
+static int pool_stopped(const struct sched_pool *p) {
+    return p->stop && __atomic_load_n(p->stop, __ATOMIC_RELAXED);
+}
+
+// New work or the run is over: count the event, wake sleepers if any
+static void pool_wake(struct sched_pool *p, int all) {
+    __atomic_add_fetch(&p->events, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&p->sleepers, __ATOMIC_SEQ_CST) == 0)
+        return;
+    pthread_mutex_lock(&p->lock);
+    if (all) pthread_cond_broadcast(&p->wake);
+    else     pthread_cond_signal(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// Wait until there has been an event since seen, or the run is over
+static void pool_sleep(struct sched_pool *p, u64 seen) {
+    pthread_mutex_lock(&p->lock);
+    __atomic_add_fetch(&p->sleepers, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&p->events, __ATOMIC_SEQ_CST) == seen &&
+           __atomic_load_n(&p->remaining, __ATOMIC_ACQUIRE) != 0 && !pool_stopped(p))
+        pthread_cond_wait(&p->wake, &p->lock);
+    __atomic_sub_fetch(&p->sleepers, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&p->lock);
+}
+
+/* Halve r down to grain, pushing the upper halves, then run what is
+ * left. A full deque just means running a larger range. */
+static void run_range(struct sched_pool *p, u32 id, u64 r) {
+    struct sched_deque *d = &p->deques[id];
+    u64 begin = range_begin(r), end = range_end(r);
+
+    while (end - begin > p->grain) {
+        u64 mid = begin + (end - begin) / 2;
+        if (deque_push(d, range_pack(mid, end)) != 0)
+            break;
+        pool_wake(p, 0);
+        end = mid;
+    }
+    if (!pool_stopped(p))
+        p->fn(&p->workers[id], begin, end, p->arg);
+    if (__atomic_sub_fetch(&p->remaining, end - begin, __ATOMIC_RELEASE) == 0)
+        pool_wake(p, 1);
+}
+
+// Every other worker's deque once, in order: SCHED_EMPTY if all are empty
+static u64 steal_any(struct sched_pool *p, u32 id) {
+    u64 r = SCHED_EMPTY;
+    u32 v;
+
+    for (v = 1; v < p->threads && r == SCHED_EMPTY; ++v)
+        r = deque_steal(&p->deques[(id + v) % p->threads]);
+    return r;
+}
+
+static void worker_loop(struct sched_pool *p, u32 id) {
+    u32 seed = id * 2654435761u + 1;   // victim choice, per worker
+    u32 idle = 0;                      // failed rounds in a row
+
+    while (!pool_stopped(p)) {
+        u64 r = deque_take(&p->deques[id]);
+
+        if (r == SCHED_EMPTY && p->threads > 1) {
+            u32 victim;
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            victim = seed % (p->threads - 1);
+            r = deque_steal(&p->deques[victim >= id ? victim + 1 : victim]);
+        }
+        if (r == SCHED_EMPTY && ++idle >= SCHED_SPIN_ROUNDS) {
+            u64 seen = __atomic_load_n(&p->events, __ATOMIC_SEQ_CST);
+
+            idle = 0;
+            r = steal_any(p, id);
+            if (r == SCHED_EMPTY && __atomic_load_n(&p->remaining, __ATOMIC_ACQUIRE) != 0) {
+                pool_sleep(p, seen);
+                continue;
+            }
+        }
+        if (r != SCHED_EMPTY) {
+            idle = 0;
+            run_range(p, id, r);
+        } else if (__atomic_load_n(&p->remaining, __ATOMIC_ACQUIRE) == 0) {
+            break;
+        } else {
+            sched_yield();
+        }
+    }
+    // Stopped: the count never reaches 0, so get the sleepers out here
+    if (pool_stopped(p))
+        pool_wake(p, 1);
+}
+
+struct worker_start {
+    struct sched_pool *pool;
+    u32 id;
+};
+
+static void *worker_main(void *arg) {
+    struct worker_start *s = arg;
+    worker_loop(s->pool, s->id);
+    return NULL;
+}
+
+int sha256_sched_run(u64 n, sha256_sched_fn fn, void *arg, const struct sha256_sched_opts *opts) {
+    struct sched_pool p;
+    pthread_t tids[SHA256_SCHED_MAX_THREADS];
+    struct worker_start starts[SHA256_SCHED_MAX_THREADS];
+    u32 t, started = 0;
+    int rc = 0;
+
+    if (n > SHA256_SCHED_MAX_ITEMS) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (n == 0)
+        return 0;
+
+    memset(&p, 0, sizeof(p));
+    p.fn = fn;
+    p.arg = arg;
+    p.grain = SHA256_SCHED_DEFAULT_GRAIN;
+    if (opts) {
+        if (opts->grain) p.grain = opts->grain;
+        p.threads = opts->threads;
+        p.stop = opts->stop;
+    }
+    if (p.threads == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        p.threads = ncpu > 0 ? (u32)ncpu : 1;
+    }
+    if (p.threads > SHA256_SCHED_MAX_THREADS) p.threads = SHA256_SCHED_MAX_THREADS;
+    if (p.threads > (n + p.grain - 1) / p.grain) p.threads = (u32)((n + p.grain - 1) / p.grain);
+    p.remaining = n;
+
+    if (posix_memalign((void **)&p.deques, 64, p.threads * sizeof(*p.deques)) != 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.wake, NULL);
+    memset(p.deques, 0, p.threads * sizeof(*p.deques));
+    p.workers = calloc(p.threads, sizeof(*p.workers));
+    for (t = 0; p.workers && t < p.threads; ++t) {
+        p.workers[t].id = t;
+        sha256_init(&p.workers[t].ctx);
+        if (posix_memalign((void **)&p.workers[t].buf, 4096, SHA256_SCHED_BUF_SIZE) != 0) {
+            p.workers[t].buf = NULL;
+            rc = -1;
+        }
+    }
+    if (!p.workers || rc != 0) {
+        rc = -1;
+        goto out;
+    }
+
+    // Everything starts on worker 0, the calling thread; the rest steal
+    deque_push(&p.deques[0], range_pack(0, n));
+    for (t = 1; t < p.threads; ++t) {
+        starts[t].pool = &p;
+        starts[t].id = t;
+        if (pthread_create(&tids[t], NULL, worker_main, &starts[t]) != 0)
+            break;
+        started++;
+    }
+    // A thread that did not start just leaves an empty deque to rob
+    worker_loop(&p, 0);
+    for (t = 1; t <= started; ++t)
+        pthread_join(tids[t], NULL);
+
+out:
+    for (t = 0; p.workers && t < p.threads; ++t)
+        free(p.workers[t].buf);
+    free(p.workers);
+    free(p.deques);
+    pthread_cond_destroy(&p.wake);
+    pthread_mutex_destroy(&p.lock);
+    if (rc != 0)
+        errno = ENOMEM;
+    return rc;
+}
+
+/*
+ * Files
+ */
+
+/* Per-worker state of sha256_sched_files(), allocated on first use.
+ * Small files wait in slots until all lanes are full; the last partial
+ * batch of each worker is hashed after the pool is done. */
+struct file_worker {
+    u8 *slots;                           // lanes slots of small_max + 1 bytes
+    u32 pending;                         // files waiting in slots
+    u64 index[SHA256_MB_MAX_LANES];      // their positions in files[]
+    u32 len[SHA256_MB_MAX_LANES];
+    struct sha256_ctx_mb mb;
+    RustSha256Ctx rust;
+};
+
+struct file_job {
+    struct sha256_sched_file *files;
+    struct sha256_file_opts file_opts;
+    enum sha256_engine engine;
+    u32 small_max;
+    u64 large_min;
+    u32 lanes;                           // 1: no multi-lane batching
+    struct file_worker *fw[SHA256_SCHED_MAX_THREADS];
+};
+
+// Read up to n bytes at off; returns bytes read, or -1
+static ssize_t read_at(int fd, u8 *buf, u64 n, u64 off) {
+    u64 got = 0;
+
+    while (got < n) {
+        ssize_t r = pread(fd, buf + got, (size_t)(n - got), (off_t)(off + got));
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (r == 0)
+            break;
+        got += (u64)r;
+    }
+    return (ssize_t)got;
+}
+
+// Hash the lanes waiting in fw->slots in one multi-buffer pass
+static void flush_lanes(struct file_job *job, struct file_worker *fw) {
+    const u8 *data[SHA256_MB_MAX_LANES];
+    u8 digest[SHA256_MB_MAX_LANES][32];
+    u32 i;
+
+    if (fw->pending == 0)
+        return;
+    for (i = 0; i < fw->pending; ++i)
+        data[i] = fw->slots + (u64)i * (job->small_max + 1);
+
+    sha256_mb_init(&fw->mb, fw->pending);
+    sha256_mb_update(&fw->mb, data, fw->len);
+    sha256_mb_final(&fw->mb, digest);
+
+    for (i = 0; i < fw->pending; ++i) {
+        memcpy(job->files[fw->index[i]].digest, digest[i], 32);
+        job->files[fw->index[i]].bytes = fw->len[i];
+    }
+    fw->pending = 0;
+}
+
+/* Medium file: pread() through the worker's buffer into its reusable
+ * context. Returns 0, or -1 with errno set. */
+static int hash_medium(struct file_job *job, struct sha256_sched_worker *w, struct file_worker *fw,
+                       int fd, struct sha256_sched_file *f) {
+    u64 off = 0;
+
+    if (job->engine == SHA256_ENGINE_RUST) rust_sha256_init(&fw->rust);
+    else                                   sha256_init(&w->ctx);
+
+    for (;;) {
+        ssize_t r = read_at(fd, w->buf, SHA256_SCHED_BUF_SIZE, off);
+        if (r < 0)
+            return -1;
+        if (r == 0)
+            break;
+        if (job->engine == SHA256_ENGINE_RUST) rust_sha256_update64(&fw->rust, w->buf, (u64)r);
+        else                                   sha256_update64(&w->ctx, w->buf, (u64)r);
+        off += (u64)r;
+        if ((u64)r < SHA256_SCHED_BUF_SIZE)
+            break;
+    }
+
+    if (job->engine == SHA256_ENGINE_RUST) rust_sha256_final(&fw->rust, f->digest);
+    else                                   sha256_final(&w->ctx, f->digest);
+    f->bytes = off;
+    return 0;
+}
+
+static void hash_one(struct file_job *job, struct sha256_sched_worker *w, struct file_worker *fw, u64 i) {
+    struct sha256_sched_file *f = &job->files[i];
+    struct stat st;
+    int fd, rc;
+
+    memset(f->digest, 0, 32);
+    f->bytes = 0;
+    f->error = 0;
+
+    fd = open(f->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        f->error = errno;
+        if (fd >= 0) close(fd);
+        return;
+    }
+
+    if (!S_ISREG(st.st_mode) || (u64)st.st_size >= job->large_min) {
+        rc = sha256_file_fd(fd, &job->file_opts, f->digest, &f->bytes);
+    } else if (job->lanes > 1 && st.st_size > 0 && (u64)st.st_size <= job->small_max) {
+        /* st_size is only a hint: read to end of file, with one byte of
+         * room to notice a file that grew past a slot since fstat() */
+        u8 *slot = fw->slots + (u64)fw->pending * (job->small_max + 1);
+        ssize_t r = read_at(fd, slot, (u64)job->small_max + 1, 0);
+        rc = r < 0 ? -1 : 0;
+        if (rc == 0 && (u64)r > job->small_max) {
+            rc = hash_medium(job, w, fw, fd, f);
+        } else if (rc == 0) {
+            fw->index[fw->pending] = i;
+            fw->len[fw->pending] = (u32)r;
+            if (++fw->pending == job->lanes)
+                flush_lanes(job, fw);
+        }
+    } else {
+        // Also regular files that report size 0 (procfs, sysfs): read to EOF
+        rc = hash_medium(job, w, fw, fd, f);
+    }
+    if (rc != 0)
+        f->error = errno ? errno : EIO;
+    close(fd);
+}
+
+static void files_range(struct sha256_sched_worker *w, u64 begin, u64 end, void *arg) {
+    struct file_job *job = arg;
+    struct file_worker *fw = job->fw[w->id];
+    u64 i;
+
+    if (!fw) {
+        fw = calloc(1, sizeof(*fw));
+        if (fw && job->lanes > 1 && !(fw->slots = malloc((size_t)job->lanes * (job->small_max + 1)))) {
+            free(fw);
+            fw = NULL;
+        }
+        if (!fw) {
+            for (i = begin; i < end; ++i)
+                job->files[i].error = ENOMEM;
+            return;
+        }
+        job->fw[w->id] = fw;
+    }
+
+    for (i = begin; i < end; ++i)
+        hash_one(job, w, fw, i);
+}
+
+int sha256_sched_files(struct sha256_sched_file *files, u64 n, const struct sha256_sched_file_opts *opts) {
+    struct file_job *job = calloc(1, sizeof(*job));
+    struct sha256_sched_opts sched = { 0 };
+    u32 t;
+    int rc;
+
+    if (!job) {
+        errno = ENOMEM;
+        return -1;
+    }
+    job->files = files;
+    job->small_max = SHA256_SCHED_DEFAULT_SMALL_MAX;
+    job->large_min = SHA256_SCHED_DEFAULT_LARGE_MIN;
+    if (opts) {
+        sched = opts->sched;
+        job->engine = opts->engine;
+        job->file_opts.engine = opts->engine;
+        job->file_opts.flags = opts->flags;
+        job->file_opts.queue_depth = opts->queue_depth;
+        if (opts->small_max) job->small_max = opts->small_max;
+        if (opts->large_min) job->large_min = opts->large_min;
+    }
+    if (job->small_max > (64u << 10)) job->small_max = 64u << 10;
+
+    job->lanes = job->engine == SHA256_ENGINE_C ? sha256_mb_lanes() : 1;
+    if (job->lanes > SHA256_MB_MAX_LANES) job->lanes = SHA256_MB_MAX_LANES;
+    // Files are costly items; lane slots fill across ranges instead
+    if (sched.grain == 0) sched.grain = 1;
+
+    rc = sha256_sched_run(n, files_range, job, &sched);
+
+    // Workers are joined: hash what is left in their lane slots
+    for (t = 0; t < SHA256_SCHED_MAX_THREADS; ++t) {
+        if (job->fw[t]) {
+            flush_lanes(job, job->fw[t]);
+            free(job->fw[t]->slots);
+            free(job->fw[t]);
+        }
+    }
+    free(job);
+    return rc;
+}
@@ -0,0 +1,114 @@
+/* sha256_sched.h
+ *
+ * Work-stealing scheduler for hashing many independent inputs, and a
+ * file hasher built on it.
+ *
+ * sha256_sched_run() splits the index range [0, n) over a pool of
+ * workers. Each worker owns a Chase-Lev deque: it halves its current
+ * range, pushes one half onto the bottom of its own deque and keeps
+ * the other, until a range is at most grain items long, which it
+ * then runs. Idle workers steal from the top of other workers'
+ * deques, where the largest ranges are, so one steal takes a big
+ * share of the remaining work. There are no locks: owner and thieves
+ * only contend, with one compare-and-swap, for the last range left in
+ * a deque.
+ *
+ * Each worker also owns a reusable struct sha256_ctx and I/O buffer
+ * (struct sha256_sched_worker), so the per-item code never allocates.
+ *
+ * sha256_sched_files() uses this for long file lists, where one
+ * thread doing open, read, hash and close in turn would be limited by
+ * syscall latency. Files are routed by size:
+ *   small  (<= small_max)  read whole into a lane slot and hashed
+ *                          sha256_mb_lanes() at a time by the
+ *                          multi-buffer engine (C core only)
+ *   medium                 pread() into the worker's buffer, one
+ *                          context per worker; also regular files
+ *                          that report size 0 (procfs, sysfs) and
+ *                          small files that grew past a slot
+ *   large  (>= large_min)  sha256_file_fd(): mmap window by window
+ *   not regular            sha256_file_fd(): buffered reads
+ * Digests are the same as sha256_file_fd() on each file.
+ *
+ * Typical usage:
+ *   struct sha256_sched_file files[n];        // .path filled in
+ *   struct sha256_sched_file_opts opts = { 0 };
+ *   sha256_sched_files(files, n, &opts);      // .digest / .error out
+ *
+ * Like sha256_tree.c this needs a hosted POSIX system.
+ */
+
+#ifndef SHA256_SCHED_H
+#define SHA256_SCHED_H
+
+#include "sha256.h"
+#include "sha256_tree.h"   // enum sha256_engine
+
+#define SHA256_SCHED_MAX_THREADS 256
+#define SHA256_SCHED_MAX_ITEMS   0xFFFFFFFFull   // per sha256_sched_run() call
+#define SHA256_SCHED_BUF_SIZE    (1u << 20)      // I/O buffer per worker
+
+// Defaults for zero fields
+#define SHA256_SCHED_DEFAULT_GRAIN      16               // items per leaf range
+#define SHA256_SCHED_DEFAULT_SMALL_MAX  (64u << 10)      // multi-lane files
+#define SHA256_SCHED_DEFAULT_LARGE_MIN  (16ull << 20)    // mmap files
+
+// State a worker keeps across all the ranges it runs
+struct sha256_sched_worker {
+    u32 id;                    // 0 .. threads - 1; 0 is the calling thread
+    struct sha256_ctx ctx;     // free for the callback to use
+    u8 *buf;                   // SHA256_SCHED_BUF_SIZE bytes, page aligned
+};
+
+/* Callback: handle items [begin, end). Called concurrently from every
+ * worker, each call on a range no other call sees. */
+typedef void (*sha256_sched_fn)(struct sha256_sched_worker *w, u64 begin, u64 end, void *arg);
+
+/*
+ * Scheduler options. Zero fields mean "default":
+ * threads = online CPUs, grain SHA256_SCHED_DEFAULT_GRAIN, no stop flag.
+ */
+struct sha256_sched_opts {
+    u32 threads;               // workers, including the calling thread
+    u32 grain;                 // largest range handed to the callback
+    const int *stop;           // if not NULL: nonzero abandons the run
+};
+
+/* sha256_sched_run()
+ * Run fn over [0, n) on the pool and return when every item is done,
+ * or as soon as the running ranges finish once *stop is set.
+ * n is at most SHA256_SCHED_MAX_ITEMS.
+ * Returns 0, or -1 if n is too large or memory ran out (errno is set).
+ */
+int sha256_sched_run(u64 n, sha256_sched_fn fn, void *arg, const struct sha256_sched_opts *opts);
+
+// One file for sha256_sched_files()
+struct sha256_sched_file {
+    const char *path;          // in: opened as is, so "-" is a file named -
+    u8 digest[32];             // out: SHA-256 of the whole file
+    u64 bytes;                 // out: bytes hashed
+    int error;                 // out: 0, or errno if the file could not be read
+};
+
+/*
+ * File hashing options. Zero fields mean "default": C core, mmap
+ * allowed, SHA256_SCHED_DEFAULT_SMALL_MAX / _LARGE_MIN size classes,
+ * and a grain of 1 file.
+ */
+struct sha256_sched_file_opts {
+    struct sha256_sched_opts sched;
+    enum sha256_engine engine; // which core hashes the data
+    u32 flags;                 // SHA256_FILE_* flags (sha256_file.h)
+    u32 queue_depth;           // SHA256_FILE_URING reads in flight
+    u32 small_max;             // largest multi-lane file, at most 64 KiB
+    u64 large_min;             // smallest mmap() file
+};
+
+/* sha256_sched_files()
+ * Hash n files in parallel, filling in digest, bytes and error of
+ * each. Returns 0 once every file has been attempted (check .error),
+ * or -1 if the pool could not run (errno is set).
+ */
+int sha256_sched_files(struct sha256_sched_file *files, u64 n, const struct sha256_sched_file_opts *opts);
+
+#endif
@@ -0,0 +1,106 @@
+/* sha256_shani.c
+ *
+ * SHA-256 compression using the x86 SHA extensions
+ * (SHA256RNDS2 / SHA256MSG1 / SHA256MSG2).
+ *
+ * The functions carry their own target attribute, so the rest of the
+ * program is still built for the baseline ISA and runs on CPUs without
+ * SHA-NI. sha256.c only calls in here after sha256_cpu_has_shani().
+ */
+
+#include "sha256_internal.h"
+
+#ifdef SHA256_HAVE_SHANI
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+// CPUID: leaf 1 ECX bit 9 = SSSE3, bit 19 = SSE4.1; leaf 7 EBX bit 29 = SHA
+int sha256_cpu_has_shani(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    if (!(ecx & (1u << 9)) || !(ecx & (1u << 19)))
+        return 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return 0;
+    return (ebx & (1u << 29)) != 0;
+}
+
+/* Four rounds: add the round constants to the message words, then
+ * SHA256RNDS2 twice (it does two rounds on the low 64 bits). */
+#define RND4(m, i) do {                                                   \
+    msg = _mm_add_epi32(m, _mm_loadu_si128((const __m128i *)&sha256_K[i])); \
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);                  \
+    msg = _mm_shuffle_epi32(msg, 0x0E);                                   \
+    state0 = _mm_sha256rnds2_epu32(state0, state1, msg);                  \
+} while (0)
+
+// First half of the schedule: W[t-16] + SSIG0(W[t-15])
+#define SCHED1(prev, cur) prev = _mm_sha256msg1_epu32(prev, cur)
+
+// Second half: add W[t-7] and SSIG1(W[t-2]) to finish the next 4 words
+#define SCHED2(next, cur, prev) \
+    next = _mm_sha256msg2_epu32(_mm_add_epi32(next, _mm_alignr_epi8(cur, prev, 4)), cur)
+
+__attribute__((target("sha,sse4.1,ssse3")))
+void sha256_compress_shani(u32 h[8], const u8 *data, u64 nblocks) {
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, abef, cdgh, tmp, msg;
+    __m128i m0, m1, m2, m3;
+
+    // The instructions want the state as ABEF / CDGH, not ABCD / EFGH
+    tmp    = _mm_loadu_si128((const __m128i *)&h[0]);          // DCBA
+    state1 = _mm_loadu_si128((const __m128i *)&h[4]);          // HGFE
+    tmp    = _mm_shuffle_epi32(tmp, 0xB1);                     // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);                  // EFGH
+    state0 = _mm_alignr_epi8(tmp, state1, 8);                  // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);               // CDGH
+
+    while (nblocks--) {
+        abef = state0;
+        cdgh = state1;
+
+        // Load the block as 16 big-endian words
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 0)), bswap);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), bswap);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), bswap);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), bswap);
+
+        // 64 rounds, four at a time, extending the schedule as we go
+        RND4(m0,  0);
+        RND4(m1,  4); SCHED1(m0, m1);
+        RND4(m2,  8); SCHED1(m1, m2);
+        RND4(m3, 12); SCHED2(m0, m3, m2); SCHED1(m2, m3);
+        RND4(m0, 16); SCHED2(m1, m0, m3); SCHED1(m3, m0);
+        RND4(m1, 20); SCHED2(m2, m1, m0); SCHED1(m0, m1);
+        RND4(m2, 24); SCHED2(m3, m2, m1); SCHED1(m1, m2);
+        RND4(m3, 28); SCHED2(m0, m3, m2); SCHED1(m2, m3);
+        RND4(m0, 32); SCHED2(m1, m0, m3); SCHED1(m3, m0);
+        RND4(m1, 36); SCHED2(m2, m1, m0); SCHED1(m0, m1);
+        RND4(m2, 40); SCHED2(m3, m2, m1); SCHED1(m1, m2);
+        RND4(m3, 44); SCHED2(m0, m3, m2); SCHED1(m2, m3);
+        RND4(m0, 48); SCHED2(m1, m0, m3); SCHED1(m3, m0);
+        RND4(m1, 52); SCHED2(m2, m1, m0);
+        RND4(m2, 56); SCHED2(m3, m2, m1);
+        RND4(m3, 60);
+
+        // Add this block's result to the running state
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+
+        data += 64;
+    }
+
+    // Back to ABCD / EFGH
+    tmp    = _mm_shuffle_epi32(state0, 0x1B);                  // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);                  // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);               // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);                  // HGFE
+
+    _mm_storeu_si128((__m128i *)&h[0], state0);
+    _mm_storeu_si128((__m128i *)&h[4], state1);
+}
+
+#endif
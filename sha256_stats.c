@@ -0,0 +1,137 @@
+/* sha256_stats.c
+ *
+ * Per-thread counter blocks and their totals (see sha256_stats.h).
+ *
+ * A thread gets its block on its first counted call: a released block
+ * of a thread that has exited if there is one, else a new one pushed
+ * onto the list with a compare-and-swap. A pthread key destructor
+ * releases the block when the thread exits. Blocks are never freed,
+ * so the list only grows to the largest number of threads that were
+ * hashing at the same time.
+ */
+
+#include <stdio.h>
+
+#include "sha256_stats.h"
+
+#ifdef SHA256_STATS
+
+#include <pthread.h>
+#include <stdlib.h>
+
+struct stats_block {
+    struct sha256_stats engine[SHA256_STATS_ENGINES];
+    struct stats_block *next;
+    int in_use;
+} __attribute__((aligned(64)));
+
+__thread struct sha256_stats *sha256_stats_tls;
+
+static struct stats_block *stats_list;
+static struct stats_block stats_lost;    // when a block cannot be allocated
+static pthread_key_t stats_key;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+
+static void stats_release(void *arg) {
+    struct stats_block *b = arg;
+    __atomic_store_n(&b->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void stats_init_key(void) {
+    pthread_key_create(&stats_key, stats_release);
+}
+
+static struct stats_block *stats_attach(void) {
+    struct stats_block *b;
+    int idle = 0;
+
+    for (b = __atomic_load_n(&stats_list, __ATOMIC_ACQUIRE); b; b = b->next)
+        if (__atomic_compare_exchange_n(&b->in_use, &idle, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return b;
+        else
+            idle = 0;
+
+    if (posix_memalign((void **)&b, 64, sizeof(*b)) != 0)
+        return NULL;
+    *b = (struct stats_block){ .in_use = 1 };
+    b->next = __atomic_load_n(&stats_list, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&stats_list, &b->next, b, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    return b;
+}
+
+struct sha256_stats *sha256_stats_counters(u32 engine) {
+    struct stats_block *b;
+
+    if (sha256_stats_tls)
+        return sha256_stats_tls + engine;
+
+    pthread_once(&stats_once, stats_init_key);
+    b = stats_attach();
+    if (!b)
+        return stats_lost.engine + engine;   // uncounted, but never NULL
+    pthread_setspecific(stats_key, b);
+    sha256_stats_tls = b->engine;
+    return b->engine + engine;
+}
+
+int sha256_stats_enabled(void) {
+    return 1;
+}
+
+void sha256_stats_get(enum sha256_stats_engine engine, struct sha256_stats *out) {
+    const struct stats_block *b;
+    u64 *sum = (u64 *)out;
+    size_t i, n = sizeof(*out) / sizeof(u64);
+
+    *out = (struct sha256_stats){ 0 };
+    if ((u32)engine >= SHA256_STATS_ENGINES)
+        return;
+    for (b = __atomic_load_n(&stats_list, __ATOMIC_ACQUIRE); b; b = b->next) {
+        const u64 *f = (const u64 *)&b->engine[engine];
+        for (i = 0; i < n; ++i)
+            sum[i] += __atomic_load_n(&f[i], __ATOMIC_RELAXED);
+    }
+}
+
+#else
+
+int sha256_stats_enabled(void) {
+    return 0;
+}
+
+void sha256_stats_get(enum sha256_stats_engine engine, struct sha256_stats *out) {
+    (void)engine;
+    *out = (struct sha256_stats){ 0 };
+}
+
+#endif
+
+// 1536 -> "1.5 KB" style, powers of 1000 like the MB/s figures
+static const char *stats_size(double v, char buf[24]) {
+    static const char *const unit[] = { "B", "KB", "MB", "GB", "TB" };
+    int u = 0;
+
+    while (v >= 1000.0 && u < 4) {
+        v /= 1000.0;
+        u++;
+    }
+    snprintf(buf, 24, u ? "%.1f %s" : "%.0f %s", v, unit[u]);
+    return buf;
+}
+
+int sha256_stats_format(const struct sha256_stats *s, char *buf, size_t cap) {
+    char bytes[24], buffered[24];
+    double per_block = s->blocks ? (double)s->compress_cycles / (double)s->blocks : 0.0;
+
+    return snprintf(buf, cap,
+                    "update %llu calls %s (%llu buffered, %s) %llu cyc"
+                    " | compress %llu calls %llu blocks %.1f cyc/block"
+                    " | final %llu calls %llu blocks %llu cyc",
+                    (unsigned long long)s->update_calls, stats_size((double)s->update_bytes, bytes),
+                    (unsigned long long)s->buffer_fills, stats_size((double)s->buffer_bytes, buffered),
+                    (unsigned long long)s->update_cycles,
+                    (unsigned long long)s->compress_calls, (unsigned long long)s->blocks, per_block,
+                    (unsigned long long)s->final_calls, (unsigned long long)s->final_blocks,
+                    (unsigned long long)s->final_cycles);
+}
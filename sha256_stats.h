@@ -0,0 +1,120 @@
+/* sha256_stats.h
+ *
+ * Optional hot-path counters for the C and Rust cores: calls, bytes,
+ * blocks, partial-block buffer copies and time stamp counter cycles
+ * spent in update, the compression backend and final.
+ *
+ * Built only with -DSHA256_STATS on the C side and the "stats" cargo
+ * feature on the Rust side (make STATS=1 sets both). Without it every
+ * hook below is an empty macro, so the cores compile exactly as
+ * before, and the query functions report zeros.
+ *
+ * Each thread counts into its own cache-line-aligned block, found
+ * through a thread-local pointer, so the hot path never does an
+ * atomic read-modify-write or touches another thread's line. The
+ * blocks stay on a global list after their thread exits (a new thread
+ * reuses them), so sha256_stats_get() totals include finished workers.
+ *
+ * Typical usage:
+ *   struct sha256_stats s;
+ *   char line[256];
+ *   sha256_stats_get(SHA256_STATS_C, &s);       // all threads
+ *   sha256_stats_format(&s, line, sizeof(line));
+ *
+ * Needs a hosted system with threads when enabled.
+ */
+
+#ifndef SHA256_STATS_H
+#define SHA256_STATS_H
+
+#include <stddef.h>
+
+#include "sha256.h"
+
+// Which core a set of counters belongs to
+enum sha256_stats_engine {
+    SHA256_STATS_C = 0,        // sha256.c
+    SHA256_STATS_RUST,         // src/lib.rs
+    SHA256_STATS_ENGINES
+};
+
+// Counters of one engine; the layout is shared with src/stats.rs
+struct sha256_stats {
+    u64 update_calls;          // update / update64 calls
+    u64 update_bytes;          // bytes passed to them
+    u64 buffer_fills;          // copies into the partial-block buffer
+    u64 buffer_bytes;          // bytes copied into it
+    u64 compress_calls;        // backend calls (one run of blocks each)
+    u64 blocks;                // 64-byte blocks compressed, padding included
+    u64 final_calls;
+    u64 final_blocks;          // padding blocks: 1, or 2 if the length did not fit
+    u64 update_cycles;         // ticks in update, compression included
+    u64 compress_cycles;       // ticks in the backend
+    u64 final_cycles;          // ticks in final, compression included
+};
+
+/* sha256_stats_enabled()
+ * 1 if this build counts, 0 if the hooks compiled to nothing.
+ */
+int sha256_stats_enabled(void);
+
+/* sha256_stats_get()
+ * Sum of every thread's counters for engine. Other threads may still
+ * be counting, so the snapshot is not exact while they run.
+ */
+void sha256_stats_get(enum sha256_stats_engine engine, struct sha256_stats *out);
+
+/* sha256_stats_format()
+ * One line: "update 12 calls 4.0 MB (3 buffered, 130 B) | compress ...".
+ * Returns the length that snprintf() would.
+ */
+int sha256_stats_format(const struct sha256_stats *s, char *buf, size_t cap);
+
+/*
+ * Hooks for the cores. Not for applications.
+ */
+#ifdef SHA256_STATS
+
+// Calling thread's counters for engine; exported for the Rust core
+struct sha256_stats *sha256_stats_counters(u32 engine);
+
+extern __thread struct sha256_stats *sha256_stats_tls;
+
+static inline struct sha256_stats *sha256_stats_local(u32 engine) {
+    struct sha256_stats *s = sha256_stats_tls;
+    return s ? s + engine : sha256_stats_counters(engine);
+}
+
+// Time stamp counter; 0 where there is none
+static inline u64 sha256_stats_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    u64 v;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return 0;
+#endif
+}
+
+/* Relaxed load and store, not an atomic add: only this thread writes
+ * the field, but sha256_stats_get() may read it at any time */
+#define SHA256_STATS_ADD(engine, field, n) do {                               \
+        u64 *f_ = &sha256_stats_local(engine)->field;                          \
+        __atomic_store_n(f_, __atomic_load_n(f_, __ATOMIC_RELAXED) + (u64)(n), \
+                         __ATOMIC_RELAXED);                                    \
+    } while (0)
+
+#define SHA256_STATS_START(t)                 u64 t = sha256_stats_clock()
+#define SHA256_STATS_STOP(engine, field, t)   SHA256_STATS_ADD(engine, field, sha256_stats_clock() - (t))
+
+#else
+
+#define SHA256_STATS_ADD(engine, field, n)    ((void)0)
+#define SHA256_STATS_START(t)                 ((void)0)
+#define SHA256_STATS_STOP(engine, field, t)   ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,214 @@
+/* sha256_tree.c
+ *
+ * Parallel tree hashing (see sha256_tree.h).
+ *
+ * Workers pull leaf indices from a shared atomic counter, so fast and
+ * slow threads balance out without any locking. Each leaf digest goes
+ * into its own slot of one array; once all leaves are done the levels
+ * above are combined in place. Upper levels are tiny next to the leaf
+ * level (one node per 2 MiB of input by default), so that part stays
+ * on the calling thread.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sha256_tree.h"
+#include "sha256_rust.h"
+
+// Everything the workers share for one tree
+struct tree_job {
+    const u8 *data;            // in-memory input, or NULL for fd
+    int fd;                    // file input when data is NULL
+    u64 len;                   // total input length
+    u64 leaf_size;
+    u64 nleaves;
+    enum sha256_engine engine;
+    u8 (*digest)[32];          // one slot per leaf
+    u64 next;                  // next leaf to claim (atomic)
+    int error;                 // first errno seen by a worker
+};
+
+/* Hash prefix || a || b with the chosen engine. Leaves pass b = NULL,
+ * nodes pass both children. */
+static void tree_hash(enum sha256_engine engine, u8 prefix,
+                      const u8 *a, u64 alen, const u8 *b, u64 blen, u8 out[32]) {
+    if (engine == SHA256_ENGINE_RUST) {
+        RustSha256Ctx ctx;
+        rust_sha256_init(&ctx);
+        rust_sha256_update64(&ctx, &prefix, 1);
+        rust_sha256_update64(&ctx, a, alen);
+        if (b) rust_sha256_update64(&ctx, b, blen);
+        rust_sha256_final(&ctx, out);
+    } else {
+        struct sha256_ctx ctx;
+        sha256_init(&ctx);
+        sha256_update64(&ctx, &prefix, 1);
+        sha256_update64(&ctx, a, alen);
+        if (b) sha256_update64(&ctx, b, blen);
+        sha256_final(&ctx, out);
+    }
+}
+
+// Read exactly n bytes at off, retrying short reads
+static int read_full(int fd, u8 *buf, u64 n, u64 off) {
+    while (n > 0) {
+        ssize_t r = pread(fd, buf, n, (off_t)off);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (r == 0) {
+            errno = EIO;   // file shrank while we were hashing it
+            return -1;
+        }
+        buf += r;
+        off += (u64)r;
+        n -= (u64)r;
+    }
+    return 0;
+}
+
+static void *tree_worker(void *arg) {
+    struct tree_job *job = arg;
+    u8 *buf = NULL;
+
+    if (!job->data) {
+        buf = malloc(job->leaf_size);
+        if (!buf) {
+            __atomic_store_n(&job->error, ENOMEM, __ATOMIC_RELAXED);
+            return NULL;
+        }
+    }
+
+    for (;;) {
+        u64 i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        const u8 *leaf;
+        u64 off, n;
+
+        if (i >= job->nleaves || __atomic_load_n(&job->error, __ATOMIC_RELAXED))
+            break;
+
+        off = i * job->leaf_size;
+        n = job->len - off;
+        if (n > job->leaf_size) n = job->leaf_size;
+
+        if (job->data) {
+            leaf = job->data + off;
+        } else {
+            if (read_full(job->fd, buf, n, off) != 0) {
+                __atomic_store_n(&job->error, errno, __ATOMIC_RELAXED);
+                break;
+            }
+            leaf = buf;
+        }
+        tree_hash(job->engine, 0x00, leaf, n, NULL, 0, job->digest[i]);
+    }
+
+    free(buf);
+    return NULL;
+}
+
+// Combine the leaf digests level by level, in place
+static void tree_combine(enum sha256_engine engine, u8 (*d)[32], u64 n, u8 out[32]) {
+    u8 node[32];
+
+    while (n > 1) {
+        u64 i, m = 0;
+        for (i = 0; i + 1 < n; i += 2) {
+            tree_hash(engine, 0x01, d[i], 32, d[i + 1], 32, node);
+            memcpy(d[m++], node, 32);
+        }
+        if (n & 1)                      // odd one out moves up as-is
+            memcpy(d[m++], d[n - 1], 32);
+        n = m;
+    }
+    memcpy(out, d[0], 32);
+}
+
+static int tree_run(struct tree_job *job, const struct sha256_tree_opts *opts, u8 out[32]) {
+    pthread_t *tids;
+    u32 threads = 0, started = 0, t;
+
+    job->leaf_size = SHA256_TREE_DEFAULT_LEAF;
+    job->engine = SHA256_ENGINE_C;
+    if (opts) {
+        if (opts->leaf_size) job->leaf_size = opts->leaf_size;
+        threads = opts->threads;
+        job->engine = opts->engine;
+    }
+    if (threads == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = ncpu > 0 ? (u32)ncpu : 1;
+    }
+
+    // An empty input is one empty leaf
+    job->nleaves = job->len ? (job->len + job->leaf_size - 1) / job->leaf_size : 1;
+    if (threads > job->nleaves) threads = (u32)job->nleaves;
+    job->next = 0;
+    job->error = 0;
+
+    job->digest = malloc(job->nleaves * 32);
+    tids = malloc(threads * sizeof(*tids));
+    if (!job->digest || !tids) {
+        free(job->digest);
+        free(tids);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // The calling thread is worker 0
+    for (t = 1; t < threads; ++t) {
+        if (pthread_create(&tids[t], NULL, tree_worker, job) != 0)
+            break;
+        started++;
+    }
+    tree_worker(job);
+    for (t = 1; t <= started; ++t)
+        pthread_join(tids[t], NULL);
+    free(tids);
+
+    if (job->error) {
+        free(job->digest);
+        errno = job->error;
+        return -1;
+    }
+
+    tree_combine(job->engine, job->digest, job->nleaves, out);
+    free(job->digest);
+    return 0;
+}
+
+int sha256_tree_hash(const u8 *data, u64 len, const struct sha256_tree_opts *opts, u8 out_root32[32]) {
+    static const u8 empty[1];
+    struct tree_job job;
+
+    job.data = data ? data : empty;
+    job.fd = -1;
+    job.len = len;
+    return tree_run(&job, opts, out_root32);
+}
+
+int sha256_tree_fd(int fd, const struct sha256_tree_opts *opts, u8 out_root32[32]) {
+    struct tree_job job;
+    struct stat st;
+
+    if (fstat(fd, &st) != 0)
+        return -1;
+    /* Leaves are read by offset, which needs a seekable file of known
+     * length. Regular files that report size 0 (procfs, sysfs) may
+     * still have contents; they are read whole by the caller too. */
+    if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+        errno = ESPIPE;
+        return -1;
+    }
+
+    job.data = NULL;
+    job.fd = fd;
+    job.len = (u64)st.st_size;
+    return tree_run(&job, opts, out_root32);
+}
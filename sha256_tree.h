@@ -0,0 +1,61 @@
+/* sha256_tree.h
+ *
+ * Parallel tree hashing for large inputs.
+ *
+ * The input is cut into fixed-size leaves, the leaves are hashed on
+ * all cores, and the leaf digests are combined pairwise into a
+ * Merkle root:
+ *
+ *   leaf = SHA-256(0x00 || leaf bytes)
+ *   node = SHA-256(0x01 || left || right)
+ *
+ * The 0x00 / 0x01 prefixes keep leaf and node hashes apart, so a
+ * leaf can never be passed off as an inner node. An odd node at the
+ * end of a level moves up unchanged. The root depends on the leaf
+ * size and is NOT the plain SHA-256 of the input.
+ *
+ * Typical usage:
+ *   struct sha256_tree_opts opts = { 0 };     // defaults
+ *   sha256_tree_hash(data, len, &opts, root32);
+ *
+ * Unlike sha256.c this module needs a hosted system (POSIX threads).
+ */
+
+#ifndef SHA256_TREE_H
+#define SHA256_TREE_H
+
+#include "sha256.h"
+
+#define SHA256_TREE_DEFAULT_LEAF (1ull << 20)   // 1 MiB leaves
+
+// Which implementation hashes the leaves and nodes
+enum sha256_engine {
+    SHA256_ENGINE_C = 0,   // sha256.c
+    SHA256_ENGINE_RUST     // src/lib.rs via FFI
+};
+
+/*
+ * Tree options. Zero fields mean "default":
+ * leaf_size SHA256_TREE_DEFAULT_LEAF, threads = online CPUs, C engine.
+ */
+struct sha256_tree_opts {
+    u64 leaf_size;             // bytes per leaf
+    u32 threads;               // worker threads
+    enum sha256_engine engine; // leaf/node hash implementation
+};
+
+/* sha256_tree_hash()
+ * Tree hash of an in-memory buffer. Returns 0, or -1 if the workers
+ * could not be started or memory ran out (errno is set).
+ */
+int sha256_tree_hash(const u8 *data, u64 len, const struct sha256_tree_opts *opts, u8 out_root32[32]);
+
+/* sha256_tree_fd()
+ * Tree hash of a regular file: each worker pread()s its own leaves.
+ * Returns 0, or -1 on a read error (errno is set). For anything but a
+ * regular file of nonzero size errno is ESPIPE: read it into memory
+ * and use sha256_tree_hash().
+ */
+int sha256_tree_fd(int fd, const struct sha256_tree_opts *opts, u8 out_root32[32]);
+
+#endif
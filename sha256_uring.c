@@ -0,0 +1,286 @@
+/* sha256_uring.c
+ *
+ * io_uring file reader (see sha256_uring.h).
+ *
+ * Buffer k always holds chunk seq with seq % depth == k, so handing
+ * chunks out in order is just walking the buffers round robin and
+ * waiting for the one due next; completions for later chunks that
+ * arrive first simply wait in their buffers. A short read is retried
+ * for the rest of its buffer, so only a read that returns 0 marks the
+ * end of the file.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "sha256_uring.h"
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#define SHA256_HAVE_URING 1
+#include <linux/io_uring.h>
+#endif
+
+#ifdef SHA256_HAVE_URING
+
+static int ring_setup(u32 entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int ring_enter(int ring_fd, u32 submit, u32 wait) {
+    return (int)syscall(__NR_io_uring_enter, ring_fd, submit, wait,
+                        wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+static int ring_register(int ring_fd, u32 op, const void *arg, u32 n) {
+    return (int)syscall(__NR_io_uring_register, ring_fd, op, arg, n);
+}
+
+// Queue a read of the rest of buffer k
+static void queue_read(struct sha256_uring *r, u32 k) {
+    struct sha256_uring_slot *s = &r->slot[k];
+    u32 tail = *r->sq_tail, idx = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = (struct io_uring_sqe *)r->sqes + idx;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->fd = r->fd;
+    sqe->addr = (u64)(uintptr_t)(r->bufs + (u64)k * SHA256_URING_BUF_SIZE + s->got);
+    sqe->len = SHA256_URING_BUF_SIZE - s->got;
+    sqe->off = s->off + s->got;
+    sqe->buf_index = (__u16)k;
+    sqe->user_data = k;
+    r->sq_array[idx] = idx;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    r->inflight++;
+    r->unsubmitted++;
+}
+
+// Start chunk seq's read in its buffer
+static void queue_chunk(struct sha256_uring *r, u64 seq) {
+    struct sha256_uring_slot *s = &r->slot[seq % r->depth];
+
+    s->off = r->next_off;
+    s->got = 0;
+    s->done = 0;
+    s->error = 0;
+    r->next_off += SHA256_URING_BUF_SIZE;
+    queue_read(r, (u32)(seq % r->depth));
+}
+
+// Take every completion off the CQ ring
+static void reap(struct sha256_uring *r) {
+    u32 head = *r->cq_head;
+    u32 tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head) {
+        const struct io_uring_cqe *cqe = (const struct io_uring_cqe *)r->cqes + (head & *r->cq_mask);
+        struct sha256_uring_slot *s = &r->slot[cqe->user_data];
+        int res = cqe->res;
+
+        r->inflight--;
+        if (res == -EINTR || res == -EAGAIN) {
+            queue_read(r, (u32)cqe->user_data);
+        } else if (res < 0) {
+            s->error = -res;
+            s->done = 1;
+        } else if (res == 0 || r->eof) {
+            s->done = 1;
+        } else {
+            s->got += (u32)res;
+            if (s->got < SHA256_URING_BUF_SIZE)
+                queue_read(r, (u32)cqe->user_data);
+            else
+                s->done = 1;
+        }
+    }
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+}
+
+// Submit what is queued and wait for at least one completion
+static int submit_and_wait(struct sha256_uring *r) {
+    int n = ring_enter(r->ring_fd, r->unsubmitted, 1);
+
+    if (n < 0)
+        return errno == EINTR ? 0 : -1;
+    r->unsubmitted -= (u32)n;
+    reap(r);
+    return 0;
+}
+
+static void release(struct sha256_uring *r) {
+    if (r->bufs)
+        munmap(r->bufs, (size_t)r->depth * SHA256_URING_BUF_SIZE);
+    if (r->sqes)
+        munmap(r->sqes, r->sqes_len);
+    if (r->cq_map && r->cq_map != r->sq_map)
+        munmap(r->cq_map, r->cq_map_len);
+    if (r->sq_map)
+        munmap(r->sq_map, r->sq_map_len);
+    if (r->ring_fd >= 0)
+        close(r->ring_fd);
+    r->bufs = NULL;
+    r->sqes = r->sq_map = r->cq_map = NULL;
+    r->ring_fd = -1;
+}
+
+int sha256_uring_init(struct sha256_uring *r, int fd, u32 depth) {
+    struct io_uring_params p;
+    struct iovec iov[SHA256_URING_MAX_DEPTH];
+    u8 *sq, *cq;
+    u32 k;
+    int n, err;
+
+    memset(r, 0, sizeof(*r));
+    r->ring_fd = -1;
+    r->fd = fd;
+    r->depth = depth == 0 ? SHA256_URING_DEFAULT_DEPTH
+             : depth > SHA256_URING_MAX_DEPTH ? SHA256_URING_MAX_DEPTH : depth;
+
+    memset(&p, 0, sizeof(p));
+    r->ring_fd = ring_setup(r->depth, &p);
+    if (r->ring_fd < 0)
+        return -1;
+
+    r->sq_map_len = p.sq_off.array + p.sq_entries * sizeof(u32);
+    r->cq_map_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_map_len > r->sq_map_len) r->sq_map_len = r->cq_map_len;
+        r->cq_map_len = r->sq_map_len;
+    }
+    r->sq_map = mmap(NULL, r->sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     r->ring_fd, IORING_OFF_SQ_RING);
+    if (r->sq_map == MAP_FAILED) {
+        r->sq_map = NULL;
+        goto fail;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_map = r->sq_map;
+    } else {
+        r->cq_map = mmap(NULL, r->cq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         r->ring_fd, IORING_OFF_CQ_RING);
+        if (r->cq_map == MAP_FAILED) {
+            r->cq_map = NULL;
+            goto fail;
+        }
+    }
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->ring_fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        goto fail;
+    }
+
+    sq = r->sq_map;
+    cq = r->cq_map;
+    r->sq_tail = (u32 *)(sq + p.sq_off.tail);
+    r->sq_mask = (u32 *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (u32 *)(sq + p.sq_off.array);
+    r->cq_head = (u32 *)(cq + p.cq_off.head);
+    r->cq_tail = (u32 *)(cq + p.cq_off.tail);
+    r->cq_mask = (u32 *)(cq + p.cq_off.ring_mask);
+    r->cqes = cq + p.cq_off.cqes;
+
+    /* Buffers come from mmap, not malloc: if the ring ever has to be
+     * closed with reads in flight, the kernel can only write to pages
+     * that are unmapped by then, never to reused heap memory */
+    r->bufs = mmap(NULL, (size_t)r->depth * SHA256_URING_BUF_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (r->bufs == MAP_FAILED) {
+        r->bufs = NULL;
+        goto fail;
+    }
+    for (k = 0; k < r->depth; ++k) {
+        iov[k].iov_base = r->bufs + (u64)k * SHA256_URING_BUF_SIZE;
+        iov[k].iov_len = SHA256_URING_BUF_SIZE;
+    }
+    if (ring_register(r->ring_fd, IORING_REGISTER_BUFFERS, iov, r->depth) != 0)
+        goto fail;
+
+    for (k = 0; k < r->depth; ++k)
+        queue_chunk(r, k);
+    n = ring_enter(r->ring_fd, r->unsubmitted, 0);
+    if (n < 0 && errno != EINTR)
+        goto fail;
+    if (n > 0)
+        r->unsubmitted -= (u32)n;
+    return 0;
+
+fail:
+    err = errno;
+    release(r);
+    errno = err;
+    return -1;
+}
+
+ssize_t sha256_uring_next(struct sha256_uring *r, const u8 **data) {
+    struct sha256_uring_slot *s;
+
+    // The caller is done with the last chunk: reuse its buffer
+    if (r->returned) {
+        r->returned = 0;
+        if (!r->eof)
+            queue_chunk(r, r->seq - 1 + r->depth);
+    }
+    if (r->eof)
+        return 0;
+
+    s = &r->slot[r->seq % r->depth];
+    reap(r);
+    while (!s->done)
+        if (submit_and_wait(r) != 0)
+            return -1;
+
+    if (s->error) {
+        errno = s->error;
+        return -1;
+    }
+    if (s->got < SHA256_URING_BUF_SIZE)
+        r->eof = 1;
+    if (s->got == 0)
+        return 0;
+
+    *data = r->bufs + (r->seq % r->depth) * SHA256_URING_BUF_SIZE;
+    r->seq++;
+    r->returned = 1;
+    return (ssize_t)s->got;
+}
+
+void sha256_uring_free(struct sha256_uring *r) {
+    r->eof = 1;   // retry nothing
+    while (r->inflight > 0 && r->ring_fd >= 0)
+        if (submit_and_wait(r) != 0)
+            break;
+    release(r);
+}
+
+#else
+
+int sha256_uring_init(struct sha256_uring *r, int fd, u32 depth) {
+    (void)fd;
+    (void)depth;
+    memset(r, 0, sizeof(*r));
+    r->ring_fd = -1;
+    errno = ENOSYS;
+    return -1;
+}
+
+ssize_t sha256_uring_next(struct sha256_uring *r, const u8 **data) {
+    (void)r;
+    (void)data;
+    errno = ENOSYS;
+    return -1;
+}
+
+void sha256_uring_free(struct sha256_uring *r) {
+    (void)r;
+}
+
+#endif
@@ -0,0 +1,92 @@
+/* sha256_uring.h
+ *
+ * In-order file reader on Linux io_uring, for the streaming path of
+ * sha256_file.c.
+ *
+ * A blocking pread() loop has one request in flight: the device idles
+ * while the core hashes, and the core idles while the device reads.
+ * This reader keeps depth reads in flight at consecutive offsets, into
+ * buffers registered with the kernel once (IORING_OP_READ_FIXED, no
+ * per-read page pinning). sha256_uring_next() hands out the next chunk
+ * in file order as a pointer into its buffer, with no copy; the
+ * previous chunk's buffer goes back to the kernel for the next read
+ * at that moment, so the reads run while the caller hashes.
+ *
+ * The ring is driven with raw syscalls; liburing is not needed.
+ * sha256_uring_init() fails where io_uring cannot be used: other
+ * systems (errno ENOSYS), kernels before 5.1, io_uring disabled by
+ * sysctl or seccomp, or a memlock limit too low for the buffers.
+ * Callers then fall back to pread() or mmap().
+ *
+ * Typical usage:
+ *   struct sha256_uring r;
+ *   if (sha256_uring_init(&r, fd, 0) == 0) {
+ *       while ((n = sha256_uring_next(&r, &data)) > 0)
+ *           sha256_update64(&ctx, data, (u64)n);
+ *       sha256_uring_free(&r);               // n < 0: read error
+ *   }
+ */
+
+#ifndef SHA256_URING_H
+#define SHA256_URING_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "sha256.h"
+
+#define SHA256_URING_BUF_SIZE      (256u << 10)   // bytes per read
+#define SHA256_URING_DEFAULT_DEPTH 16             // reads in flight
+#define SHA256_URING_MAX_DEPTH     64
+
+// One buffer and the read that fills it
+struct sha256_uring_slot {
+    u64 off;                   // file offset of the buffer's first byte
+    u32 got;                   // bytes read so far
+    int done;                  // complete: full, short at end of file, or failed
+    int error;                 // errno of a failed read
+};
+
+struct sha256_uring {
+    int ring_fd;
+    int fd;                    // file being read
+    u32 depth;
+
+    // Rings shared with the kernel
+    u32 *sq_tail, *sq_mask, *sq_array;
+    u32 *cq_head, *cq_tail, *cq_mask;
+    void *sqes, *cqes;
+    void *sq_map, *cq_map;
+    size_t sq_map_len, cq_map_len, sqes_len;
+
+    u8 *bufs;                  // depth * SHA256_URING_BUF_SIZE, registered
+    struct sha256_uring_slot slot[SHA256_URING_MAX_DEPTH];
+    u64 seq;                   // next chunk to hand out, in file order
+    u64 next_off;              // offset of the next read to queue
+    u32 inflight;
+    u32 unsubmitted;           // reads queued but not yet passed to the kernel
+    int returned;              // seq - 1's buffer is still with the caller
+    int eof;                   // a short read was seen: queue no more
+};
+
+/* sha256_uring_init()
+ * Set up a ring with depth registered buffers (0 = default, at most
+ * SHA256_URING_MAX_DEPTH) and queue reads of fd from offset 0.
+ * fd must be seekable. Returns 0, or -1 with errno set if io_uring
+ * is not usable here; nothing is left to free then.
+ */
+int sha256_uring_init(struct sha256_uring *r, int fd, u32 depth);
+
+/* sha256_uring_next()
+ * Next chunk of the file in order. *data stays valid until the next
+ * call or sha256_uring_free(). Returns its length, 0 at end of file,
+ * or -1 with errno set on a read error.
+ */
+ssize_t sha256_uring_next(struct sha256_uring *r, const u8 **data);
+
+/* sha256_uring_free()
+ * Wait for reads still in flight, then release the ring and buffers.
+ */
+void sha256_uring_free(struct sha256_uring *r);
+
+#endif
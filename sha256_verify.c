@@ -0,0 +1,1361 @@
+/* sha256_verify.c
+ *
+ * Headless correctness and performance-regression checks for both
+ * cores, against OpenSSL's libcrypto as the reference.
+ *
+ *   sha256_verify [--cavp FILE.rsp]... [--seed N] [--iterations N] [--long]
+ *   sha256_verify --perf-baseline FILE --perf-current FILE [--threshold R]
+ *
+ * The first form runs, in order:
+ *   1. the FIPS 180-4 example vectors (and the 1 GiB one with --long)
+ *   2. NIST CAVP response files (SHA256ShortMsg.rsp, SHA256LongMsg.rsp,
+ *      SHA256Monte.rsp from the SHAVS test vectors) given with --cavp
+ *   3. a randomized differential test: random messages, each fed in
+ *      one random split pattern to every C and Rust backend this CPU
+ *      runs and through every other entry point (one-shot, sha256_mb_*
+ *      on every lane kernel, tree and Merkle hashing, HMAC, PBKDF2,
+ *      HKDF, export / import between the cores, hex formatting,
+ *      contexts from both context pools, SHA-224 and truncated
+ *      digests, rolling log hashes and their sidecar files, whole-file
+ *      readers and the parallel file scheduler over temporary files)
+ * Every result is compared with libcrypto. The first mismatch stops
+ * the run with the seed and iteration, so it can be replayed with
+ * --seed N --iterations (iteration + 1).
+ *
+ * The second form gates a release on throughput: it reads two CSV
+ * files written by sha256_bench on the same machine and fails if any
+ * C or Rust engine at a size of --min-size or more (default 64K) got
+ * slower than --threshold (default 0.90) times its baseline figure.
+ *
+ * Exits 0 if everything passed, 1 on a failure, 2 on bad usage.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include "sha256.h"
+#include "sha256_file.h"
+#include "sha256_kdf.h"
+#include "sha256_log.h"
+#include "sha256_mb.h"
+#include "sha256_merkle.h"
+#include "sha256_pool.h"
+#include "sha256_rust.h"
+#include "sha256_sched.h"
+#include "sha256_tree.h"
+
+#define MAX_MSG   (4u << 20)   // longest random message
+#define MAX_KEY   200          // longest random HMAC key / KDF input
+#define MAX_PIECES (1u << 17)  // update calls per message, at most
+#define FILE_COUNT 12          // files per check_files() run
+#define FILE_MAX   (1u << 20)  // largest of them
+
+// One streaming engine: a core and one of its compression backends
+struct engine {
+    char name[32];
+    int rust;
+    enum sha256_backend backend;
+};
+
+static struct engine engines[8];
+static int nengines;
+
+static u64 rng_state;
+static u64 iteration;
+static unsigned long long seed;
+static unsigned long long checks;
+
+static u64 rng(void) {
+    // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1Dull;
+}
+
+// Uniform in 0..n-1 (n > 0)
+static u64 rng_below(u64 n) {
+    return rng() % n;
+}
+
+static void rng_fill(u8 *p, u64 n) {
+    u64 i, r = 0;
+    for (i = 0; i < n; ++i) {
+        if ((i & 7) == 0) r = rng();
+        p[i] = (u8)r;
+        r >>= 8;
+    }
+}
+
+static void print_hex(FILE *out, const u8 *p, u64 n) {
+    u64 i;
+    for (i = 0; i < n; ++i)
+        fprintf(out, "%02x", p[i]);
+}
+
+// Report a mismatch and stop
+static void fail(const char *what, u64 len, const u8 *got, const u8 *want, u64 n) {
+    fprintf(stderr, "FAIL: %s (length %llu, seed %llu, iteration %llu)\n",
+            what, (unsigned long long)len, seed, (unsigned long long)iteration);
+    fprintf(stderr, "  got  ");
+    print_hex(stderr, got, n);
+    fprintf(stderr, "\n  want ");
+    print_hex(stderr, want, n);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+static void expect(const char *what, u64 len, const u8 *got, const u8 *want, u64 n) {
+    checks++;
+    if (memcmp(got, want, n) != 0)
+        fail(what, len, got, want, n);
+}
+
+static void expect_true(const char *what, int ok) {
+    checks++;
+    if (!ok) {
+        fprintf(stderr, "FAIL: %s (seed %llu, iteration %llu)\n", what, seed,
+                (unsigned long long)iteration);
+        exit(1);
+    }
+}
+
+/*
+ * Reference hashes (libcrypto)
+ */
+
+// SHA-256 of a || b || c, any of them may be empty
+static void ref_sha256(const u8 *a, u64 alen, const u8 *b, u64 blen, const u8 *c, u64 clen, u8 out[32]) {
+    EVP_MD_CTX *md = EVP_MD_CTX_new();
+    unsigned int n;
+
+    if (!md || !EVP_DigestInit_ex(md, EVP_sha256(), NULL)
+        || !EVP_DigestUpdate(md, a, alen) || !EVP_DigestUpdate(md, b, blen)
+        || !EVP_DigestUpdate(md, c, clen) || !EVP_DigestFinal_ex(md, out, &n)) {
+        fprintf(stderr, "sha256_verify: libcrypto SHA-256 failed\n");
+        exit(1);
+    }
+    EVP_MD_CTX_free(md);
+}
+
+static void ref_sha224(const u8 *data, u64 len, u8 out[28]) {
+    unsigned int n;
+    if (!EVP_Digest(data, (size_t)len, out, &n, EVP_sha224(), NULL)) {
+        fprintf(stderr, "sha256_verify: libcrypto SHA-224 failed\n");
+        exit(1);
+    }
+}
+
+static void ref_hmac(const u8 *key, u64 klen, const u8 *msg, u64 len, u8 out[32]) {
+    static const u8 empty = 0;
+    unsigned int n;
+    if (!HMAC(EVP_sha256(), klen ? key : &empty, (int)klen, len ? msg : &empty, (size_t)len, out, &n)) {
+        fprintf(stderr, "sha256_verify: libcrypto HMAC failed\n");
+        exit(1);
+    }
+}
+
+// RFC 5869 from HMAC, so it needs nothing past the 1.1 API
+static void ref_hkdf(const u8 *salt, u64 saltlen, const u8 *ikm, u64 ikmlen,
+                     const u8 *info, u64 infolen, u8 *out, u64 outlen) {
+    u8 zero[32] = { 0 }, prk[32], t[32], msg[32 + MAX_KEY + 1];
+    u64 done = 0, tlen = 0, n;
+    u8 i;
+
+    if (saltlen == 0)
+        ref_hmac(zero, 32, ikm, ikmlen, prk);
+    else
+        ref_hmac(salt, saltlen, ikm, ikmlen, prk);
+    for (i = 1; done < outlen; ++i) {
+        memcpy(msg, t, tlen);
+        memcpy(msg + tlen, info, infolen);
+        msg[tlen + infolen] = i;
+        ref_hmac(prk, 32, msg, tlen + infolen + 1, t);
+        tlen = 32;
+        n = outlen - done < 32 ? outlen - done : 32;
+        memcpy(out + done, t, n);
+        done += n;
+    }
+}
+
+// Tree root with the sha256_tree.h rules, from leaf digests
+static void ref_root(u8 (*d)[32], u64 n, u8 out[32]) {
+    static const u8 node = 0x01;
+    u64 i;
+
+    while (n > 1) {
+        for (i = 0; i + 1 < n; i += 2)
+            ref_sha256(&node, 1, d[i], 32, d[i + 1], 32, d[i / 2]);
+        if (n & 1)
+            memcpy(d[n / 2], d[n - 1], 32);
+        n = (n + 1) / 2;
+    }
+    memcpy(out, d[0], 32);
+}
+
+/*
+ * Streaming engines
+ */
+
+static void engine_select(const struct engine *e) {
+    if (e->rust)
+        rust_sha256_use_backend(e->backend);
+    else
+        sha256_use_backend(e->backend);
+}
+
+// Feed one piece through update() when it fits a u32 and the piece is odd-numbered
+static void c_feed(struct sha256_ctx *ctx, const u8 *p, u64 n, u64 piece) {
+    if ((piece & 1) && n <= 0xffffffffu)
+        sha256_update(ctx, p, (u32)n);
+    else
+        sha256_update64(ctx, p, n);
+}
+
+static void rust_feed(RustSha256Ctx *ctx, const u8 *p, u64 n, u64 piece) {
+    if ((piece & 1) && n <= 0xffffffffu)
+        rust_sha256_update(ctx, p, (u32)n);
+    else
+        rust_sha256_update64(ctx, p, n);
+}
+
+/* Hash data in the given pieces. If handoff is not NULL, the state is
+ * exported after piece `at` and resumed in the core *handoff names
+ * (1 = Rust) */
+static void engine_hash(const struct engine *e, const u8 *data, const u64 *piece, u64 npieces,
+                        u64 at, const int *handoff, u8 out[32]) {
+    struct sha256_ctx c;
+    RustSha256Ctx r;
+    u8 state[SHA256_STATE_BYTES];
+    int rust = e->rust;
+    u64 i, off = 0;
+
+    engine_select(e);
+    if (rust) rust_sha256_init(&r);
+    else      sha256_init(&c);
+
+    for (i = 0; i < npieces; ++i) {
+        if (rust) rust_feed(&r, data + off, piece[i], i);
+        else      c_feed(&c, data + off, piece[i], i);
+        off += piece[i];
+
+        if (handoff && i == at) {
+            if (rust) rust_sha256_export(&r, state);
+            else      sha256_export(&c, state);
+            rust = *handoff;
+            if (rust) expect_true("rust_sha256_import of an exported state", rust_sha256_import(&r, state) == 0);
+            else      expect_true("sha256_import of an exported state", sha256_import(&c, state) == 0);
+        }
+    }
+    if (rust) rust_sha256_final(&r, out);
+    else      sha256_final(&c, out);
+}
+
+static void add_engines(void) {
+    static const enum sha256_backend backends[] = {
+        SHA256_BACKEND_SCALAR, SHA256_BACKEND_SHANI, SHA256_BACKEND_ARMV8
+    };
+    size_t b;
+
+    for (b = 0; b < sizeof(backends) / sizeof(backends[0]); ++b) {
+        if (sha256_use_backend(backends[b]) != 0)
+            continue;
+        snprintf(engines[nengines].name, sizeof(engines[nengines].name), "c-%s", sha256_backend_name());
+        engines[nengines].rust = 0;
+        engines[nengines++].backend = backends[b];
+    }
+    for (b = 0; b < sizeof(backends) / sizeof(backends[0]); ++b) {
+        if (rust_sha256_use_backend(backends[b]) != 0)
+            continue;
+        snprintf(engines[nengines].name, sizeof(engines[nengines].name), "rust-%s", rust_sha256_backend_name());
+        engines[nengines].rust = 1;
+        engines[nengines++].backend = backends[b];
+    }
+    sha256_use_backend(SHA256_BACKEND_AUTO);
+    rust_sha256_use_backend(SHA256_BACKEND_AUTO);
+}
+
+// Every engine, whole message in one update
+static void check_all(const char *what, const u8 *data, u64 len, const u8 want[32]) {
+    char name[256];
+    u8 got[32];
+    int e;
+
+    for (e = 0; e < nengines; ++e) {
+        engine_hash(&engines[e], data, &len, 1, 0, NULL, got);
+        snprintf(name, sizeof(name), "%.200s, %.31s", what, engines[e].name);
+        expect(name, len, got, want, 32);
+    }
+    sha256_digest(data, len, got);
+    snprintf(name, sizeof(name), "%s, sha256_digest", what);
+    expect(name, len, got, want, 32);
+}
+
+/*
+ * 1. FIPS 180-4 examples
+ */
+
+static void check_known(int with_long) {
+    static const struct {
+        const char *msg;
+        u64 repeat;
+        const char *md;
+    } known[] = {
+        { "", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+        { "abc", 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+        { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+        { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1,
+          "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1" },
+        { "a", 1000000, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+        { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmno", 16777216,
+          "50e72a0e26442fe2552dc3938ac58658228c0cbfb1d2ca872ae435266fcd055e" },
+    };
+    size_t k;
+    u64 i, n;
+    u8 want[32], got[32], *buf;
+
+    for (k = 0; k < sizeof(known) / sizeof(known[0]); ++k) {
+        n = strlen(known[k].msg);
+        if (known[k].repeat * n > (64u << 20) && !with_long)
+            continue;
+        buf = malloc(known[k].repeat * n + 1);
+        if (!buf) {
+            fprintf(stderr, "sha256_verify: out of memory\n");
+            exit(1);
+        }
+        for (i = 0; i < known[k].repeat; ++i)
+            memcpy(buf + i * n, known[k].msg, n);
+        sha256_from_hex(known[k].md, want);
+        check_all("FIPS 180-4 example", buf, known[k].repeat * n, want);
+        free(buf);
+    }
+
+    // SHA-224 examples, on the C core's one-shot
+    sha256_from_hex("23097d223405d8228642a477bda255b32aadbce4bda0b3f7e36c9da700000000", want);
+    sha224_digest((const u8 *)"abc", 3, got);
+    expect("FIPS 180-4 SHA-224 example", 3, got, want, 28);
+    sha256_from_hex("75388b16512776cc5dba5da1fd890150b0c6455cb4f58b195252252500000000", want);
+    sha224_digest((const u8 *)known[2].msg, 56, got);
+    expect("FIPS 180-4 SHA-224 example", 56, got, want, 28);
+}
+
+/*
+ * 2. CAVP response files
+ */
+
+// "Key = value" -> value, or NULL if line is not "key = ..."
+static char *rsp_value(char *line, const char *key) {
+    size_t n = strlen(key);
+    char *v, *end;
+
+    if (strncmp(line, key, n) != 0)
+        return NULL;
+    v = line + n;
+    while (*v == ' ') v++;
+    if (*v++ != '=')
+        return NULL;
+    while (*v == ' ') v++;
+    end = v + strlen(v);
+    while (end > v && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' '))
+        *--end = '\0';
+    return v;
+}
+
+static int parse_hex(const char *hex, u8 *out, u64 n) {
+    u64 i;
+    unsigned v;
+
+    if (strlen(hex) < 2 * n)
+        return -1;
+    for (i = 0; i < n; ++i) {
+        if (sscanf(hex + 2 * i, "%2x", &v) != 1)
+            return -1;
+        out[i] = (u8)v;
+    }
+    return 0;
+}
+
+/* ShortMsg / LongMsg: "Len = bits", "Msg = hex", "MD = hex".
+ * Monte: "Seed = hex" then "COUNT = j", "MD = hex" per checkpoint,
+ * with MD_i = SHA-256(MD_i-3 || MD_i-2 || MD_i-1) over 1000 rounds */
+static int check_cavp(const char *path) {
+    FILE *f = fopen(path, "r");
+    static char line[1 << 18];
+    u8 *msg = NULL, seed_md[3][32], want[32];
+    u64 bits = 0, vectors = 0;
+    int have_len = 0, monte = 0;
+    char *v, what[256];
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    msg = malloc(sizeof(line) / 2);
+    if (!msg) {
+        fclose(f);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        if ((v = rsp_value(line, "Len"))) {
+            bits = strtoull(v, NULL, 10);
+            have_len = 1;
+        } else if ((v = rsp_value(line, "Msg")) && have_len) {
+            if (bits % 8 || parse_hex(v, msg, bits / 8) != 0)
+                goto bad;
+        } else if ((v = rsp_value(line, "Seed"))) {
+            if (parse_hex(v, seed_md[2], 32) != 0)
+                goto bad;
+            monte = 1;
+        } else if ((v = rsp_value(line, "MD"))) {
+            if (parse_hex(v, want, 32) != 0)
+                goto bad;
+            if (monte) {
+                u8 m[96];
+                int i;
+
+                /* The chain runs on the C core; the last round, whose
+                 * digest is the checkpoint, goes through every engine */
+                memcpy(seed_md[0], seed_md[2], 32);
+                memcpy(seed_md[1], seed_md[2], 32);
+                for (i = 0; i < 1000; ++i) {
+                    memcpy(m, seed_md[0], 32);
+                    memcpy(m + 32, seed_md[1], 32);
+                    memcpy(m + 64, seed_md[2], 32);
+                    memcpy(seed_md[0], seed_md[1], 32);
+                    memcpy(seed_md[1], seed_md[2], 32);
+                    sha256_digest(m, 96, seed_md[2]);
+                }
+                snprintf(what, sizeof(what), "%s checkpoint %llu", path, (unsigned long long)vectors);
+                check_all(what, m, 96, want);
+            } else {
+                if (!have_len)
+                    goto bad;
+                snprintf(what, sizeof(what), "%s Len = %llu", path, (unsigned long long)bits);
+                check_all(what, msg, bits / 8, want);
+                have_len = 0;
+            }
+            vectors++;
+        }
+    }
+    fclose(f);
+    free(msg);
+    printf("cavp: %s: %llu vectors\n", path, (unsigned long long)vectors);
+    return vectors ? 0 : -1;
+
+bad:
+    fprintf(stderr, "sha256_verify: %s: malformed line: %s", path, line);
+    fclose(f);
+    free(msg);
+    return -1;
+}
+
+/*
+ * 3. Randomized differential test
+ */
+
+// Message length: mostly around the padding boundaries, sometimes large
+static u64 random_length(void) {
+    u64 r = rng_below(100);
+    if (r < 50) return rng_below(300);
+    if (r < 80) return rng_below(8192);
+    if (r < 95) return rng_below(256u << 10);
+    return rng_below(MAX_MSG + 1);
+}
+
+// Cut len bytes into pieces; returns the number of pieces
+static u64 random_split(u64 len, u64 *piece) {
+    static const u64 edges[] = { 0, 1, 55, 56, 63, 64, 65, 119, 120, 127, 128, 4096 };
+    u64 pattern = rng_below(6), n = 0, left = len, p;
+
+    if (pattern == 1 && len > 4096)
+        pattern = 2;
+    while (left > 0 || n == 0) {
+        switch (pattern) {
+        case 0:  p = left; break;                          // one update
+        case 1:  p = 1; break;                             // byte at a time
+        case 2:  p = rng_below(131); break;                // small pieces
+        case 3:  p = 64 * (1 + rng_below(64)); break;      // whole blocks
+        case 4:  p = rng_below(left + 1); break;           // anything
+        default: p = edges[rng_below(sizeof(edges) / sizeof(edges[0]))]; break;
+        }
+        if (len > 65536 && p < 64)
+            p += 4096;                                     // keep big messages quick
+        if (p > left || n == MAX_PIECES - 1) p = left;
+        piece[n++] = p;
+        left -= p;
+        if (left == 0) break;
+    }
+    return n;
+}
+
+static void check_streaming(const u8 *data, u64 len, const u64 *piece, u64 npieces, const u8 want[32]) {
+    char name[96];
+    u8 got[32], state[2][SHA256_STATE_BYTES];
+    u64 at = rng_below(npieces), off = 0, i;
+    struct sha256_ctx c;
+    RustSha256Ctx r;
+    int e, to;
+
+    for (e = 0; e < nengines; ++e) {
+        engine_hash(&engines[e], data, piece, npieces, 0, NULL, got);
+        snprintf(name, sizeof(name), "split update, %s", engines[e].name);
+        expect(name, len, got, want, 32);
+
+        // Export after a random piece, resume in each core
+        for (to = 0; to < 2; ++to) {
+            engine_hash(&engines[e], data, piece, npieces, at, &to, got);
+            snprintf(name, sizeof(name), "export from %s, import into %s", engines[e].name, to ? "rust" : "c");
+            expect(name, len, got, want, 32);
+        }
+    }
+
+    // Both cores serialize the same state to the same bytes
+    sha256_init(&c);
+    rust_sha256_init(&r);
+    for (i = 0; i <= at; ++i) {
+        c_feed(&c, data + off, piece[i], i);
+        rust_feed(&r, data + off, piece[i], i + 1);
+        off += piece[i];
+    }
+    sha256_export(&c, state[0]);
+    rust_sha256_export(&r, state[1]);
+    expect("sha256_export vs rust_sha256_export", off, state[1], state[0], SHA256_STATE_BYTES);
+
+    sha256_digest(data, len, got);
+    expect("sha256_digest", len, got, want, 32);
+    if (len == 32) {
+        sha256_32(data, got);
+        expect("sha256_32", len, got, want, 32);
+    }
+    if (len == 64) {
+        sha256_64(data, got);
+        expect("sha256_64", len, got, want, 32);
+    }
+    if (len <= 65536) {
+        u8 twice[32];
+        ref_sha256(want, 32, NULL, 0, NULL, 0, twice);
+        sha256d(data, len, got);
+        expect("sha256d", len, got, twice, 32);
+    }
+}
+
+/* SHA-224 and truncated SHA-256 on every engine, the one-shots and
+ * every lane kernel; want is the full SHA-256 of data */
+static void check_truncated(const u8 *data, u64 len, const u64 *piece, u64 npieces, const u8 want[32]) {
+    static const enum sha256_mb_backend kernels[] = {
+        SHA256_MB_SERIAL, SHA256_MB_X4, SHA256_MB_X8, SHA256_MB_X16
+    };
+    struct sha256_ctx c;
+    RustSha256Ctx r;
+    struct sha256_ctx_mb mb;
+    const u8 *ptr[SHA256_MB_MAX_LANES];
+    u8 want224[28], got[SHA256_MB_MAX_LANES][33], *out[SHA256_MB_MAX_LANES];
+    u32 step[SHA256_MB_MAX_LANES], outlen = (u32)rng_below(34), nlanes, i;
+    u64 p, off;
+    size_t k;
+    char name[96];
+    int e;
+
+    ref_sha224(data, len, want224);
+    for (e = 0; e < nengines; ++e) {
+        const struct engine *en = &engines[e];
+
+        // SHA-224 in the split pieces
+        engine_select(en);
+        if (en->rust) rust_sha224_init(&r);
+        else          sha224_init(&c);
+        for (p = 0, off = 0; p < npieces; off += piece[p++]) {
+            if (en->rust) rust_feed(&r, data + off, piece[p], p);
+            else          c_feed(&c, data + off, piece[p], p);
+        }
+        if (en->rust) rust_sha224_final(&r, got[0]);
+        else          sha224_final(&c, got[0]);
+        snprintf(name, sizeof(name), "SHA-224, split, %.31s", en->name);
+        expect(name, len, got[0], want224, 28);
+
+        // SHA-256 cut to a random length; nothing past it is written
+        memset(got[0], 0xa5, 33);
+        if (en->rust) {
+            rust_sha256_init_iv(&r, sha256_iv);
+            rust_sha256_update64(&r, data, len);
+            rust_sha256_final_len(&r, got[0], outlen);
+        } else {
+            sha256_init_iv(&c, sha256_iv);
+            sha256_update64(&c, data, len);
+            sha256_final_len(&c, got[0], outlen);
+        }
+        snprintf(name, sizeof(name), "SHA-256 to %u bytes, %.31s", outlen, en->name);
+        expect(name, len, got[0], want, outlen < 32 ? outlen : 32);
+        expect_true("final_len writes no more than outlen bytes", got[0][outlen < 32 ? outlen : 32] == 0xa5);
+    }
+
+    sha224_digest(data, len, got[0]);
+    expect("sha224_digest", len, got[0], want224, 28);
+    sha256_digest_iv(sha224_iv, data, len, got[0], 28);
+    expect("sha256_digest_iv with sha224_iv", len, got[0], want224, 28);
+    sha256_128_digest(data, len, got[0]);
+    expect("sha256_128_digest", len, got[0], want, 16);
+
+    // Every lane hashes the same message as SHA-224, at most 64K of it
+    nlanes = 1 + (u32)rng_below(SHA256_MB_MAX_LANES);
+    if (len > 65536)
+        return;
+    for (k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        if (sha256_mb_use_backend(kernels[k]) != 0)
+            continue;
+        sha256_mb_init_iv(&mb, nlanes, sha224_iv);
+        for (i = 0; i < nlanes; ++i) {
+            ptr[i] = data;
+            step[i] = (u32)len;
+            out[i] = got[i];
+        }
+        sha256_mb_update(&mb, ptr, step);
+        sha256_mb_final_len(&mb, out, 28);
+        for (i = 0; i < nlanes; ++i) {
+            snprintf(name, sizeof(name), "SHA-224 sha256_mb %s lane %u of %u", sha256_mb_backend_name(), i, nlanes);
+            expect(name, len, got[i], want224, 28);
+        }
+    }
+    sha256_mb_use_backend(SHA256_MB_AUTO);
+}
+
+// Lanes over random slices of data, fed in random amounts per round, on every lane kernel
+static void check_mb(const u8 *data, u64 len) {
+    static const enum sha256_mb_backend kernels[] = {
+        SHA256_MB_SERIAL, SHA256_MB_X4, SHA256_MB_X8, SHA256_MB_X16
+    };
+    struct sha256_ctx_mb mb;
+    const u8 *lane[SHA256_MB_MAX_LANES], *ptr[SHA256_MB_MAX_LANES];
+    u64 lane_len[SHA256_MB_MAX_LANES], fed[SHA256_MB_MAX_LANES];
+    u32 step[SHA256_MB_MAX_LANES];
+    u8 got[SHA256_MB_MAX_LANES][32], want[SHA256_MB_MAX_LANES][32];
+    u32 nlanes = 1 + (u32)rng_below(SHA256_MB_MAX_LANES), i;
+    u64 cap = len < 70000 ? len : 70000;
+    size_t k;
+    int busy;
+    char name[64];
+
+    for (i = 0; i < nlanes; ++i) {
+        lane_len[i] = rng_below(cap + 1);
+        lane[i] = data + rng_below(len - lane_len[i] + 1);
+        ref_sha256(lane[i], lane_len[i], NULL, 0, NULL, 0, want[i]);
+    }
+
+    for (k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        if (sha256_mb_use_backend(kernels[k]) != 0)
+            continue;
+        sha256_mb_init(&mb, nlanes);
+        for (i = 0; i < nlanes; ++i)
+            fed[i] = 0;
+        do {
+            busy = 0;
+            for (i = 0; i < nlanes; ++i) {
+                u64 left = lane_len[i] - fed[i];
+                u64 n = rng_below(4) ? rng_below(300) : rng_below(left + 1);
+                step[i] = (u32)(n < left ? n : left);
+                ptr[i] = lane[i] + fed[i];
+                fed[i] += step[i];
+                busy |= fed[i] < lane_len[i];
+            }
+            sha256_mb_update(&mb, ptr, step);
+        } while (busy);
+        sha256_mb_final(&mb, got);
+        for (i = 0; i < nlanes; ++i) {
+            snprintf(name, sizeof(name), "sha256_mb %s lane %u of %u", sha256_mb_backend_name(), i, nlanes);
+            expect(name, lane_len[i], got[i], want[i], 32);
+        }
+    }
+    sha256_mb_use_backend(SHA256_MB_AUTO);
+}
+
+// sha256_tree_hash() and sha256_merkle_* against the reference tree
+static void check_tree(const u8 *data, u64 len) {
+    static const u64 leaf_sizes[] = { 1, 63, 64, 65, 1000, 4096, 65536 };
+    static const u8 leaf_prefix = 0x00;
+    struct sha256_tree_opts opts = { 0 };
+    struct sha256_merkle t;
+    u8 (*ref)[32], (*nodes)[32], want[32], got[32], leaf[32], path[SHA256_MERKLE_MAX_PROOF][32];
+    u64 nleaves, i, idx, off, n;
+    int proof;
+    char name[96];
+
+    do {
+        opts.leaf_size = leaf_sizes[rng_below(sizeof(leaf_sizes) / sizeof(leaf_sizes[0]))];
+    } while (len / opts.leaf_size > 100000);
+    nleaves = len ? (len + opts.leaf_size - 1) / opts.leaf_size : 1;
+    ref = malloc(nleaves * 32);
+    nodes = malloc(sha256_merkle_nodes(nleaves) * 32);
+    if (!ref || !nodes) {
+        fprintf(stderr, "sha256_verify: out of memory\n");
+        exit(1);
+    }
+
+    for (i = 0; i < nleaves; ++i) {
+        off = i * opts.leaf_size;
+        n = len - off < opts.leaf_size ? len - off : opts.leaf_size;
+        if (len == 0) n = 0;
+        ref_sha256(&leaf_prefix, 1, data + off, n, NULL, 0, ref[i]);
+        sha256_merkle_leaf(data + off, n, nodes[i]);
+        expect("sha256_merkle_leaf", n, nodes[i], ref[i], 32);
+    }
+    ref_root(ref, nleaves, want);
+
+    for (i = 0; i < 2; ++i) {
+        opts.engine = i ? SHA256_ENGINE_RUST : SHA256_ENGINE_C;
+        opts.threads = 1 + (u32)rng_below(4);
+        expect_true("sha256_tree_hash returns 0", sha256_tree_hash(data, len, &opts, got) == 0);
+        snprintf(name, sizeof(name), "sha256_tree_hash, %s engine, leaf %llu, %u threads",
+                 i ? "rust" : "c", (unsigned long long)opts.leaf_size, opts.threads);
+        expect(name, len, got, want, 32);
+    }
+
+    expect_true("sha256_merkle_init", sha256_merkle_init(&t, nodes, nleaves) == 0);
+    sha256_merkle_build(&t);
+    expect("sha256_merkle_build root", len, sha256_merkle_root(&t), want, 32);
+
+    // Replace one leaf, then prove it
+    idx = rng_below(nleaves);
+    rng_fill(leaf, 32);
+    expect_true("sha256_merkle_update", sha256_merkle_update(&t, idx, leaf) == 0);
+    for (i = 0; i < nleaves; ++i)
+        memcpy(ref[i], i == idx ? leaf : nodes[i], 32);
+    ref_root(ref, nleaves, want);
+    expect("sha256_merkle_update root", len, sha256_merkle_root(&t), want, 32);
+    proof = sha256_merkle_proof(&t, idx, path);
+    expect_true("sha256_merkle_proof", proof >= 0);
+    expect_true("sha256_merkle_verify accepts a proof",
+                sha256_merkle_verify(leaf, idx, nleaves, (const u8 (*)[32])path, (u32)proof, want) == 1);
+    leaf[rng_below(32)] ^= 1;
+    expect_true("sha256_merkle_verify rejects a wrong leaf",
+                sha256_merkle_verify(leaf, idx, nleaves, (const u8 (*)[32])path, (u32)proof, want) == 0);
+
+    free(ref);
+    free(nodes);
+}
+
+// HMAC on every engine, fed in the same pieces as the plain hash
+static void check_hmac(const u8 *data, u64 len, const u64 *piece, u64 npieces) {
+    u8 key[MAX_KEY], got[32], want[32];
+    u64 klen = rng_below(MAX_KEY + 1), i, off;
+    struct hmac_sha256_key ck;
+    struct hmac_sha256_ctx cc;
+    RustHmacSha256Key rk;
+    RustHmacSha256Ctx rc;
+    char name[96];
+    int e;
+
+    rng_fill(key, klen);
+    ref_hmac(key, klen, data, len, want);
+    hmac_sha256_key_init(&ck, key, klen);
+    rust_hmac_sha256_key_init(&rk, key, klen);
+
+    for (e = 0; e < nengines; ++e) {
+        engine_select(&engines[e]);
+        if (engines[e].rust) rust_hmac_sha256_init(&rc, &rk);
+        else                 hmac_sha256_init(&cc, &ck);
+        for (i = 0, off = 0; i < npieces; off += piece[i++]) {
+            if (engines[e].rust) rust_hmac_sha256_update(&rc, data + off, piece[i]);
+            else                 hmac_sha256_update(&cc, data + off, piece[i]);
+        }
+        if (engines[e].rust) rust_hmac_sha256_final(&rc, got);
+        else                 hmac_sha256_final(&cc, got);
+        snprintf(name, sizeof(name), "HMAC key %llu bytes, split, %.31s", (unsigned long long)klen, engines[e].name);
+        expect(name, len, got, want, 32);
+
+        if (engines[e].rust) rust_hmac_sha256(&rk, data, len, got);
+        else                 hmac_sha256(&ck, data, len, got);
+        snprintf(name, sizeof(name), "HMAC key %llu bytes, one-shot, %.31s", (unsigned long long)klen, engines[e].name);
+        expect(name, len, got, want, 32);
+    }
+}
+
+// PBKDF2 (single and batch) and HKDF; small inputs, few iterations
+static void check_kdf(void) {
+    struct sha256_pbkdf2_job jobs[9];
+    u8 pw[9][MAX_KEY], salt[9][MAX_KEY], out[9][200], want[200];
+    u8 ikm[MAX_KEY], info[MAX_KEY], prk[32], okm[600], okm_want[600];
+    u32 iterations = 1 + (u32)rng_below(64), njobs = 1 + (u32)rng_below(9), j;
+    u64 saltlen, ikmlen, infolen, outlen;
+
+    for (j = 0; j < njobs; ++j) {
+        jobs[j].pw = pw[j];
+        jobs[j].pwlen = rng_below(100);
+        jobs[j].salt = salt[j];
+        jobs[j].saltlen = rng_below(80);
+        jobs[j].out = out[j];
+        jobs[j].outlen = 1 + rng_below(sizeof(out[j]));
+        rng_fill(pw[j], jobs[j].pwlen);
+        rng_fill(salt[j], jobs[j].saltlen);
+    }
+    expect_true("sha256_pbkdf2_batch returns 0", sha256_pbkdf2_batch(jobs, njobs, iterations) == 0);
+    for (j = 0; j < njobs; ++j) {
+        if (!PKCS5_PBKDF2_HMAC((const char *)pw[j], (int)jobs[j].pwlen, salt[j], (int)jobs[j].saltlen,
+                               (int)iterations, EVP_sha256(), (int)jobs[j].outlen, want)) {
+            fprintf(stderr, "sha256_verify: libcrypto PBKDF2 failed\n");
+            exit(1);
+        }
+        expect("sha256_pbkdf2_batch", jobs[j].outlen, out[j], want, jobs[j].outlen);
+        expect_true("sha256_pbkdf2 returns 0",
+                    sha256_pbkdf2(pw[j], jobs[j].pwlen, salt[j], jobs[j].saltlen, iterations,
+                                  out[j], jobs[j].outlen) == 0);
+        expect("sha256_pbkdf2", jobs[j].outlen, out[j], want, jobs[j].outlen);
+    }
+
+    saltlen = rng_below(80);
+    ikmlen = rng_below(MAX_KEY);
+    infolen = rng_below(MAX_KEY);
+    outlen = 1 + rng_below(sizeof(okm));
+    rng_fill(salt[0], saltlen);
+    rng_fill(ikm, ikmlen);
+    rng_fill(info, infolen);
+    ref_hkdf(salt[0], saltlen, ikm, ikmlen, info, infolen, okm_want, outlen);
+    sha256_hkdf_extract(salt[0], saltlen, ikm, ikmlen, prk);
+    expect_true("sha256_hkdf_expand returns 0", sha256_hkdf_expand(prk, info, infolen, okm, outlen) == 0);
+    expect("HKDF", outlen, okm, okm_want, outlen);
+    expect_true("sha256_hkdf_expand rejects 255 * 32 + 1 bytes",
+                sha256_hkdf_expand(prk, info, infolen, okm, 255 * 32 + 1) == -1);
+}
+
+// Both cores' hex formatting and parsing, against printf
+static void check_hex(void) {
+    u8 digests[40][32], back[32];
+    char want[40 * 65], got[40 * 65], upper[65];
+    static const char seps[] = { '\n', ' ', ',' };
+    char sep = seps[rng_below(sizeof(seps))];
+    u64 n = rng_below(41), i, k;
+
+    rng_fill(&digests[0][0], sizeof(digests));
+    for (i = 0; i < n; ++i) {
+        for (k = 0; k < 32; ++k)
+            snprintf(want + i * 65 + 2 * k, 3, "%02x", digests[i][k]);
+        want[i * 65 + 64] = sep;
+    }
+    expect_true("sha256_to_hex_batch length", sha256_to_hex_batch(&digests[0][0], n, sep, got) == n * 65);
+    expect("sha256_to_hex_batch", n, (const u8 *)got, (const u8 *)want, n * 65);
+    expect_true("rust_sha256_to_hex_batch length", rust_sha256_to_hex_batch(&digests[0][0], n, sep, got) == n * 65);
+    expect("rust_sha256_to_hex_batch", n, (const u8 *)got, (const u8 *)want, n * 65);
+
+    for (i = 0; i < n; ++i) {
+        sha256_to_hex(digests[i], got);
+        expect("sha256_to_hex", 32, (const u8 *)got, (const u8 *)want + i * 65, 64);
+        rust_sha256_to_hex(digests[i], got);
+        expect("rust_sha256_to_hex", 32, (const u8 *)got, (const u8 *)want + i * 65, 64);
+
+        for (k = 0; k < 64; ++k)
+            upper[k] = (char)(rng_below(2) && want[i * 65 + k] >= 'a' ? want[i * 65 + k] - 32 : want[i * 65 + k]);
+        expect_true("sha256_from_hex", sha256_from_hex(upper, back) == 0);
+        expect("sha256_from_hex", 32, back, digests[i], 32);
+        expect_true("rust_sha256_from_hex", rust_sha256_from_hex(upper, back) == 0);
+        expect("rust_sha256_from_hex", 32, back, digests[i], 32);
+
+        upper[rng_below(64)] = "g/:@`G "[rng_below(7)];
+        expect_true("sha256_from_hex rejects a non-hex char", sha256_from_hex(upper, back) == -1);
+        expect_true("rust_sha256_from_hex rejects a non-hex char", rust_sha256_from_hex(upper, back) == -1);
+    }
+}
+
+/* Both context pools: random gets and puts through two caches, every
+ * context distinct, aligned and fresh; each hashes data correctly.
+ * A cache may keep up to two batches to itself, so the pool is sized
+ * for POOL_HELD contexts plus both caches' keep */
+#define POOL_HELD  60
+#define POOL_SLOTS (POOL_HELD + 4 * SHA256_POOL_BATCH)
+
+static void check_pool(const u8 *data, u64 len, const u8 want[32]) {
+    static u8 slab[POOL_SLOTS * SHA256_POOL_SLOT] __attribute__((aligned(64)));
+    struct sha256_pool pool;
+    struct sha256_pool_cache cache[2];
+    RustSha256Pool rpool;
+    RustSha256PoolCache rcache[2];
+    void *held[POOL_SLOTS + 1];
+    u8 got[32];
+    u64 hlen = len < 1000 ? len : 1000;
+    u32 nheld = 0, i, k, step, rust;
+    char name[64];
+
+    for (rust = 0; rust < 2; ++rust) {
+        if (rust) {
+            expect_true("rust_sha256_pool_init", rust_sha256_pool_init(&rpool, slab, sizeof(slab)) == 0);
+            rust_sha256_pool_cache_init(&rcache[0], &rpool);
+            rust_sha256_pool_cache_init(&rcache[1], &rpool);
+        } else {
+            expect_true("sha256_pool_init", sha256_pool_init(&pool, slab, sizeof(slab)) == 0);
+            sha256_pool_cache_init(&cache[0], &pool);
+            sha256_pool_cache_init(&cache[1], &pool);
+        }
+        snprintf(name, sizeof(name), "%s context pool", rust ? "rust" : "c");
+
+        for (step = 0; step < 400; ++step) {
+            k = (u32)rng_below(2);
+            if (nheld < POOL_HELD && rng_below(3)) {
+                void *ctx = rust ? (void *)rust_sha256_pool_get(&rcache[k]) : (void *)sha256_pool_get(&cache[k]);
+                expect_true("a pool hands out all its contexts", ctx != NULL);
+                expect_true("pool contexts are 64-byte aligned", ((unsigned long)ctx & 63) == 0);
+                for (i = 0; i < nheld; ++i)
+                    expect_true("pool contexts are distinct", held[i] != ctx);
+                held[nheld++] = ctx;
+                if (rust) {
+                    rust_sha256_update64(ctx, data, hlen);
+                    rust_sha256_final(ctx, got);
+                } else {
+                    sha256_update64(ctx, data, hlen);
+                    sha256_final(ctx, got);
+                }
+                if (hlen == len)
+                    expect(name, len, got, want, 32);
+            } else if (nheld) {
+                i = (u32)rng_below(nheld);
+                if (rust) rust_sha256_pool_put(&rcache[k], held[i]);
+                else      sha256_pool_put(&cache[k], held[i]);
+                held[i] = held[--nheld];
+            }
+        }
+
+        // Empty once everything left in the caches is flushed and taken
+        for (k = 0; k < 2; ++k) {
+            if (rust) rust_sha256_pool_cache_flush(&rcache[k]);
+            else      sha256_pool_cache_flush(&cache[k]);
+        }
+        i = rust ? rust_sha256_pool_get_many(&rcache[0], (RustSha256Ctx **)held + nheld, POOL_SLOTS + 1 - nheld)
+                 : sha256_pool_get_many(&cache[0], (struct sha256_ctx **)held + nheld, POOL_SLOTS + 1 - nheld);
+        expect_true("a pool holds exactly its slots", i == POOL_SLOTS - nheld);
+        if (rust) rust_sha256_pool_reset(&rpool);
+        else      sha256_pool_reset(&pool);
+        i = rust ? rust_sha256_pool_get_many(&rcache[1], (RustSha256Ctx **)held, POOL_SLOTS + 1)
+                 : sha256_pool_get_many(&cache[1], (struct sha256_ctx **)held, POOL_SLOTS + 1);
+        expect_true("a reset pool is full", i == POOL_SLOTS);
+        nheld = 0;
+    }
+}
+
+/* Rolling log hash: digests after random appends, truncation back to
+ * a checkpoint, a sidecar round trip, and sha256_log_file() over a
+ * temporary file in dir that grows and shrinks */
+static void check_log(const char *dir, const u8 *data, u64 len) {
+    struct sha256_log log, back;
+    u8 got[32], want[32], loaded[32];
+    char path[64], sidecar[80];
+    u64 interval = 64 * (1 + rng_below(64)), off = 0, n, cut, total, hashed;
+    FILE *f;
+
+    sha256_log_init(&log, interval);
+    while (off < len) {
+        n = rng_below(4) ? rng_below(3 * interval) : rng_below(len - off + 1);
+        n = n < len - off ? n : len - off;
+        expect_true("sha256_log_append", sha256_log_append(&log, data + off, n) == 0);
+        off += n;
+        if (rng_below(4) == 0) {
+            ref_sha256(data, off, NULL, 0, NULL, 0, want);
+            sha256_log_digest(&log, got);
+            expect("sha256_log_digest after an append", off, got, want, 32);
+        }
+    }
+    ref_sha256(data, len, NULL, 0, NULL, 0, want);
+    sha256_log_digest(&log, got);
+    expect("sha256_log_digest", len, got, want, 32);
+
+    // Back to a random length: rehash from the checkpoint below it
+    cut = rng_below(len + 1);
+    off = sha256_log_truncate(&log, cut);
+    expect_true("sha256_log_truncate stops within an interval", off <= cut && cut - off < interval);
+    sha256_log_append(&log, data + off, cut - off);
+    ref_sha256(data, cut, NULL, 0, NULL, 0, want);
+    sha256_log_digest(&log, got);
+    expect("sha256_log_digest after a truncate", cut, got, want, 32);
+
+    snprintf(path, sizeof(path), "%s/log", dir);
+    snprintf(sidecar, sizeof(sidecar), "%s%s", path, SHA256_LOG_SUFFIX);
+
+    // A saved log loads into the same state, and damage is refused
+    expect_true("sha256_log_save", sha256_log_save(&log, sidecar) == 0);
+    sha256_log_init(&back, interval);
+    expect_true("sha256_log_load of a saved log", sha256_log_load(&back, sidecar) == 0);
+    expect_true("a loaded log has the saved length", back.len == cut && back.nckpt == log.nckpt);
+    sha256_log_digest(&back, loaded);
+    expect("sha256_log_digest of a loaded log", cut, loaded, want, 32);
+    sha256_log_free(&back);
+    sha256_log_init(&back, interval + 64);
+    expect_true("sha256_log_load refuses another interval", sha256_log_load(&back, sidecar) != 0);
+    sha256_log_free(&back);
+    // Flip at least one bit of a random header byte
+    if ((f = fopen(sidecar, "r+b")) != NULL) {
+        long at = (long)rng_below(136);
+        int orig;
+
+        fseek(f, at, SEEK_SET);
+        orig = fgetc(f);
+        fseek(f, at, SEEK_SET);
+        fputc(orig ^ (int)(1 + rng_below(255)), f);
+        fclose(f);
+    }
+    sha256_log_init(&back, interval);
+    expect_true("sha256_log_load refuses a damaged sidecar", sha256_log_load(&back, sidecar) != 0);
+    sha256_log_free(&back);
+    sha256_log_free(&log);
+    unlink(sidecar);
+
+    // The file grows, gets cut back and grows again; each run rereads only the new part
+    off = rng_below(len + 1);
+    if (!(f = fopen(path, "wb")) || fwrite(data, 1, off, f) != off || fclose(f) != 0) {
+        fprintf(stderr, "sha256_verify: %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    expect_true("sha256_log_file, cold", sha256_log_file(path, NULL, interval, got, &total, &hashed) == 0);
+    expect_true("a cold run reads the whole file", total == off && hashed == off);
+    ref_sha256(data, off, NULL, 0, NULL, 0, want);
+    expect("sha256_log_file, cold", off, got, want, 32);
+
+    if ((f = fopen(path, "ab")) != NULL) {
+        fwrite(data + off, 1, len - off, f);
+        fclose(f);
+    }
+    expect_true("sha256_log_file, warm", sha256_log_file(path, NULL, interval, got, &total, &hashed) == 0);
+    expect_true("a warm run reads only the appended bytes", total == len && hashed == len - off);
+    ref_sha256(data, len, NULL, 0, NULL, 0, want);
+    expect("sha256_log_file after an append", len, got, want, 32);
+
+    cut = rng_below(len + 1);
+    expect_true("truncate the log file", truncate(path, (off_t)cut) == 0);
+    expect_true("sha256_log_file, truncated", sha256_log_file(path, NULL, interval, got, &total, &hashed) == 0);
+    expect_true("a truncated run rereads less than an interval", total == cut && hashed < interval);
+    ref_sha256(data, cut, NULL, 0, NULL, 0, want);
+    expect("sha256_log_file after a truncate", cut, got, want, 32);
+
+    unlink(sidecar);
+    unlink(path);
+}
+
+/* Whole-file readers over files in dir: an empty one, one either side
+ * of each sha256_sched_files() size class boundary and a few random
+ * sizes, through sha256_file_fd() (mapped, buffered and io_uring, both
+ * cores), sha256_file_load() and sha256_sched_files() */
+static void check_files(const char *dir) {
+    static const u32 file_flags[] = { 0, SHA256_FILE_NO_MMAP, SHA256_FILE_URING };
+    struct sha256_sched_file files[FILE_COUNT];
+    struct sha256_sched_file_opts sched = { 0 };
+    struct sha256_file_opts opts = { 0 };
+    struct sha256_file_data loaded;
+    char path[FILE_COUNT][64];
+    u64 size[FILE_COUNT], small_max, large_min, got_len;
+    u8 want[FILE_COUNT][32], got[32];
+    u8 *data = malloc(FILE_MAX);
+    u32 n = 0, i, k;
+    FILE *f;
+    int fd;
+
+    if (!data) {
+        fprintf(stderr, "sha256_verify: out of memory\n");
+        exit(1);
+    }
+    rng_fill(data, FILE_MAX);
+
+    // Default small class about half the time; large class always scaled down
+    sched.small_max = rng_below(2) ? 0 : 1 + (u32)rng_below(SHA256_SCHED_DEFAULT_SMALL_MAX);
+    small_max = sched.small_max ? sched.small_max : SHA256_SCHED_DEFAULT_SMALL_MAX;
+    sched.large_min = small_max + 2 + rng_below(FILE_MAX - small_max - 2);
+    large_min = sched.large_min;
+
+    size[n++] = 0;
+    size[n++] = 1;
+    size[n++] = small_max - 1;
+    size[n++] = small_max;
+    size[n++] = small_max + 1;
+    size[n++] = large_min - 1;
+    size[n++] = large_min;
+    size[n++] = large_min + 1;
+    while (n < FILE_COUNT)
+        size[n++] = rng_below(4) ? rng_below(small_max + 1) : rng_below(FILE_MAX + 1);
+
+    for (i = 0; i < n; ++i) {
+        u64 off = rng_below(FILE_MAX - size[i] + 1);
+
+        snprintf(path[i], sizeof(path[i]), "%s/file%02u", dir, i);
+        if (!(f = fopen(path[i], "wb")) || fwrite(data + off, 1, size[i], f) != size[i] || fclose(f) != 0) {
+            fprintf(stderr, "sha256_verify: %s: %s\n", path[i], strerror(errno));
+            exit(1);
+        }
+        ref_sha256(data + off, size[i], NULL, 0, NULL, 0, want[i]);
+
+        for (k = 0; k < 2 * sizeof(file_flags) / sizeof(file_flags[0]); ++k) {
+            opts.engine = k & 1 ? SHA256_ENGINE_RUST : SHA256_ENGINE_C;
+            opts.flags = file_flags[k / 2];
+            got_len = ~0ull;
+            expect_true("sha256_file_path", sha256_file_path(path[i], &opts, got, &got_len) == 0);
+            expect_true("sha256_file_path counts every byte", got_len == size[i]);
+            expect(opts.flags == 0 ? "sha256_file_path, mapped"
+                   : opts.flags == SHA256_FILE_NO_MMAP ? "sha256_file_path, buffered"
+                   : "sha256_file_path, io_uring", size[i], got, want[i], 32);
+        }
+
+        fd = open(path[i], O_RDONLY);
+        expect_true("sha256_file_load", fd >= 0 && sha256_file_load(fd, file_flags[rng_below(2)], &loaded) == 0);
+        close(fd);
+        expect_true("sha256_file_load reads every byte", loaded.len == size[i]);
+        ref_sha256(loaded.data, loaded.len, NULL, 0, NULL, 0, got);
+        expect("sha256_file_load", size[i], got, want[i], 32);
+        sha256_file_release(&loaded);
+    }
+
+    for (k = 0; k < 2; ++k) {
+        memset(files, 0, sizeof(files));
+        for (i = 0; i < n; ++i)
+            files[i].path = path[i];
+        sched.sched.threads = 1 + (u32)rng_below(4);
+        sched.engine = k ? SHA256_ENGINE_RUST : SHA256_ENGINE_C;
+        sched.flags = file_flags[rng_below(3)];
+        expect_true("sha256_sched_files", sha256_sched_files(files, n, &sched) == 0);
+        for (i = 0; i < n; ++i) {
+            expect_true("sha256_sched_files reads every file", files[i].error == 0 && files[i].bytes == size[i]);
+            expect("sha256_sched_files", size[i], files[i].digest, want[i], 32);
+        }
+    }
+
+    for (i = 0; i < n; ++i)
+        unlink(path[i]);
+    free(data);
+}
+
+static void run_random(u64 iterations) {
+    u8 *data = malloc(MAX_MSG), want[32];
+    u64 *piece = malloc(MAX_PIECES * sizeof(u64));
+    u64 len, npieces;
+    char dir[] = "/tmp/sha256_verify.XXXXXX";
+
+    if (!data || !piece) {
+        fprintf(stderr, "sha256_verify: out of memory\n");
+        exit(1);
+    }
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "sha256_verify: mkdtemp: %s\n", strerror(errno));
+        exit(1);
+    }
+    for (iteration = 0; iteration < iterations; ++iteration) {
+        len = random_length();
+        rng_fill(data, len);
+        npieces = random_split(len, piece);
+        ref_sha256(data, len, NULL, 0, NULL, 0, want);
+
+        check_streaming(data, len, piece, npieces, want);
+        check_hmac(data, len, piece, npieces);
+        if (iteration % 2 == 0)
+            check_truncated(data, len, piece, npieces, want);
+        if (len > 0)
+            check_mb(data, len);
+        if (iteration % 4 == 0)
+            check_tree(data, len);
+        if (iteration % 8 == 0 && len <= (1u << 20))
+            check_log(dir, data, len);
+        if (iteration % 16 == 0) {
+            check_kdf();
+            check_hex();
+            check_pool(data, len, want);
+            check_files(dir);
+        }
+    }
+    rmdir(dir);
+    free(data);
+    free(piece);
+}
+
+/*
+ * Throughput gate
+ */
+
+struct perf_row {
+    char engine[32];
+    unsigned long long size;
+    double gbps;
+};
+
+// Rows of a sha256_bench CSV file; *n is set to the count
+static struct perf_row *read_perf(const char *path, int *n) {
+    FILE *f = fopen(path, "r");
+    struct perf_row *rows = NULL, r;
+    char line[256];
+    int cap = 0;
+    unsigned long long iters;
+    double ns, cpb;
+
+    *n = 0;
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%31[^,],%llu,%llu,%lf,%lf,%lf", r.engine, &r.size, &iters, &ns, &cpb, &r.gbps) != 6)
+            continue;   // header
+        if (*n == cap) {
+            struct perf_row *grown = realloc(rows, (size_t)(cap = cap ? 2 * cap : 64) * sizeof(*rows));
+            if (!grown) {
+                free(rows);
+                fclose(f);
+                return NULL;
+            }
+            rows = grown;
+        }
+        rows[(*n)++] = r;
+    }
+    fclose(f);
+    if (*n == 0)
+        fprintf(stderr, "sha256_verify: %s: no sha256_bench CSV rows\n", path);
+    return rows;
+}
+
+static int perf_gate(const char *base_path, const char *cur_path, double threshold, unsigned long long min_size) {
+    struct perf_row *base, *cur;
+    int nbase, ncur, i, j, ok, compared = 0, failed = 0;
+    double ratio;
+
+    base = read_perf(base_path, &nbase);
+    cur = read_perf(cur_path, &ncur);
+    if (!nbase || !ncur) {
+        free(base);
+        free(cur);
+        return 1;
+    }
+
+    printf("engine,size,baseline_gb_per_s,current_gb_per_s,ratio,status\n");
+    for (i = 0; i < ncur; ++i) {
+        if (cur[i].size < min_size || strcmp(cur[i].engine, "openssl") == 0)
+            continue;
+        for (j = 0; j < nbase; ++j)
+            if (base[j].size == cur[i].size && strcmp(base[j].engine, cur[i].engine) == 0)
+                break;
+        if (j == nbase || base[j].gbps <= 0.0)
+            continue;
+        compared++;
+        ratio = cur[i].gbps / base[j].gbps;
+        ok = ratio >= threshold;
+        failed += !ok;
+        printf("%s,%llu,%.3f,%.3f,%.3f,%s\n", cur[i].engine, cur[i].size, base[j].gbps, cur[i].gbps,
+               ratio, ok ? "ok" : "REGRESSION");
+    }
+    free(base);
+    free(cur);
+
+    if (compared == 0) {
+        fprintf(stderr, "sha256_verify: no engine and size in both files\n");
+        return 1;
+    }
+    if (failed) {
+        fprintf(stderr, "sha256_verify: %d of %d throughput figures below %.2f x baseline\n",
+                failed, compared, threshold);
+        return 1;
+    }
+    printf("perf: %d figures at or above %.2f x baseline\n", compared, threshold);
+    return 0;
+}
+
+// "4096", "64K", "4M" -> bytes; 0 on error (same as sha256_bench)
+static unsigned long long parse_size(const char *s) {
+    char *end;
+    unsigned long long v = strtoull(s, &end, 10);
+    switch (*end) {
+    case 'K': case 'k': v <<= 10; end++; break;
+    case 'M': case 'm': v <<= 20; end++; break;
+    case 'G': case 'g': v <<= 30; end++; break;
+    default: break;
+    }
+    return (*end == '\0') ? v : 0;
+}
+
+static void usage(FILE *out) {
+    fprintf(out,
+        "Usage: sha256_verify [options]\n"
+        "       sha256_verify --perf-baseline FILE --perf-current FILE [options]\n"
+        "\n"
+        "  --cavp FILE          also run a NIST CAVP .rsp file (repeatable)\n"
+        "  --seed N             seed of the random test (default: time)\n"
+        "  --iterations N       random messages to test (default 1000)\n"
+        "  --long               include the 1 GiB FIPS 180-4 vector\n"
+        "  --perf-baseline FILE sha256_bench CSV to compare against\n"
+        "  --perf-current FILE  sha256_bench CSV of this build\n"
+        "  --threshold R        lowest allowed current / baseline (default 0.90)\n"
+        "  --min-size SIZE      smallest message size gated (default 64K)\n"
+        "  -h, --help           show this help\n");
+}
+
+int main(int argc, char **argv) {
+    static const struct option longopts[] = {
+        { "cavp",          required_argument, NULL, 'c' },
+        { "seed",          required_argument, NULL, 's' },
+        { "iterations",    required_argument, NULL, 'i' },
+        { "long",          no_argument,       NULL, 'l' },
+        { "perf-baseline", required_argument, NULL, 'b' },
+        { "perf-current",  required_argument, NULL, 'p' },
+        { "threshold",     required_argument, NULL, 't' },
+        { "min-size",      required_argument, NULL, 'm' },
+        { "help",          no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    const char *cavp[32], *base_path = NULL, *cur_path = NULL;
+    int ncavp = 0, with_long = 0, c, e;
+    unsigned long long iterations = 1000, min_size = 64u << 10;
+    double threshold = 0.90;
+
+    seed = (unsigned long long)time(NULL);
+    while ((c = getopt_long(argc, argv, "h", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'c':
+            if (ncavp == (int)(sizeof(cavp) / sizeof(cavp[0]))) {
+                fprintf(stderr, "sha256_verify: too many --cavp files\n");
+                return 2;
+            }
+            cavp[ncavp++] = optarg;
+            break;
+        case 's': seed = strtoull(optarg, NULL, 0); break;
+        case 'i': iterations = strtoull(optarg, NULL, 0); break;
+        case 'l': with_long = 1; break;
+        case 'b': base_path = optarg; break;
+        case 'p': cur_path = optarg; break;
+        case 't': threshold = atof(optarg); break;
+        case 'm':
+            min_size = parse_size(optarg);
+            if (min_size == 0 && strcmp(optarg, "0") != 0) {
+                fprintf(stderr, "sha256_verify: invalid size '%s'\n", optarg);
+                return 2;
+            }
+            break;
+        case 'h': usage(stdout); return 0;
+        default:  usage(stderr); return 2;
+        }
+    }
+    if (optind < argc || (!base_path != !cur_path)) {
+        usage(stderr);
+        return 2;
+    }
+    if (base_path)
+        return perf_gate(base_path, cur_path, threshold, min_size);
+
+    add_engines();
+    printf("engines:");
+    for (e = 0; e < nengines; ++e)
+        printf(" %s", engines[e].name);
+    printf(", mb %s\n", sha256_mb_backend_name());
+
+    check_known(with_long);
+    printf("fips 180-4 examples: ok\n");
+    for (e = 0; e < ncavp; ++e)
+        if (check_cavp(cavp[e]) != 0)
+            return 1;
+
+    rng_state = seed * 0x9E3779B97F4A7C15ull + 1;
+    printf("random: seed %llu, %llu iterations\n", seed, iterations);
+    fflush(stdout);
+    run_random(iterations);
+
+    printf("ok: %llu checks passed\n", checks);
+    return 0;
+}
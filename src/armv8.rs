@@ -0,0 +1,74 @@
+// armv8.rs - SHA-256 compression using the ARMv8 SHA2 crypto
+// extensions (SHA256H / SHA256H2 / SHA256SU0 / SHA256SU1), same
+// algorithm as sha256_armv8.c.
+//
+// no_std has no portable way to ask the OS for CPU features on
+// aarch64, so like the C backend this is chosen at compile time:
+// lib.rs only uses it when the target enables "sha2"
+// (e.g. RUSTFLAGS="-C target-feature=+sha2").
+
+use core::arch::aarch64::*;
+
+use super::K;
+
+// Four rounds: SHA256H updates ABCD, SHA256H2 updates EFGH and needs
+// the ABCD value from before the update
+macro_rules! rnd4 {
+    ($state0:ident, $state1:ident, $m:expr, $i:expr) => {
+        let tmp = vaddq_u32($m, vld1q_u32(K.as_ptr().add($i)));
+        let abcd_prev = $state0;
+        $state0 = vsha256hq_u32($state0, $state1, tmp);
+        $state1 = vsha256h2q_u32($state1, abcd_prev, tmp);
+    };
+}
+
+// Turn W[t-16..t-13] into W[t..t+3]
+macro_rules! sched {
+    ($m0:ident, $m1:ident, $m2:ident, $m3:ident) => {
+        $m0 = vsha256su1q_u32(vsha256su0q_u32($m0, $m1), $m2, $m3);
+    };
+}
+
+// Compress every whole 64-byte block of `blocks` into `state`.
+// Safety: the CPU must support the SHA2 extensions.
+#[target_feature(enable = "sha2")]
+pub unsafe fn compress(state: &mut [u32; 8], blocks: &[u8]) {
+    let mut state0 = vld1q_u32(state.as_ptr());
+    let mut state1 = vld1q_u32(state.as_ptr().add(4));
+
+    for block in blocks.chunks_exact(64) {
+        let abcd = state0;
+        let efgh = state1;
+        let p = block.as_ptr();
+
+        // Load the block as 16 big-endian words
+        let mut m0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p)));
+        let mut m1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p.add(16))));
+        let mut m2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p.add(32))));
+        let mut m3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p.add(48))));
+
+        rnd4!(state0, state1, m0, 0); sched!(m0, m1, m2, m3);
+        rnd4!(state0, state1, m1, 4); sched!(m1, m2, m3, m0);
+        rnd4!(state0, state1, m2, 8); sched!(m2, m3, m0, m1);
+        rnd4!(state0, state1, m3, 12); sched!(m3, m0, m1, m2);
+        rnd4!(state0, state1, m0, 16); sched!(m0, m1, m2, m3);
+        rnd4!(state0, state1, m1, 20); sched!(m1, m2, m3, m0);
+        rnd4!(state0, state1, m2, 24); sched!(m2, m3, m0, m1);
+        rnd4!(state0, state1, m3, 28); sched!(m3, m0, m1, m2);
+        rnd4!(state0, state1, m0, 32); sched!(m0, m1, m2, m3);
+        rnd4!(state0, state1, m1, 36); sched!(m1, m2, m3, m0);
+        rnd4!(state0, state1, m2, 40); sched!(m2, m3, m0, m1);
+        rnd4!(state0, state1, m3, 44); sched!(m3, m0, m1, m2);
+        rnd4!(state0, state1, m0, 48);
+        rnd4!(state0, state1, m1, 52);
+        rnd4!(state0, state1, m2, 56);
+        rnd4!(state0, state1, m3, 60);
+
+        // Add this block's result to the running state
+        state0 = vaddq_u32(state0, abcd);
+        state1 = vaddq_u32(state1, efgh);
+    }
+
+    vst1q_u32(state.as_mut_ptr(), state0);
+    vst1q_u32(state.as_mut_ptr().add(4), state1);
+}
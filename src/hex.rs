@@ -0,0 +1,82 @@
+// hex.rs - SSE2 hex encoding and decoding, same method as the vector
+// path in sha256.c: 16 bytes at a time, nibbles mapped to ASCII
+// arithmetically, every character validated with one test at the end.
+//
+// SSE2 is part of the x86-64 baseline, so lib.rs uses this whenever
+// the target has it, with no runtime check; other targets keep the
+// table versions in lib.rs.
+
+#[cfg(target_arch = "x86")]
+use core::arch::x86::*;
+#[cfg(target_arch = "x86_64")]
+use core::arch::x86_64::*;
+
+// Nibbles 0..15 to '0'..'9', 'a'..'f'
+#[inline(always)]
+unsafe fn ascii(n: __m128i) -> __m128i {
+    let letters = _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8(39));
+    _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8(b'0' as i8)), letters)
+}
+
+// 64 hex chars of one digest
+#[inline(always)]
+pub fn encode(hash: &[u8; 32], out: &mut [u8; 64]) {
+    unsafe {
+        let mask = _mm_set1_epi8(0x0f);
+        for k in 0..2 {
+            let v = _mm_loadu_si128(hash.as_ptr().add(16 * k) as *const __m128i);
+            let hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+            let lo = _mm_and_si128(v, mask);
+            let dst = out.as_mut_ptr().add(32 * k) as *mut __m128i;
+
+            _mm_storeu_si128(dst, ascii(_mm_unpacklo_epi8(hi, lo)));
+            _mm_storeu_si128(dst.add(1), ascii(_mm_unpackhi_epi8(hi, lo)));
+        }
+    }
+}
+
+// 16 hex chars to nibbles; lanes that are hex are set in *ok
+#[inline(always)]
+unsafe fn nibbles(p: *const u8, ok: &mut __m128i) -> __m128i {
+    let c = _mm_loadu_si128(p as *const __m128i);
+    let digit = _mm_sub_epi8(c, _mm_set1_epi8(b'0' as i8));
+    let alpha = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8(b'a' as i8));
+    // Unsigned x <= m as min(x, m) == x; SSE2 has no unsigned compare
+    let is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    let is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+
+    *ok = _mm_and_si128(*ok, _mm_or_si128(is_digit, is_alpha));
+    _mm_or_si128(
+        _mm_and_si128(digit, is_digit),
+        _mm_and_si128(_mm_add_epi8(alpha, _mm_set1_epi8(10)), is_alpha),
+    )
+}
+
+// Pairs of nibbles (high byte first) to bytes, one per 16-bit lane
+#[inline(always)]
+unsafe fn join(n: __m128i) -> __m128i {
+    let b = _mm_or_si128(_mm_slli_epi16(n, 4), _mm_srli_epi16(n, 8));
+    _mm_and_si128(b, _mm_set1_epi16(0xff))
+}
+
+// 64 hex chars, either case, to a digest; false if any is not hex
+#[inline(always)]
+pub fn decode(hex: &[u8; 64], out: &mut [u8; 32]) -> bool {
+    unsafe {
+        let mut ok = _mm_set1_epi8(-1);
+        let mut bytes = [_mm_setzero_si128(); 2];
+
+        for (k, b) in bytes.iter_mut().enumerate() {
+            let p = hex.as_ptr().add(32 * k);
+            let lo = join(nibbles(p, &mut ok));
+            let hi = join(nibbles(p.add(16), &mut ok));
+            *b = _mm_packus_epi16(lo, hi);
+        }
+        if _mm_movemask_epi8(ok) != 0xffff {
+            return false;
+        }
+        _mm_storeu_si128(out.as_mut_ptr() as *mut __m128i, bytes[0]);
+        _mm_storeu_si128(out.as_mut_ptr().add(16) as *mut __m128i, bytes[1]);
+    }
+    true
+}
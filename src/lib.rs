@@ -2,40 +2,73 @@
 
 #![no_std]
 
+use core::sync::atomic::{AtomicU8, Ordering};
+
+#[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+mod shani;
+#[cfg(target_arch = "aarch64")]
+mod armv8;
+#[cfg(all(any(target_arch = "x86", target_arch = "x86_64"), target_feature = "sse2"))]
+mod hex;
+#[cfg(feature = "stats")]
+mod stats;
+pub mod pool;
+
+// Hot-path counters (stats.rs); without the "stats" feature these
+// expand to nothing and their arguments are never evaluated
+macro_rules! stats_add {
+    ($field:ident, $n:expr) => {
+        #[cfg(feature = "stats")]
+        stats::add(&stats::local().$field, $n as u64);
+    };
+}
+macro_rules! stats_start {
+    ($t:ident) => {
+        #[cfg(feature = "stats")]
+        let $t = stats::clock();
+    };
+}
+macro_rules! stats_stop {
+    ($field:ident, $t:ident) => {
+        #[cfg(feature = "stats")]
+        stats::add(&stats::local().$field, stats::clock().wrapping_sub($t));
+    };
+}
+
 // Rotate right operation
 #[inline]
-fn rotr(x: u32, n: u32) -> u32 {
+const fn rotr(x: u32, n: u32) -> u32 {
     (x >> n) | (x << (32 - n))
 }
 
 // SHA-256 logical functions
 #[inline]
-fn ch(x: u32, y: u32, z: u32) -> u32 {
+const fn ch(x: u32, y: u32, z: u32) -> u32 {
     (x & y) ^ (!x & z)
 }
 
 #[inline]
-fn maj(x: u32, y: u32, z: u32) -> u32 {
+const fn maj(x: u32, y: u32, z: u32) -> u32 {
     (x & y) ^ (x & z) ^ (y & z)
 }
 
 #[inline]
-fn bsig0(x: u32) -> u32 {
+const fn bsig0(x: u32) -> u32 {
     rotr(x, 2) ^ rotr(x, 13) ^ rotr(x, 22)
 }
 
 #[inline]
-fn bsig1(x: u32) -> u32 {
+const fn bsig1(x: u32) -> u32 {
     rotr(x, 6) ^ rotr(x, 11) ^ rotr(x, 25)
 }
 
 #[inline]
-fn ssig0(x: u32) -> u32 {
+const fn ssig0(x: u32) -> u32 {
     rotr(x, 7) ^ rotr(x, 18) ^ (x >> 3)
 }
 
 #[inline]
-fn ssig1(x: u32) -> u32 {
+const fn ssig1(x: u32) -> u32 {
     rotr(x, 17) ^ rotr(x, 19) ^ (x >> 10)
 }
 
@@ -59,7 +92,256 @@ const K: [u32; 64] = [
     0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
 ];
 
+// Compression backends; values match enum sha256_backend in sha256.h
+const BACKEND_AUTO: u8 = 0;
+const BACKEND_SCALAR: u8 = 1;
+const BACKEND_SHANI: u8 = 2;
+const BACKEND_ARMV8: u8 = 3;
+
+// Picked on first use. A plain atomic instead of a function pointer:
+// no_std has no lazy statics, and a relaxed byte load per call costs
+// nothing next to a compression.
+static BACKEND: AtomicU8 = AtomicU8::new(BACKEND_AUTO);
+
+// One round; the caller rotates the names for the next round
+macro_rules! round {
+    ($a:ident, $b:ident, $c:ident, $d:ident, $e:ident, $f:ident, $g:ident, $h:ident, $k:expr, $w:expr) => {
+        let t1 = $h
+            .wrapping_add(bsig1($e))
+            .wrapping_add(ch($e, $f, $g))
+            .wrapping_add($k)
+            .wrapping_add($w);
+        let t2 = bsig0($a).wrapping_add(maj($a, $b, $c));
+        $d = $d.wrapping_add(t1);
+        $h = t1.wrapping_add(t2);
+    };
+}
+
+// Next message word for round i >= 16, kept in a rolling 16-word
+// window: w[i & 15] still holds W[i - 16] when it is overwritten
+#[inline(always)]
+const fn sched(w: &mut [u32; 16], i: usize) -> u32 {
+    let v = ssig1(w[(i + 14) & 15])
+        .wrapping_add(w[(i + 9) & 15])
+        .wrapping_add(ssig0(w[(i + 1) & 15]))
+        .wrapping_add(w[i & 15]);
+    w[i & 15] = v;
+    v
+}
+
+// Portable backend: one 64-byte block. Same shape as the C core's
+// unrolled loop: eight rounds per pass with the variables renamed
+// instead of shifted, and the schedule computed one word per round.
+// Fixed-size arrays, constant loop bounds and masked indices let the
+// compiler prove every access in range, so there are no bounds
+// checks, and nothing is left for the auto-vectorizer to pack into
+// vector registers (with AVX-512 it otherwise does, and runs slower).
+// A const fn (hence the while loops), so sha256_const() evaluates the
+// very same rounds at compile time.
+#[inline(always)]
+const fn compress_block(state: &mut [u32; 8], block: &[u8; 64]) {
+    let mut w = [0u32; 16];
+
+    // Load the block as 16 big-endian words
+    let mut i = 0;
+    while i < 16 {
+        w[i] = u32::from_be_bytes([block[i * 4], block[i * 4 + 1], block[i * 4 + 2], block[i * 4 + 3]]);
+        i += 1;
+    }
+
+    // Initialize working variables
+    let [mut a, mut b, mut c, mut d, mut e, mut f, mut g, mut h] = *state;
+
+    // Rounds 0-15 use the block words as they are
+    let mut r = 0;
+    while r < 2 {
+        let i = r * 8;
+        round!(a, b, c, d, e, f, g, h, K[i], w[i]);
+        round!(h, a, b, c, d, e, f, g, K[i + 1], w[i + 1]);
+        round!(g, h, a, b, c, d, e, f, K[i + 2], w[i + 2]);
+        round!(f, g, h, a, b, c, d, e, K[i + 3], w[i + 3]);
+        round!(e, f, g, h, a, b, c, d, K[i + 4], w[i + 4]);
+        round!(d, e, f, g, h, a, b, c, K[i + 5], w[i + 5]);
+        round!(c, d, e, f, g, h, a, b, K[i + 6], w[i + 6]);
+        round!(b, c, d, e, f, g, h, a, K[i + 7], w[i + 7]);
+        r += 1;
+    }
+
+    // Rounds 16-63 extend the schedule as they go
+    while r < 8 {
+        let i = r * 8;
+        round!(a, b, c, d, e, f, g, h, K[i], sched(&mut w, i));
+        round!(h, a, b, c, d, e, f, g, K[i + 1], sched(&mut w, i + 1));
+        round!(g, h, a, b, c, d, e, f, K[i + 2], sched(&mut w, i + 2));
+        round!(f, g, h, a, b, c, d, e, K[i + 3], sched(&mut w, i + 3));
+        round!(e, f, g, h, a, b, c, d, K[i + 4], sched(&mut w, i + 4));
+        round!(d, e, f, g, h, a, b, c, K[i + 5], sched(&mut w, i + 5));
+        round!(c, d, e, f, g, h, a, b, K[i + 6], sched(&mut w, i + 6));
+        round!(b, c, d, e, f, g, h, a, K[i + 7], sched(&mut w, i + 7));
+        r += 1;
+    }
+
+    // Add to state
+    let out = [a, b, c, d, e, f, g, h];
+    let mut i = 0;
+    while i < 8 {
+        state[i] = state[i].wrapping_add(out[i]);
+        i += 1;
+    }
+}
+
+// Portable backend over a run of blocks; keeps the running state in
+// locals between blocks. A trailing partial block is ignored.
+fn compress_scalar(hash: &mut [u32; 8], blocks: &[u8]) {
+    let mut state = *hash;
+
+    for block in blocks.chunks_exact(64) {
+        // chunks_exact only yields 64-byte slices, so this never fails
+        if let Ok(block) = <&[u8; 64]>::try_from(block) {
+            compress_block(&mut state, block);
+        }
+    }
+
+    *hash = state;
+}
+
+// SHA-256 of data, evaluated at compile time when used in a const
+// context, e.g. to embed the digest of a table or config blob:
+//
+//   const TABLE_DIGEST: [u8; 32] = sha256_const(include_bytes!("table.bin"));
+//
+// Same padding as finalize() and the same rounds as the scalar
+// backend; at run time it is only as fast as the scalar backend.
+pub const fn sha256_const(data: &[u8]) -> [u8; 32] {
+    digest_const::<32>(&H0, data)
+}
+
+// SHA-224 of data, the same way
+pub const fn sha224_const(data: &[u8]) -> [u8; 28] {
+    digest_const::<28>(&SHA224_H0, data)
+}
+
+// The first N bytes (N at most 32) of the hash of data from iv
+const fn digest_const<const N: usize>(iv: &[u32; 8], data: &[u8]) -> [u8; N] {
+    let mut state = *iv;
+    let mut block = [0u8; 64];
+    let mut off = 0;
+    let mut i;
+
+    // Whole blocks
+    while off + 64 <= data.len() {
+        i = 0;
+        while i < 64 {
+            block[i] = data[off + i];
+            i += 1;
+        }
+        compress_block(&mut state, &block);
+        off += 64;
+    }
+
+    // Tail, 0x80, zeros, and the length in the last 8 bytes; one more
+    // block if the length doesn't fit
+    let n = data.len() - off;
+    block = [0u8; 64];
+    i = 0;
+    while i < n {
+        block[i] = data[off + i];
+        i += 1;
+    }
+    block[n] = 0x80;
+    if n >= 56 {
+        compress_block(&mut state, &block);
+        block = [0u8; 64];
+    }
+    let bits = (data.len() as u64).wrapping_mul(8).to_be_bytes();
+    i = 0;
+    while i < 8 {
+        block[56 + i] = bits[i];
+        i += 1;
+    }
+    compress_block(&mut state, &block);
+
+    let mut out = [0u8; N];
+    i = 0;
+    while i < N && i < 32 {
+        out[i] = (state[i / 4] >> (24 - 8 * (i % 4))) as u8;
+        i += 1;
+    }
+    out
+}
+
+// Checked by the compiler on every build: FIPS 180-4 "abc" and the
+// two-block 56-byte example
+const _: () = {
+    let abc = sha256_const(b"abc");
+    assert!(abc[0] == 0xba && abc[1] == 0x78 && abc[30] == 0x15 && abc[31] == 0xad);
+    let two = sha256_const(b"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq");
+    assert!(two[0] == 0x24 && two[1] == 0x8d && two[30] == 0x06 && two[31] == 0xc1);
+    let abc224 = sha224_const(b"abc");
+    assert!(abc224[0] == 0x23 && abc224[1] == 0x09 && abc224[26] == 0x9d && abc224[27] == 0xa7);
+};
+
+// Best backend for this CPU. x86 asks CPUID at run time; aarch64 has
+// no portable no_std detection, so it goes by the compile-time target.
+fn detect_backend() -> u8 {
+    #[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+    {
+        if shani::available() {
+            return BACKEND_SHANI;
+        }
+    }
+    #[cfg(all(target_arch = "aarch64", target_feature = "sha2"))]
+    {
+        return BACKEND_ARMV8;
+    }
+    #[allow(unreachable_code)]
+    BACKEND_SCALAR
+}
+
+// Whether this build and CPU can run a backend
+fn backend_supported(backend: u8) -> bool {
+    match backend {
+        BACKEND_SCALAR => true,
+        #[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+        BACKEND_SHANI => shani::available(),
+        #[cfg(all(target_arch = "aarch64", target_feature = "sha2"))]
+        BACKEND_ARMV8 => true,
+        _ => false,
+    }
+}
+
+fn active_backend() -> u8 {
+    let mut b = BACKEND.load(Ordering::Relaxed);
+    if b == BACKEND_AUTO {
+        b = detect_backend();
+        BACKEND.store(b, Ordering::Relaxed);
+    }
+    b
+}
+
+// Compress every whole 64-byte block of `blocks` into `h`
+fn compress(h: &mut [u32; 8], blocks: &[u8]) {
+    stats_start!(t0);
+    match active_backend() {
+        // Safety: only selected after backend_supported() / detect_backend()
+        #[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+        BACKEND_SHANI => unsafe { shani::compress(h, blocks) },
+        #[cfg(all(target_arch = "aarch64", target_feature = "sha2"))]
+        BACKEND_ARMV8 => unsafe { armv8::compress(h, blocks) },
+        _ => compress_scalar(h, blocks),
+    }
+    stats_add!(compress_calls, 1);
+    stats_add!(blocks, blocks.len() / 64);
+    stats_stop!(compress_cycles, t0);
+}
+
+// Serialized midstate: same layout as sha256_export() in sha256.c
+pub const STATE_BYTES: usize = 112;
+pub const STATE_VERSION: u8 = 1;
+const STATE_MAGIC: &[u8; 4] = b"S256";
+
 #[repr(C)]
+#[derive(Clone, Copy)]
 pub struct Sha256Ctx {
     h: [u32; 8],
     buffer: [u8; 64],
@@ -67,196 +349,529 @@ pub struct Sha256Ctx {
     bitlen: u64,
 }
 
+// Layout shared with struct sha256_ctx / RustSha256Ctx in C
+// (checked the same way in sha256_api.c)
+const _: () = {
+    assert!(core::mem::size_of::<Sha256Ctx>() == 112);
+    assert!(core::mem::offset_of!(Sha256Ctx, h) == 0);
+    assert!(core::mem::offset_of!(Sha256Ctx, buffer) == 32);
+    assert!(core::mem::offset_of!(Sha256Ctx, buflen) == 96);
+    assert!(core::mem::offset_of!(Sha256Ctx, bitlen) == 104);
+};
+
+// Initial hash values (FIPS 180-4, 5.3.3)
+const H0: [u32; 8] = [
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+];
+
+// SHA-224's (FIPS 180-4, 5.3.2), for reset_iv() and sha224_const()
+pub const SHA224_H0: [u32; 8] = [
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+    0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4,
+];
+
 impl Sha256Ctx {
-    fn transform(&mut self, block: &[u8]) {
-        let mut w = [0u32; 64];
-        
-        // Prepare message schedule
-        for i in 0..16 {
-            let j = i * 4;
-            w[i] = ((block[j] as u32) << 24)
-                | ((block[j + 1] as u32) << 16)
-                | ((block[j + 2] as u32) << 8)
-                | (block[j + 3] as u32);
+    fn new() -> Sha256Ctx {
+        Sha256Ctx { h: H0, buffer: [0; 64], buflen: 0, bitlen: 0 }
+    }
+
+    // Start a new message (rust_sha256_init); the buffer is left as is
+    pub fn reset(&mut self) {
+        self.reset_iv(&H0);
+    }
+
+    // Same, from any initial hash value (SHA224_H0 for SHA-224)
+    pub fn reset_iv(&mut self, iv: &[u32; 8]) {
+        self.h = *iv;
+        self.buflen = 0;
+        self.bitlen = 0;
+    }
+
+    fn transform(&mut self, block: &[u8; 64]) {
+        compress(&mut self.h, block);
+    }
+
+    // Compress every whole 64-byte block in `blocks` with the active backend
+    fn transform_blocks(&mut self, blocks: &[u8]) {
+        compress(&mut self.h, blocks);
+    }
+
+    // Pad, compress the last block(s) and write the digest
+    pub fn finalize(&mut self, out: &mut [u8; 32]) {
+        self.pad_last();
+        for i in 0..8 {
+            out[i * 4..i * 4 + 4].copy_from_slice(&self.h[i].to_be_bytes());
+        }
+    }
+
+    // Same, writing the first out.len() bytes of it (at most 32): 28
+    // for SHA-224, 16 for SHA-256/128
+    pub fn finalize_len(&mut self, out: &mut [u8]) {
+        self.pad_last();
+        for (i, b) in (0..32usize).zip(out.iter_mut()) {
+            *b = (self.h[(i / 4) & 7] >> (24 - 8 * (i % 4))) as u8;
+        }
+    }
+
+    // Padding and the last block(s); the digest is then in h
+    fn pad_last(&mut self) {
+        // buflen is always below 64; the mask lets the compiler see it
+        let n = self.buflen as usize & 63;
+        let mut block = self.buffer;
+        stats_start!(t0);
+        stats_add!(final_calls, 1);
+        stats_add!(final_blocks, if n >= 56 { 2 } else { 1 });
+
+        // Append 0x80, then zeros
+        block[n] = 0x80;
+        block[n + 1..].fill(0);
+
+        // No room for the length: it goes in one more block
+        if n >= 56 {
+            self.transform(&block);
+            block = [0; 64];
+        }
+
+        // Append length and do the final transform
+        block[56..].copy_from_slice(&self.bitlen.to_be_bytes());
+        self.transform(&block);
+        stats_stop!(final_cycles, t0);
+    }
+
+    // Midstate as bytes: magic, version, buflen, 2 reserved, bitlen,
+    // h[0..7] (all big-endian), then the partial block zero-padded
+    fn export(&self, out: &mut [u8; STATE_BYTES]) {
+        let n = self.buflen as usize & 63;
+
+        out[0..4].copy_from_slice(STATE_MAGIC);
+        out[4] = STATE_VERSION;
+        out[5] = self.buflen as u8;
+        out[6] = 0;
+        out[7] = 0;
+        out[8..16].copy_from_slice(&self.bitlen.to_be_bytes());
+        for i in 0..8 {
+            out[16 + i * 4..20 + i * 4].copy_from_slice(&self.h[i].to_be_bytes());
         }
-        
-        for i in 16..64 {
-            w[i] = ssig1(w[i - 2])
-                .wrapping_add(w[i - 7])
-                .wrapping_add(ssig0(w[i - 15]))
-                .wrapping_add(w[i - 16]);
+        out[48..48 + n].copy_from_slice(&self.buffer[..n]);
+        for b in out[48 + n..].iter_mut() {
+            *b = 0;
         }
-        
-        // Initialize working variables
-        let mut a = self.h[0];
-        let mut b = self.h[1];
-        let mut c = self.h[2];
-        let mut d = self.h[3];
-        let mut e = self.h[4];
-        let mut f = self.h[5];
-        let mut g = self.h[6];
-        let mut h = self.h[7];
-        
-        // Main compression loop
-        for i in 0..64 {
-            let t1 = h
-                .wrapping_add(bsig1(e))
-                .wrapping_add(ch(e, f, g))
-                .wrapping_add(K[i])
-                .wrapping_add(w[i]);
-            let t2 = bsig0(a).wrapping_add(maj(a, b, c));
-            
-            h = g;
-            g = f;
-            f = e;
-            e = d.wrapping_add(t1);
-            d = c;
-            c = b;
-            b = a;
-            a = t1.wrapping_add(t2);
+    }
+
+    // Inverse of export; false (self untouched) if the bytes are not
+    // a valid midstate
+    fn import(&mut self, src: &[u8; STATE_BYTES]) -> bool {
+        if &src[0..4] != STATE_MAGIC || src[4] != STATE_VERSION || src[6] != 0 || src[7] != 0 {
+            return false;
+        }
+
+        let n = src[5] as usize;
+        let mut bits = [0u8; 8];
+        bits.copy_from_slice(&src[8..16]);
+        let bitlen = u64::from_be_bytes(bits);
+
+        // Whole bytes only, and the buffered count must agree with the length
+        if n > 63 || bitlen & 7 != 0 || ((bitlen >> 3) & 63) as usize != n {
+            return false;
+        }
+
+        for i in 0..8 {
+            let j = 16 + i * 4;
+            self.h[i] = u32::from_be_bytes([src[j], src[j + 1], src[j + 2], src[j + 3]]);
+        }
+        self.buffer[..n].copy_from_slice(&src[48..48 + n]);
+        self.buflen = n as u32;
+        self.bitlen = bitlen;
+        true
+    }
+
+    // Buffer input and compress whole blocks; any length
+    pub fn update(&mut self, mut data: &[u8]) {
+        stats_start!(t0);
+        stats_add!(update_calls, 1);
+        stats_add!(update_bytes, data.len());
+        self.bitlen = self.bitlen.wrapping_add((data.len() as u64).wrapping_mul(8));
+
+        // Fill buffer if partially full
+        let start = self.buflen as usize & 63;
+        if start > 0 {
+            let need = 64 - start;
+            if data.len() < need {
+                self.buffer[start..start + data.len()].copy_from_slice(data);
+                self.buflen += data.len() as u32;
+                stats_add!(buffer_fills, 1);
+                stats_add!(buffer_bytes, data.len());
+                stats_stop!(update_cycles, t0);
+                return;
+            }
+            let (head, rest) = data.split_at(need);
+            self.buffer[start..].copy_from_slice(head);
+            stats_add!(buffer_fills, 1);
+            stats_add!(buffer_bytes, need);
+            let block = self.buffer;
+            self.transform(&block);
+            data = rest;
+        }
+
+        // Process full blocks in one run, straight from the input
+        let (whole, rem) = data.split_at(data.len() & !63);
+        if !whole.is_empty() {
+            self.transform_blocks(whole);
+        }
+
+        // Copy remainder to buffer
+        self.buffer[..rem.len()].copy_from_slice(rem);
+        self.buflen = rem.len() as u32;
+        if !rem.is_empty() {
+            stats_add!(buffer_fills, 1);
+            stats_add!(buffer_bytes, rem.len());
+        }
+        stats_stop!(update_cycles, t0);
+    }
+}
+
+// HMAC-SHA256 key: midstates after the key ^ ipad and key ^ opad
+// blocks, computed once and shared by every message (RFC 2104)
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct HmacSha256Key {
+    inner_h: [u32; 8],
+    outer_h: [u32; 8],
+}
+
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct HmacSha256Ctx {
+    inner: Sha256Ctx,
+    outer_h: [u32; 8],
+}
+
+// Zero key material with stores the optimizer cannot drop as dead,
+// like wipe_bytes() in the C core
+fn wipe<T: Copy + Default>(buf: &mut [T]) {
+    for b in buf.iter_mut() {
+        unsafe { core::ptr::write_volatile(b, T::default()) };
+    }
+    core::sync::atomic::compiler_fence(Ordering::SeqCst);
+}
+
+impl HmacSha256Key {
+    fn new(key: &[u8]) -> HmacSha256Key {
+        let mut pad = [0u8; 64];
+
+        // Long keys are replaced by their digest, short ones zero-padded
+        if key.len() > 64 {
+            let mut kctx = Sha256Ctx::new();
+            let mut digest = [0u8; 32];
+            kctx.update(key);
+            kctx.finalize(&mut digest);
+            pad[..32].copy_from_slice(&digest);
+            wipe(&mut digest);
+            wipe(&mut kctx.h); // the digest of the key is the effective key
+            wipe(&mut kctx.buffer);
+        } else {
+            pad[..key.len()].copy_from_slice(key);
+        }
+
+        let mut inner = Sha256Ctx::new();
+        let mut outer = Sha256Ctx::new();
+        for b in pad.iter_mut() {
+            *b ^= 0x36;
+        }
+        inner.transform(&pad);
+        for b in pad.iter_mut() {
+            *b ^= 0x36 ^ 0x5c;
+        }
+        outer.transform(&pad);
+        wipe(&mut pad);
+
+        HmacSha256Key { inner_h: inner.h, outer_h: outer.h }
+    }
+}
+
+impl HmacSha256Ctx {
+    fn new(key: &HmacSha256Key) -> HmacSha256Ctx {
+        let mut inner = Sha256Ctx::new();
+        inner.h = key.inner_h;
+        inner.bitlen = 512; // the ipad block is already in
+        HmacSha256Ctx { inner, outer_h: key.outer_h }
+    }
+
+    fn update(&mut self, data: &[u8]) {
+        self.inner.update(data);
+    }
+
+    // Outer hash is opad block || inner digest: one more block, 768 bits
+    fn finalize(&mut self, out: &mut [u8; 32]) {
+        let mut digest = [0u8; 32];
+        self.inner.finalize(&mut digest);
+
+        let mut outer = Sha256Ctx::new();
+        outer.h = self.outer_h;
+        let mut block = [0u8; 64];
+        block[..32].copy_from_slice(&digest);
+        block[32] = 0x80;
+        block[60..64].copy_from_slice(&768u32.to_be_bytes());
+        outer.transform(&block);
+
+        for i in 0..8 {
+            out[i * 4..i * 4 + 4].copy_from_slice(&outer.h[i].to_be_bytes());
         }
-        
-        // Add to state
-        self.h[0] = self.h[0].wrapping_add(a);
-        self.h[1] = self.h[1].wrapping_add(b);
-        self.h[2] = self.h[2].wrapping_add(c);
-        self.h[3] = self.h[3].wrapping_add(d);
-        self.h[4] = self.h[4].wrapping_add(e);
-        self.h[5] = self.h[5].wrapping_add(f);
-        self.h[6] = self.h[6].wrapping_add(g);
-        self.h[7] = self.h[7].wrapping_add(h);
     }
 }
 
 #[no_mangle]
 pub extern "C" fn rust_sha256_init(ctx: *mut Sha256Ctx) {
-    unsafe {
-        (*ctx).h = [
-            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
-            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
-        ];
-        (*ctx).buflen = 0;
-        (*ctx).bitlen = 0;
-    }
+    unsafe { (*ctx).reset() };
 }
 
 #[no_mangle]
 pub extern "C" fn rust_sha256_update(ctx: *mut Sha256Ctx, data: *const u8, len: u32) {
+    rust_sha256_update64(ctx, data, len as u64);
+}
+
+// Same as rust_sha256_update, for inputs larger than 4 GiB
+#[no_mangle]
+pub extern "C" fn rust_sha256_update64(ctx: *mut Sha256Ctx, data: *const u8, len: u64) {
+    if len == 0 {
+        return;
+    }
     unsafe {
         let ctx_ref = &mut *ctx;
         let data_slice = core::slice::from_raw_parts(data, len as usize);
-        
-        ctx_ref.bitlen += (len as u64) * 8;
-        
-        let mut i = 0;
-        
-        // Fill buffer if partially full
-        if ctx_ref.buflen > 0 {
-            let need = 64 - ctx_ref.buflen;
-            if len < need {
-                for j in 0..len {
-                    ctx_ref.buffer[(ctx_ref.buflen + j) as usize] = data_slice[j as usize];
-                }
-                ctx_ref.buflen += len;
-                return;
-            } else {
-                for j in 0..need {
-                    ctx_ref.buffer[(ctx_ref.buflen + j) as usize] = data_slice[j as usize];
-                }
-                let mut temp_buffer = [0u8; 64];
-                temp_buffer.copy_from_slice(&ctx_ref.buffer);
-                ctx_ref.transform(&temp_buffer);
-                ctx_ref.buflen = 0;
-                i += need;
-            }
-        }
-        
-        // Process full blocks
-        while i + 64 <= len {
-            ctx_ref.transform(&data_slice[i as usize..(i + 64) as usize]);
-            i += 64;
-        }
-        
-        // Copy remainder to buffer
-        if i < len {
-            let rem = len - i;
-            for j in 0..rem {
-                ctx_ref.buffer[j as usize] = data_slice[(i + j) as usize];
-            }
-            ctx_ref.buflen = rem;
-        }
+        ctx_ref.update(data_slice);
     }
 }
 
 #[no_mangle]
 pub extern "C" fn rust_sha256_final(ctx: *mut Sha256Ctx, out_hash32: *mut u8) {
     unsafe {
-        let ctx_ref = &mut *ctx;
-        let bits = ctx_ref.bitlen;
-        
-        // Append 0x80
-        ctx_ref.buffer[ctx_ref.buflen as usize] = 0x80;
-        ctx_ref.buflen += 1;
-        
-        // Handle case where padding doesn't fit
-        if ctx_ref.buflen > 56 {
-            while ctx_ref.buflen < 64 {
-                ctx_ref.buffer[ctx_ref.buflen as usize] = 0;
-                ctx_ref.buflen += 1;
-            }
-            let mut temp_buffer = [0u8; 64];
-            temp_buffer.copy_from_slice(&ctx_ref.buffer);
-            ctx_ref.transform(&temp_buffer);
-            ctx_ref.buflen = 0;
-        }
-        
-        // Pad with zeros
-        while ctx_ref.buflen < 56 {
-            ctx_ref.buffer[ctx_ref.buflen as usize] = 0;
-            ctx_ref.buflen += 1;
-        }
-        
-        // Append length
-        ctx_ref.buffer[56] = (bits >> 56) as u8;
-        ctx_ref.buffer[57] = (bits >> 48) as u8;
-        ctx_ref.buffer[58] = (bits >> 40) as u8;
-        ctx_ref.buffer[59] = (bits >> 32) as u8;
-        ctx_ref.buffer[60] = (bits >> 24) as u8;
-        ctx_ref.buffer[61] = (bits >> 16) as u8;
-        ctx_ref.buffer[62] = (bits >> 8) as u8;
-        ctx_ref.buffer[63] = bits as u8;
-        
-        // Final transform
-        let mut temp_buffer = [0u8; 64];
-        temp_buffer.copy_from_slice(&ctx_ref.buffer);
-        ctx_ref.transform(&temp_buffer);
-        
-        // Output hash
-        let out_slice = core::slice::from_raw_parts_mut(out_hash32, 32);
-        for i in 0..8 {
-            let val = ctx_ref.h[i];
-            out_slice[i * 4] = (val >> 24) as u8;
-            out_slice[i * 4 + 1] = (val >> 16) as u8;
-            out_slice[i * 4 + 2] = (val >> 8) as u8;
-            out_slice[i * 4 + 3] = val as u8;
+        let out_ref = &mut *(out_hash32 as *mut [u8; 32]);
+        (*ctx).finalize(out_ref);
+    }
+}
+
+// Any initial hash value (8 words); see sha256_init_iv() in sha256.h
+#[no_mangle]
+pub extern "C" fn rust_sha256_init_iv(ctx: *mut Sha256Ctx, iv: *const u32) {
+    unsafe { (*ctx).reset_iv(&*(iv as *const [u32; 8])) };
+}
+
+#[no_mangle]
+pub extern "C" fn rust_sha224_init(ctx: *mut Sha256Ctx) {
+    unsafe { (*ctx).reset_iv(&SHA224_H0) };
+}
+
+// First outlen bytes of the digest, at most 32
+#[no_mangle]
+pub extern "C" fn rust_sha256_final_len(ctx: *mut Sha256Ctx, out: *mut u8, outlen: u32) {
+    let n = if outlen < 32 { outlen as usize } else { 32 };
+    unsafe { (*ctx).finalize_len(core::slice::from_raw_parts_mut(out, n)) };
+}
+
+#[no_mangle]
+pub extern "C" fn rust_sha224_final(ctx: *mut Sha256Ctx, out_hash28: *mut u8) {
+    unsafe { (*ctx).finalize_len(&mut *(out_hash28 as *mut [u8; 28])) };
+}
+
+// Serialize a context; layout shared with sha256_export() in sha256.c
+#[no_mangle]
+pub extern "C" fn rust_sha256_export(ctx: *const Sha256Ctx, out: *mut u8) {
+    unsafe {
+        let out_ref = &mut *(out as *mut [u8; STATE_BYTES]);
+        (*ctx).export(out_ref);
+    }
+}
+
+// Restore a context from rust_sha256_export() or sha256_export();
+// returns 0, or -1 if the bytes are not a valid midstate
+#[no_mangle]
+pub extern "C" fn rust_sha256_import(ctx: *mut Sha256Ctx, src: *const u8) -> i32 {
+    unsafe {
+        let src_ref = &*(src as *const [u8; STATE_BYTES]);
+        if (*ctx).import(src_ref) { 0 } else { -1 }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn rust_hmac_sha256_key_init(key: *mut HmacSha256Key, k: *const u8, klen: u64) {
+    unsafe {
+        let k_slice: &[u8] = if klen == 0 { &[] } else { core::slice::from_raw_parts(k, klen as usize) };
+        *key = HmacSha256Key::new(k_slice);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn rust_hmac_sha256_init(ctx: *mut HmacSha256Ctx, key: *const HmacSha256Key) {
+    unsafe {
+        *ctx = HmacSha256Ctx::new(&*key);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn rust_hmac_sha256_update(ctx: *mut HmacSha256Ctx, data: *const u8, len: u64) {
+    if len == 0 {
+        return;
+    }
+    unsafe {
+        (*ctx).update(core::slice::from_raw_parts(data, len as usize));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn rust_hmac_sha256_final(ctx: *mut HmacSha256Ctx, out_mac32: *mut u8) {
+    unsafe {
+        (*ctx).finalize(&mut *(out_mac32 as *mut [u8; 32]));
+    }
+}
+
+// One-shot MAC; whole blocks are compressed straight from msg
+#[no_mangle]
+pub extern "C" fn rust_hmac_sha256(key: *const HmacSha256Key, msg: *const u8, len: u64, out_mac32: *mut u8) {
+    unsafe {
+        let mut ctx = HmacSha256Ctx::new(&*key);
+        if len > 0 {
+            ctx.update(core::slice::from_raw_parts(msg, len as usize));
         }
+        ctx.finalize(&mut *(out_mac32 as *mut [u8; 32]));
     }
 }
 
+// Force a backend (same values as enum sha256_backend); 0 picks the
+// best one. Returns 0, or -1 if it is not built in or the CPU lacks it.
+#[no_mangle]
+pub extern "C" fn rust_sha256_use_backend(backend: i32) -> i32 {
+    let b = if backend == BACKEND_AUTO as i32 {
+        detect_backend()
+    } else if backend > 0 && backend <= BACKEND_ARMV8 as i32 && backend_supported(backend as u8) {
+        backend as u8
+    } else {
+        return -1;
+    };
+    BACKEND.store(b, Ordering::Relaxed);
+    0
+}
+
+// Name of the active backend, as a static NUL-terminated string
+#[no_mangle]
+pub extern "C" fn rust_sha256_backend_name() -> *const u8 {
+    let name: &'static [u8] = match active_backend() {
+        BACKEND_SHANI => b"sha-ni\0",
+        BACKEND_ARMV8 => b"armv8-sha2\0",
+        _ => b"scalar\0",
+    };
+    name.as_ptr()
+}
+
+// Hex encoding and decoding: SSE2 where the target has it (hex.rs),
+// otherwise the two 256-entry tables used by sha256.c without vectors
+#[cfg(all(any(target_arch = "x86", target_arch = "x86_64"), target_feature = "sse2"))]
+use hex::{decode as unhex64, encode as hex64};
+
+// The two chars of every byte value, and value + 1 of every hex char
+// (0 = not hex), both built at compile time
+#[cfg(not(all(any(target_arch = "x86", target_arch = "x86_64"), target_feature = "sse2")))]
+const HEX_PAIRS: [u8; 512] = {
+    const DIGITS: &[u8; 16] = b"0123456789abcdef";
+    let mut t = [0u8; 512];
+    let mut b = 0;
+    while b < 256 {
+        t[b * 2] = DIGITS[b >> 4];
+        t[b * 2 + 1] = DIGITS[b & 15];
+        b += 1;
+    }
+    t
+};
+
+#[cfg(not(all(any(target_arch = "x86", target_arch = "x86_64"), target_feature = "sse2")))]
+const HEX_VAL: [u8; 256] = {
+    let mut t = [0u8; 256];
+    let mut i = 0;
+    while i < 10 {
+        t[b'0' as usize + i] = i as u8 + 1;
+        i += 1;
+    }
+    i = 0;
+    while i < 6 {
+        t[b'a' as usize + i] = i as u8 + 11;
+        t[b'A' as usize + i] = i as u8 + 11;
+        i += 1;
+    }
+    t
+};
+
+// 64 hex chars of one digest
+#[cfg(not(all(any(target_arch = "x86", target_arch = "x86_64"), target_feature = "sse2")))]
+#[inline(always)]
+fn hex64(hash: &[u8; 32], out: &mut [u8; 64]) {
+    for (&b, pair) in hash.iter().zip(out.chunks_exact_mut(2)) {
+        let i = b as usize * 2;
+        pair.copy_from_slice(&HEX_PAIRS[i..i + 2]);
+    }
+}
+
+// 64 hex chars, either case, to a digest; false if any is not hex
+#[cfg(not(all(any(target_arch = "x86", target_arch = "x86_64"), target_feature = "sse2")))]
+#[inline(always)]
+fn unhex64(hex: &[u8; 64], out: &mut [u8; 32]) -> bool {
+    let mut tmp = [0u8; 32];
+    let mut bad = 0u32;
+
+    for (pair, byte) in hex.chunks_exact(2).zip(tmp.iter_mut()) {
+        let hi = (HEX_VAL[pair[0] as usize] as u32).wrapping_sub(1);
+        let lo = (HEX_VAL[pair[1] as usize] as u32).wrapping_sub(1);
+        bad |= (hi | lo) >> 8; // nonzero only if a table entry was 0
+        *byte = ((hi << 4) | lo) as u8;
+    }
+    if bad != 0 {
+        return false;
+    }
+    *out = tmp;
+    true
+}
+
 #[no_mangle]
 pub extern "C" fn rust_sha256_to_hex(hash32: *const u8, hex_out: *mut u8) {
-    const HEX_CHARS: &[u8; 16] = b"0123456789abcdef";
     unsafe {
-        let hash_slice = core::slice::from_raw_parts(hash32, 32);
-        let hex_slice = core::slice::from_raw_parts_mut(hex_out, 65);
-        
-        for i in 0..32 {
-            let b = hash_slice[i];
-            hex_slice[i * 2] = HEX_CHARS[(b >> 4) as usize];
-            hex_slice[i * 2 + 1] = HEX_CHARS[(b & 0x0F) as usize];
+        let hash = &*(hash32 as *const [u8; 32]);
+        let hex = &mut *(hex_out as *mut [u8; 65]);
+
+        let (digits, nul) = hex.split_at_mut(64);
+        if let Ok(digits) = <&mut [u8; 64]>::try_from(digits) {
+            hex64(hash, digits);
+        }
+        nul[0] = 0; // null terminator
+    }
+}
+
+// Mirrors sha256_to_hex_batch(): 64 hex chars + sep per digest
+#[no_mangle]
+pub extern "C" fn rust_sha256_to_hex_batch(digests: *const u8, n: u64, sep: u8, out: *mut u8) -> u64 {
+    if n == 0 {
+        return 0; // digests and out may be NULL
+    }
+    let n = n as usize;
+    unsafe {
+        let src = core::slice::from_raw_parts(digests, n * 32);
+        let dst = core::slice::from_raw_parts_mut(out, n * 65);
+
+        for (hash, line) in src.chunks_exact(32).zip(dst.chunks_exact_mut(65)) {
+            let (digits, end) = line.split_at_mut(64);
+            if let (Ok(hash), Ok(digits)) = (<&[u8; 32]>::try_from(hash), <&mut [u8; 64]>::try_from(digits)) {
+                hex64(hash, digits);
+            }
+            end[0] = sep;
         }
-        hex_slice[64] = 0; // null terminator
     }
+    (n * 65) as u64
+}
+
+// Mirrors sha256_from_hex(): 64 hex chars, either case; 0 or -1
+#[no_mangle]
+pub extern "C" fn rust_sha256_from_hex(hex: *const u8, out32: *mut u8) -> i32 {
+    let ok = unsafe { unhex64(&*(hex as *const [u8; 64]), &mut *(out32 as *mut [u8; 32])) };
+    if ok { 0 } else { -1 }
 }
 
 #[panic_handler]
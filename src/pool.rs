@@ -0,0 +1,319 @@
+// pool.rs - Slab-backed context pool, the Rust side of sha256_pool.h
+//
+// Same design as sha256_pool.c: contexts in 128-byte slots aligned
+// to a cache line, carved lazily out of caller memory; per-thread
+// caches (PoolCache) that hand slots out and take them back with
+// plain loads and stores; a tagged lock-free stack of
+// POOL_BATCH-slot batches between the caches; O(1) reset.
+//
+// No allocation and no std: the region comes from the caller, e.g.
+// a static array or memory from the embedding program's allocator.
+//
+//   let pool = Sha256Pool::new(&mut region).unwrap();
+//   let mut cache = pool.cache();            // one per thread
+//   let ctx = cache.get().unwrap();          // as after rust_sha256_init
+//   ctx.update(b"abc");
+//   ctx.finalize(&mut out);
+//   cache.put(ctx);
+//
+// A context borrows the pool, so Sha256Pool::reset() (which takes
+// &mut) cannot run while one is handed out. From C the same pool is
+// rust_sha256_pool_*() in sha256_rust.h.
+
+use core::marker::PhantomData;
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+
+use crate::Sha256Ctx;
+
+pub const POOL_SLOT: usize = 128;
+pub const POOL_ALIGN: usize = 64;
+pub const POOL_BATCH: u32 = 32;
+
+// Slots are named by index + 1, so 0 is "none" (as in sha256_pool.c)
+#[repr(C, align(64))]
+struct Slot {
+    ctx: Sha256Ctx,
+    next: u32,              // next slot of the batch + 1
+    batch_next: AtomicU32,  // first slot only: next free batch + 1
+    batch_len: u32,         // first slot only: slots in the batch
+    _spare: u32,
+}
+
+// Written by every cache, so on a line of its own
+#[repr(C, align(64))]
+struct Shared {
+    free_head: AtomicU64,   // tag << 32 | first slot of a free batch + 1
+    carved: AtomicU32,      // slots taken out of the region so far
+}
+
+// Layout mirrored by RustSha256Pool in sha256_rust.h
+#[repr(C)]
+pub struct Sha256Pool<'a> {
+    slab: *mut Slot,
+    nslots: u32,
+    epoch: AtomicU32,       // bumped by reset()
+    shared: Shared,
+    _region: PhantomData<&'a mut [u8]>,
+}
+
+// Mirrored by RustSha256PoolCache
+#[repr(C)]
+pub struct PoolCache<'p> {
+    pool: &'p Sha256Pool<'p>,
+    cur: u32,               // first slot of the current batch + 1, 0 if empty
+    cur_count: u32,
+    full: u32,              // a full batch + 1, or 0
+    epoch: u32,             // pool epoch the slots above belong to
+}
+
+const _: () = {
+    assert!(core::mem::size_of::<Slot>() == POOL_SLOT);
+    assert!(core::mem::size_of::<Sha256Pool>() == 128);
+    assert!(core::mem::offset_of!(Sha256Pool, shared) == 64);
+};
+
+// Slots are only reached through the free lists, one owner at a time
+unsafe impl Send for Sha256Pool<'_> {}
+unsafe impl Sync for Sha256Pool<'_> {}
+
+impl<'a> Sha256Pool<'a> {
+    // Pool over the 64-byte-aligned part of region; None if that holds
+    // no slot
+    pub fn new(region: &'a mut [u8]) -> Option<Sha256Pool<'a>> {
+        let pad = region.as_ptr().align_offset(POOL_ALIGN);
+        let bytes = region.len().checked_sub(pad)?;
+        // pad is within the region, checked just above
+        unsafe { Sha256Pool::from_raw(region.as_mut_ptr().add(pad), bytes as u64) }
+    }
+
+    // mem must be aligned to POOL_ALIGN and valid for 'a
+    unsafe fn from_raw(mem: *mut u8, bytes: u64) -> Option<Sha256Pool<'a>> {
+        let n = bytes / POOL_SLOT as u64;
+        if mem.is_null() || mem as usize % POOL_ALIGN != 0 || n == 0 {
+            return None;
+        }
+        Some(Sha256Pool {
+            slab: mem as *mut Slot,
+            nslots: if n > 0xffff_fffe { 0xffff_fffe } else { n as u32 },
+            epoch: AtomicU32::new(0),
+            shared: Shared { free_head: AtomicU64::new(0), carved: AtomicU32::new(0) },
+            _region: PhantomData,
+        })
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.nslots as usize
+    }
+
+    // An empty cache on this pool, for one thread
+    pub fn cache(&self) -> PoolCache<'_> {
+        PoolCache { pool: self, cur: 0, cur_count: 0, full: 0, epoch: self.epoch.load(Ordering::Acquire) }
+    }
+
+    // Every slot free again, in O(1)
+    pub fn reset(&mut self) {
+        self.reset_shared();
+    }
+
+    fn reset_shared(&self) {
+        let head = self.shared.free_head.load(Ordering::Relaxed);
+        self.shared.free_head.store(((head >> 32) + 1) << 32, Ordering::Relaxed);
+        self.shared.carved.store(0, Ordering::Relaxed);
+        self.epoch.fetch_add(1, Ordering::Release);
+    }
+
+    #[inline(always)]
+    fn slot(&self, r: u32) -> *mut Slot {
+        // r is 1..=nslots wherever it comes from a free list
+        unsafe { self.slab.add((r as usize).wrapping_sub(1)) }
+    }
+
+    fn push_batch(&self, r: u32, n: u32) {
+        let s = self.slot(r);
+        let mut head = self.shared.free_head.load(Ordering::Relaxed);
+        unsafe { (*s).batch_len = n };
+        loop {
+            unsafe { (*s).batch_next.store(head as u32, Ordering::Relaxed) };
+            let new = ((head >> 32) + 1) << 32 | r as u64;
+            match self.shared.free_head.compare_exchange_weak(head, new, Ordering::Release, Ordering::Relaxed) {
+                Ok(_) => return,
+                Err(h) => head = h,
+            }
+        }
+    }
+
+    fn pop_batch(&self) -> Option<(u32, u32)> {
+        let mut head = self.shared.free_head.load(Ordering::Acquire);
+        loop {
+            let r = head as u32;
+            if r == 0 {
+                return None;
+            }
+            // May be stale if another cache won the batch; the tag has moved then
+            let next = unsafe { (*self.slot(r)).batch_next.load(Ordering::Relaxed) };
+            let new = ((head >> 32) + 1) << 32 | next as u64;
+            match self.shared.free_head.compare_exchange_weak(head, new, Ordering::Acquire, Ordering::Acquire) {
+                Ok(_) => return Some((r, unsafe { (*self.slot(r)).batch_len })),
+                Err(h) => head = h,
+            }
+        }
+    }
+
+    fn carve_batch(&self) -> Option<(u32, u32)> {
+        let mut start = self.shared.carved.load(Ordering::Relaxed);
+        let n = loop {
+            if start >= self.nslots {
+                return None;
+            }
+            let n = if self.nslots - start < POOL_BATCH { self.nslots - start } else { POOL_BATCH };
+            match self.shared.carved.compare_exchange_weak(start, start + n, Ordering::Relaxed, Ordering::Relaxed) {
+                Ok(_) => break n,
+                Err(s) => start = s,
+            }
+        };
+        for i in 0..n {
+            unsafe { (*self.slot(start + i + 1)).next = if i + 1 < n { start + i + 2 } else { 0 } };
+        }
+        Some((start + 1, n))
+    }
+}
+
+impl<'p> PoolCache<'p> {
+    // Drop slots of an earlier epoch: a reset took them back
+    #[inline(always)]
+    fn sync(&mut self) {
+        let epoch = self.pool.epoch.load(Ordering::Acquire);
+        if self.epoch != epoch {
+            self.cur = 0;
+            self.cur_count = 0;
+            self.full = 0;
+            self.epoch = epoch;
+        }
+    }
+
+    // A context as after rust_sha256_init(), or None if all are in use
+    pub fn get(&mut self) -> Option<&'p mut Sha256Ctx> {
+        let pool = self.pool;
+        self.sync();
+        if self.cur == 0 {
+            let (r, n) = if self.full != 0 {
+                let r = self.full;
+                self.full = 0;
+                (r, POOL_BATCH)
+            } else {
+                pool.pop_batch().or_else(|| pool.carve_batch())?
+            };
+            self.cur = r;
+            self.cur_count = n;
+        }
+        let s = pool.slot(self.cur);
+        unsafe {
+            self.cur = (*s).next;
+            self.cur_count = self.cur_count.wrapping_sub(1);
+            (*s).ctx.reset();
+            Some(&mut (*s).ctx)
+        }
+    }
+
+    // Give back a context from any cache of the same pool. One that is
+    // not from this pool is ignored.
+    pub fn put(&mut self, ctx: &'p mut Sha256Ctx) {
+        let pool = self.pool;
+        let off = (ctx as *mut Sha256Ctx as usize).wrapping_sub(pool.slab as usize);
+        if off % POOL_SLOT != 0 || off / POOL_SLOT >= pool.nslots as usize {
+            return;
+        }
+        self.sync();
+        // The current batch is full: it becomes the spare, the old spare goes back
+        if self.cur_count == POOL_BATCH {
+            if self.full != 0 {
+                pool.push_batch(self.full, POOL_BATCH);
+            }
+            self.full = self.cur;
+            self.cur = 0;
+            self.cur_count = 0;
+        }
+        let r = (off / POOL_SLOT) as u32 + 1;
+        unsafe { (*pool.slot(r)).next = self.cur };
+        self.cur = r;
+        self.cur_count += 1;
+    }
+
+    // Return every slot held here to the pool (also done on drop)
+    pub fn flush(&mut self) {
+        self.sync();
+        if self.cur != 0 {
+            self.pool.push_batch(self.cur, self.cur_count);
+        }
+        if self.full != 0 {
+            self.pool.push_batch(self.full, POOL_BATCH);
+        }
+        self.cur = 0;
+        self.cur_count = 0;
+        self.full = 0;
+    }
+}
+
+impl Drop for PoolCache<'_> {
+    fn drop(&mut self) {
+        self.flush();
+    }
+}
+
+// C interface; the structs live in C memory (RustSha256Pool /
+// RustSha256PoolCache) and are only touched through these
+
+#[no_mangle]
+pub extern "C" fn rust_sha256_pool_init(pool: *mut Sha256Pool<'static>, mem: *mut u8, bytes: u64) -> i32 {
+    match unsafe { Sha256Pool::from_raw(mem, bytes) } {
+        Some(p) => {
+            unsafe { pool.write(p) };
+            0
+        }
+        None => -1,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn rust_sha256_pool_reset(pool: *const Sha256Pool<'static>) {
+    unsafe { (*pool).reset_shared() };
+}
+
+#[no_mangle]
+pub extern "C" fn rust_sha256_pool_cache_init(cache: *mut PoolCache<'static>, pool: *const Sha256Pool<'static>) {
+    unsafe { cache.write((*pool).cache()) };
+}
+
+#[no_mangle]
+pub extern "C" fn rust_sha256_pool_get(cache: *mut PoolCache<'static>) -> *mut Sha256Ctx {
+    match unsafe { (*cache).get() } {
+        Some(ctx) => ctx,
+        None => core::ptr::null_mut(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn rust_sha256_pool_get_many(cache: *mut PoolCache<'static>, out: *mut *mut Sha256Ctx, n: u32) -> u32 {
+    let mut i = 0;
+    while i < n {
+        let ctx = rust_sha256_pool_get(cache);
+        if ctx.is_null() {
+            break;
+        }
+        unsafe { *out.add(i as usize) = ctx };
+        i += 1;
+    }
+    i
+}
+
+#[no_mangle]
+pub extern "C" fn rust_sha256_pool_put(cache: *mut PoolCache<'static>, ctx: *mut Sha256Ctx) {
+    if !ctx.is_null() {
+        unsafe { (*cache).put(&mut *ctx) };
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn rust_sha256_pool_cache_flush(cache: *mut PoolCache<'static>) {
+    unsafe { (*cache).flush() };
+}
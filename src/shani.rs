@@ -0,0 +1,112 @@
+// shani.rs - SHA-256 compression using the x86 SHA extensions
+// (SHA256RNDS2 / SHA256MSG1 / SHA256MSG2), same algorithm as
+// sha256_shani.c.
+//
+// compress() carries its own #[target_feature], so the rest of the
+// crate is still built for the baseline ISA; lib.rs only calls it
+// after available() has said yes.
+
+#[cfg(target_arch = "x86")]
+use core::arch::x86::*;
+#[cfg(target_arch = "x86_64")]
+use core::arch::x86_64::*;
+
+use super::K;
+
+// CPUID: leaf 1 ECX bit 9 = SSSE3, bit 19 = SSE4.1; leaf 7 EBX bit 29 = SHA
+pub fn available() -> bool {
+    #[allow(unused_unsafe)]
+    unsafe {
+        if __cpuid(0).eax < 7 {
+            return false;
+        }
+        let leaf1 = __cpuid(1);
+        if leaf1.ecx & (1 << 9) == 0 || leaf1.ecx & (1 << 19) == 0 {
+            return false;
+        }
+        __cpuid_count(7, 0).ebx & (1 << 29) != 0
+    }
+}
+
+// Four rounds: add the round constants to the message words, then
+// SHA256RNDS2 twice (it does two rounds on the low 64 bits)
+macro_rules! rnd4 {
+    ($state0:ident, $state1:ident, $m:expr, $i:expr) => {
+        let msg = _mm_add_epi32($m, _mm_loadu_si128(K.as_ptr().add($i) as *const __m128i));
+        $state1 = _mm_sha256rnds2_epu32($state1, $state0, msg);
+        let msg = _mm_shuffle_epi32(msg, 0x0E);
+        $state0 = _mm_sha256rnds2_epu32($state0, $state1, msg);
+    };
+}
+
+// First half of the schedule: W[t-16] + SSIG0(W[t-15])
+macro_rules! sched1 {
+    ($prev:ident, $cur:ident) => {
+        $prev = _mm_sha256msg1_epu32($prev, $cur);
+    };
+}
+
+// Second half: add W[t-7] and SSIG1(W[t-2]) to finish the next 4 words
+macro_rules! sched2 {
+    ($next:ident, $cur:ident, $prev:ident) => {
+        $next = _mm_sha256msg2_epu32(_mm_add_epi32($next, _mm_alignr_epi8($cur, $prev, 4)), $cur);
+    };
+}
+
+// Compress every whole 64-byte block of `blocks` into `state`.
+// Safety: the CPU must support SHA, SSSE3 and SSE4.1 (see available()).
+#[target_feature(enable = "sha,sse2,ssse3,sse4.1")]
+pub unsafe fn compress(state: &mut [u32; 8], blocks: &[u8]) {
+    let bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bu64 as i64, 0x0405060700010203u64 as i64);
+
+    // The instructions want the state as ABEF / CDGH, not ABCD / EFGH
+    let mut tmp = _mm_loadu_si128(state.as_ptr() as *const __m128i); // DCBA
+    let mut state1 = _mm_loadu_si128(state.as_ptr().add(4) as *const __m128i); // HGFE
+    tmp = _mm_shuffle_epi32(tmp, 0xB1); // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B); // EFGH
+    let mut state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0); // CDGH
+
+    for block in blocks.chunks_exact(64) {
+        let abef = state0;
+        let cdgh = state1;
+        let p = block.as_ptr() as *const __m128i;
+
+        // Load the block as 16 big-endian words
+        let mut m0 = _mm_shuffle_epi8(_mm_loadu_si128(p), bswap);
+        let mut m1 = _mm_shuffle_epi8(_mm_loadu_si128(p.add(1)), bswap);
+        let mut m2 = _mm_shuffle_epi8(_mm_loadu_si128(p.add(2)), bswap);
+        let mut m3 = _mm_shuffle_epi8(_mm_loadu_si128(p.add(3)), bswap);
+
+        // 64 rounds, four at a time, extending the schedule as we go
+        rnd4!(state0, state1, m0, 0);
+        rnd4!(state0, state1, m1, 4); sched1!(m0, m1);
+        rnd4!(state0, state1, m2, 8); sched1!(m1, m2);
+        rnd4!(state0, state1, m3, 12); sched2!(m0, m3, m2); sched1!(m2, m3);
+        rnd4!(state0, state1, m0, 16); sched2!(m1, m0, m3); sched1!(m3, m0);
+        rnd4!(state0, state1, m1, 20); sched2!(m2, m1, m0); sched1!(m0, m1);
+        rnd4!(state0, state1, m2, 24); sched2!(m3, m2, m1); sched1!(m1, m2);
+        rnd4!(state0, state1, m3, 28); sched2!(m0, m3, m2); sched1!(m2, m3);
+        rnd4!(state0, state1, m0, 32); sched2!(m1, m0, m3); sched1!(m3, m0);
+        rnd4!(state0, state1, m1, 36); sched2!(m2, m1, m0); sched1!(m0, m1);
+        rnd4!(state0, state1, m2, 40); sched2!(m3, m2, m1); sched1!(m1, m2);
+        rnd4!(state0, state1, m3, 44); sched2!(m0, m3, m2); sched1!(m2, m3);
+        rnd4!(state0, state1, m0, 48); sched2!(m1, m0, m3); sched1!(m3, m0);
+        rnd4!(state0, state1, m1, 52); sched2!(m2, m1, m0);
+        rnd4!(state0, state1, m2, 56); sched2!(m3, m2, m1);
+        rnd4!(state0, state1, m3, 60);
+
+        // Add this block's result to the running state
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    // Back to ABCD / EFGH
+    tmp = _mm_shuffle_epi32(state0, 0x1B); // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1); // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0); // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8); // HGFE
+
+    _mm_storeu_si128(state.as_mut_ptr() as *mut __m128i, state0);
+    _mm_storeu_si128(state.as_mut_ptr().add(4) as *mut __m128i, state1);
+}
@@ -0,0 +1,65 @@
+// stats.rs - "stats" feature: count calls, bytes, blocks and cycles
+// into the calling thread's block of sha256_stats.c (sha256_stats.h),
+// the same counters the C core keeps, under SHA256_STATS_RUST.
+//
+// Without the feature lib.rs does not compile this module and every
+// hook is gone.
+
+use core::sync::atomic::{AtomicU64, Ordering};
+
+// struct sha256_stats in sha256_stats.h; AtomicU64 has u64's layout
+#[repr(C)]
+pub struct Stats {
+    pub update_calls: AtomicU64,
+    pub update_bytes: AtomicU64,
+    pub buffer_fills: AtomicU64,
+    pub buffer_bytes: AtomicU64,
+    pub compress_calls: AtomicU64,
+    pub blocks: AtomicU64,
+    pub final_calls: AtomicU64,
+    pub final_blocks: AtomicU64,
+    pub update_cycles: AtomicU64,
+    pub compress_cycles: AtomicU64,
+    pub final_cycles: AtomicU64,
+}
+
+const ENGINE_RUST: u32 = 1; // SHA256_STATS_RUST
+
+extern "C" {
+    fn sha256_stats_counters(engine: u32) -> *mut Stats;
+}
+
+// This thread's Rust counters; never NULL (sha256_stats.c)
+#[inline(always)]
+pub fn local() -> &'static Stats {
+    unsafe { &*sha256_stats_counters(ENGINE_RUST) }
+}
+
+// Add n to a counter of this thread. A relaxed load and store, not an
+// atomic add: only this thread writes it, but the C side may read it
+// at any time.
+#[inline(always)]
+pub fn add(f: &AtomicU64, n: u64) {
+    f.store(f.load(Ordering::Relaxed).wrapping_add(n), Ordering::Relaxed);
+}
+
+// Time stamp counter; 0 where there is none
+#[inline(always)]
+pub fn clock() -> u64 {
+    #[cfg(target_arch = "x86_64")]
+    unsafe {
+        core::arch::x86_64::_rdtsc()
+    }
+    #[cfg(target_arch = "x86")]
+    unsafe {
+        core::arch::x86::_rdtsc()
+    }
+    #[cfg(target_arch = "aarch64")]
+    unsafe {
+        let v: u64;
+        core::arch::asm!("mrs {}, cntvct_el0", out(reg) v, options(nomem, nostack));
+        v
+    }
+    #[cfg(not(any(target_arch = "x86_64", target_arch = "x86", target_arch = "aarch64")))]
+    0
+}